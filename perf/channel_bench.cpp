@@ -0,0 +1,133 @@
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "interpreter/channel.hpp"
+#include "interpreter/ring_buffer.hpp"
+
+
+/**
+ * @brief Channel throughput benchmark.
+ *
+ * Moves messages from producer threads to consumer threads through the raw
+ * ring buffer and through runtime channels carrying interpreter objects,
+ * and prints messages per second for each configuration.
+ */
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    const size_t Capacity = 1024;
+
+
+    template <typename Ring>
+    double ring_throughput(int producers, int consumers, long long messages)
+    {
+        Ring ring(Capacity);
+
+        std::vector<std::thread> threads;
+
+        auto start = Clock::now();
+
+        for (int p = 0; p < producers; ++p)
+        {
+            threads.emplace_back([&, p] {
+                for (long long i = p; i < messages; i += producers)
+                {
+                    long long value = i;
+
+                    while (!ring.try_push(value))
+                        std::this_thread::yield();
+                }
+            });
+        }
+
+        for (int c = 0; c < consumers; ++c)
+        {
+            threads.emplace_back([&, c] {
+                long long value;
+
+                for (long long i = c; i < messages; i += consumers)
+                {
+                    while (!ring.try_pop(value))
+                        std::this_thread::yield();
+                }
+            });
+        }
+
+        for (auto &thread : threads)
+            thread.join();
+
+        return messages / std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+
+    double channel_throughput(int producers, int consumers, long long messages)
+    {
+        using namespace Tomato::Runtime;
+
+        const Tomato::Semantic::Symbol int_type = 0;
+        const Tomato::Semantic::Symbol channel_type = 1;
+
+        auto state = std::make_shared<Channel::State>(int_type, Capacity);
+
+        std::vector<std::thread> threads;
+        std::atomic<int> running_producers(producers);
+
+        auto start = Clock::now();
+
+        for (int p = 0; p < producers; ++p)
+        {
+            threads.emplace_back([&, p] {
+                Channel channel(channel_type, state, false);
+
+                for (long long i = p; i < messages; i += producers)
+                    channel.send(std::make_shared<Scalar<int>>(int_type, static_cast<int>(i), false));
+
+                if (--running_producers == 0)
+                    channel.close();
+            });
+        }
+
+        for (int c = 0; c < consumers; ++c)
+        {
+            threads.emplace_back([&] {
+                Channel channel(channel_type, state, false);
+
+                while (channel.receive()) {}
+            });
+        }
+
+        for (auto &thread : threads)
+            thread.join();
+
+        return messages / std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+
+    void report(const std::string &name, double rate)
+    {
+        std::cout << std::left << std::setw(28) << name
+                  << std::right << std::setw(14) << std::fixed << std::setprecision(0) << rate
+                  << " msg/s" << std::endl;
+    }
+}
+
+
+int main(int argc, char *argv[])
+{
+    using namespace Tomato::Runtime;
+
+    long long messages = argc > 1 ? std::atoll(argv[1]) : 2000000;
+
+    report("mpmc ring 1:1", ring_throughput<MpmcRing<long long>>(1, 1, messages));
+    report("mpmc ring 4:4", ring_throughput<MpmcRing<long long>>(4, 4, messages));
+    report("channel 1:1", channel_throughput(1, 1, messages));
+    report("channel 4:4", channel_throughput(4, 4, messages));
+
+    return 0;
+}
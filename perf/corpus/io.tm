@@ -0,0 +1,17 @@
+var count int
+read count
+
+var sum = 0
+var value int
+var i = 0
+
+while i < count do
+    read value
+    sum = sum + value
+    print sum
+    i = i + 1
+end
+
+var c char
+read c
+print c
@@ -0,0 +1,15 @@
+var total = 0
+var i = 0
+
+while i < 100 do
+    var j = 0
+
+    while j < 100 do
+        total = total + (i * j) % 7
+        j = j + 1
+    end
+
+    i = i + 1
+end
+
+print total
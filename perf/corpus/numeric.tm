@@ -0,0 +1,26 @@
+let steps = 4000
+
+var pi = 0.0
+var sign = 1.0
+var k = 0
+
+while k < steps do
+    pi = pi + sign * 4.0 / (2 * k + 1)
+    sign = 0.0 - sign
+    k = k + 1
+end
+
+print pi
+
+var x = 1.0
+var n = 0
+
+while n < 2000 do
+    x = x - (x * x - 2.0) / (2.0 * x)
+    n = n + 1
+end
+
+print x
+print 2 ^ 10
+print 2.0 ^ 0.5
+print 7 / 2
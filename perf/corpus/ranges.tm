@@ -0,0 +1,17 @@
+var total = 0
+
+for i in 0..150 do
+    for j in 0..150 step 3 do
+        total = total + (i * j) % 11
+    end
+end
+
+print total
+
+var down = 0
+
+for k in 5000..0 step 0 - 7 do
+    down = down + k % 3
+end
+
+print down
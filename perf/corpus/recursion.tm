@@ -0,0 +1,24 @@
+func fib(n int) -> int
+    if n < 2 then
+        return n
+    else
+        return fib(n - 1) + fib(n - 2)
+    end
+end
+
+func factorial(n int) -> int
+    if n > 1 then
+        return n * factorial(n - 1)
+    else
+        return 1
+    end
+end
+
+print fib(13)
+
+var i = 0
+
+while i < 50 do
+    print factorial(i % 12)
+    i = i + 1
+end
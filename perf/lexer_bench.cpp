@@ -0,0 +1,100 @@
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include "syntax/lexer.hpp"
+#include "syntax/scan.hpp"
+
+
+/**
+ * @brief Lexer scanning benchmark.
+ *
+ * Measures character class scans over long runs of whitespace, identifier
+ * and digit characters, then tokenization of a generated source, for every
+ * instruction set supported by the CPU.
+ */
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+    using Tomato::Syntax::Scan::Isa;
+
+
+    const char *name(Isa isa)
+    {
+        switch (isa)
+        {
+            case Isa::Scalar: return "scalar";
+            case Isa::SSE2:   return "sse2";
+            case Isa::AVX2:   return "avx2";
+        }
+
+        return "";
+    }
+
+
+    template <typename Function>
+    double gigabytes_per_second(size_t bytes, Function &&function)
+    {
+        auto start = Clock::now();
+
+        function();
+
+        return bytes / std::chrono::duration<double>(Clock::now() - start).count() / 1e9;
+    }
+
+
+    void report(const std::string &name, double rate, const char *unit)
+    {
+        std::cout << std::left << std::setw(28) << name
+                  << std::right << std::setw(10) << std::fixed << std::setprecision(2) << rate
+                  << " " << unit << std::endl;
+    }
+}
+
+
+int main(int argc, char *argv[])
+{
+    using namespace Tomato::Syntax;
+
+    size_t megabytes = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 64;
+    size_t size = megabytes << 20;
+
+    // runs end every 4 KiB, as they would at the end of a line, comment block or long name
+    std::string spaces(size, ' '), letters(size, 'a'), digits(size, '5');
+
+    for (size_t i = 4095; i < size; i += 4096)
+        spaces[i] = letters[i] = digits[i] = ';';
+
+    std::string source;
+
+    while (source.size() < size)
+        source += "func f123(counter int) -> int\n    return counter * 42 + previous_value1\nend\n";
+
+    for (auto isa : {Isa::Scalar, Isa::SSE2, Isa::AVX2})
+    {
+        if (isa > Scan::detect())
+            continue;
+
+        Scan::select(isa);
+
+        auto scan = [] (const std::string &text, size_t (*end)(const char *, size_t, size_t)) {
+            return [&text, end] {
+                for (size_t i = 0; i < text.size(); i = end(text.data(), i, text.size()) + 1) {}
+            };
+        };
+
+        report(std::string(name(isa)) + " whitespace", gigabytes_per_second(size, scan(spaces, Scan::whitespace_end)), "GB/s");
+        report(std::string(name(isa)) + " identifier", gigabytes_per_second(size, scan(letters, Scan::alnum_end)), "GB/s");
+        report(std::string(name(isa)) + " number", gigabytes_per_second(size, scan(digits, Scan::digits_end)), "GB/s");
+
+        report(std::string(name(isa)) + " lexer", gigabytes_per_second(source.size(), [&source] {
+            Lexer lexer(source);
+
+            while (lexer.get_next().terminal != Terminal::EndOfFile) {}
+        }), "GB/s");
+    }
+
+    return 0;
+}
@@ -0,0 +1,474 @@
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <chrono>
+#include <fcntl.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+
+namespace fs = std::filesystem;
+
+
+/**
+ * @brief End-to-end performance regression runner.
+ *
+ * Runs the interpreter on every program of the corpus, checks its output
+ * against the expected one and compares wall time, peak RSS and (where the
+ * kernel allows it) retired instructions with the checked-in baseline.
+ */
+namespace
+{
+    struct Measurement
+    {
+        double wall_ms = 0;
+        long max_rss_kb = 0;
+        std::optional<long long> instructions;
+        std::string output;
+        int status = 0;
+    };
+
+
+    struct Tolerance
+    {
+        double wall_time = 2.0;
+        double wall_time_slack_ms = 25;
+        double max_rss = 1.5;
+        double max_rss_slack_kb = 2048;
+        double instructions = 1.1;
+    };
+
+
+    struct Baseline
+    {
+        Tolerance tolerance;
+        std::map<std::string, Measurement> programs;
+    };
+
+
+    /**
+     * @brief Minimal reader for the baseline file (objects, strings, numbers and null).
+     */
+    class JsonReader
+    {
+    public:
+        explicit JsonReader(const std::string &text) : text(text) {}
+
+        Baseline baseline()
+        {
+            Baseline result;
+
+            object([&] (const std::string &key) {
+                if (key == "tolerance")
+                {
+                    object([&] (const std::string &name) {
+                        auto value = number().value_or(0);
+
+                        if (name == "wall_time") result.tolerance.wall_time = value;
+                        else if (name == "wall_time_slack_ms") result.tolerance.wall_time_slack_ms = value;
+                        else if (name == "max_rss") result.tolerance.max_rss = value;
+                        else if (name == "max_rss_slack_kb") result.tolerance.max_rss_slack_kb = value;
+                        else if (name == "instructions") result.tolerance.instructions = value;
+                    });
+                }
+                else if (key == "programs")
+                {
+                    object([&] (const std::string &program) {
+                        Measurement &m = result.programs[program];
+
+                        object([&] (const std::string &name) {
+                            auto value = number();
+
+                            if (name == "wall_ms") m.wall_ms = value.value_or(0);
+                            else if (name == "max_rss_kb") m.max_rss_kb = static_cast<long>(value.value_or(0));
+                            else if (name == "instructions" && value) m.instructions = static_cast<long long>(*value);
+                        });
+                    });
+                }
+                else
+                {
+                    throw std::runtime_error("unexpected key '" + key + "' in baseline");
+                }
+            });
+
+            return result;
+        }
+
+    private:
+        template <typename Callback>
+        void object(Callback callback)
+        {
+            expect('{');
+
+            while (peek() != '}')
+            {
+                auto key = string();
+                expect(':');
+                callback(key);
+
+                if (peek() == ',')
+                    ++pos;
+            }
+
+            expect('}');
+        }
+
+        std::string string()
+        {
+            expect('"');
+            auto end = text.find('"', pos);
+
+            if (end == std::string::npos)
+                throw std::runtime_error("unterminated string in baseline");
+
+            auto value = text.substr(pos, end - pos);
+            pos = end + 1;
+            return value;
+        }
+
+        std::optional<double> number()
+        {
+            peek();
+
+            if (text.compare(pos, 4, "null") == 0)
+            {
+                pos += 4;
+                return std::nullopt;
+            }
+
+            size_t length = 0;
+            double value = std::stod(text.substr(pos), &length);
+            pos += length;
+            return value;
+        }
+
+        char peek()
+        {
+            while (pos < text.size() && std::isspace(static_cast<unsigned char>(text[pos])))
+                ++pos;
+
+            if (pos >= text.size())
+                throw std::runtime_error("unexpected end of baseline");
+
+            return text[pos];
+        }
+
+        void expect(char c)
+        {
+            if (peek() != c)
+                throw std::runtime_error(std::string("'") + c + "' expected in baseline");
+            ++pos;
+        }
+
+    private:
+        const std::string &text;
+        size_t pos = 0;
+    };
+
+
+    void write_baseline(const fs::path &path, const Baseline &baseline)
+    {
+        std::ofstream file(path);
+        const auto &t = baseline.tolerance;
+
+        file << "{\n"
+             << "    \"tolerance\": {\n"
+             << "        \"wall_time\": " << t.wall_time << ",\n"
+             << "        \"wall_time_slack_ms\": " << t.wall_time_slack_ms << ",\n"
+             << "        \"max_rss\": " << t.max_rss << ",\n"
+             << "        \"max_rss_slack_kb\": " << t.max_rss_slack_kb << ",\n"
+             << "        \"instructions\": " << t.instructions << "\n"
+             << "    },\n"
+             << "    \"programs\": {";
+
+        bool first = true;
+
+        for (auto &[name, m] : baseline.programs)
+        {
+            file << (first ? "\n" : ",\n")
+                 << "        \"" << name << "\": {"
+                 << "\"wall_ms\": " << std::fixed << std::setprecision(1) << m.wall_ms << ", "
+                 << "\"max_rss_kb\": " << m.max_rss_kb << ", "
+                 << "\"instructions\": ";
+
+            if (m.instructions)
+                file << *m.instructions;
+            else
+                file << "null";
+
+            file << "}";
+            first = false;
+        }
+
+        file << "\n    }\n}\n";
+    }
+
+
+    int open_instruction_counter(pid_t pid)
+    {
+        perf_event_attr attr {};
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+        attr.disabled = 1;
+        attr.enable_on_exec = 1;
+        attr.inherit = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+
+        return static_cast<int>(syscall(SYS_perf_event_open, &attr, pid, -1, -1, 0));
+    }
+
+
+    Measurement run(const fs::path &tomato, const fs::path &program, const fs::path &input)
+    {
+        int go[2], out[2];
+
+        if (pipe(go) != 0 || pipe(out) != 0)
+            throw std::runtime_error("can't create pipe");
+
+        pid_t pid = fork();
+
+        if (pid < 0)
+            throw std::runtime_error("can't fork");
+
+        if (pid == 0)
+        {
+            int in = open(input.c_str(), O_RDONLY);
+
+            dup2(in, STDIN_FILENO);
+            dup2(out[1], STDOUT_FILENO);
+            close(out[0]);
+            close(go[1]);
+
+            char byte;
+            if (read(go[0], &byte, 1) != 1)
+                _exit(127);
+
+            // cached trees would skip the lexer and parser, which the corpus must measure too
+            execl(tomato.c_str(), tomato.c_str(), "--no-cache", program.c_str(), nullptr);
+            _exit(127);
+        }
+
+        close(go[0]);
+        close(out[1]);
+
+        int counter = open_instruction_counter(pid);
+
+        auto start = std::chrono::steady_clock::now();
+
+        if (write(go[1], "x", 1) != 1)
+            throw std::runtime_error("can't start child process");
+        close(go[1]);
+
+        Measurement m;
+        char buffer[4096];
+        ssize_t count;
+
+        while ((count = read(out[0], buffer, sizeof(buffer))) > 0)
+            m.output.append(buffer, static_cast<size_t>(count));
+
+        close(out[0]);
+
+        rusage usage {};
+        wait4(pid, &m.status, 0, &usage);
+
+        m.wall_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        m.max_rss_kb = usage.ru_maxrss;
+
+        if (counter >= 0)
+        {
+            long long value;
+
+            if (read(counter, &value, sizeof(value)) == sizeof(value) && value > 0)
+                m.instructions = value;
+
+            close(counter);
+        }
+
+        return m;
+    }
+
+
+    std::string read_file(const fs::path &path)
+    {
+        std::ifstream file(path);
+        return std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    }
+}
+
+
+int main(int argc, char **argv)
+{
+    fs::path tomato, corpus, baseline_path;
+    bool update = false;
+    int repeat = 3;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+
+        if (arg == "--tomato" && i + 1 < argc)
+            tomato = argv[++i];
+        else if (arg == "--corpus" && i + 1 < argc)
+            corpus = argv[++i];
+        else if (arg == "--baseline" && i + 1 < argc)
+            baseline_path = argv[++i];
+        else if (arg == "--repeat" && i + 1 < argc)
+            repeat = std::max(1, std::stoi(argv[++i]));
+        else if (arg == "--update")
+            update = true;
+        else
+        {
+            std::cerr << "Usage:\n\n"
+                      << "    tomato_perf --tomato <binary> --corpus <dir> --baseline <file> [--repeat N] [--update]\n\n"
+                      << "Runs every program of the corpus and compares its output and resource usage with the baseline.\n"
+                      << "With --update the baseline file is rewritten with the measured values." << std::endl;
+            return 2;
+        }
+    }
+
+    Baseline baseline;
+
+    if (fs::exists(baseline_path))
+    {
+        auto text = read_file(baseline_path);
+
+        try
+        {
+            baseline = JsonReader(text).baseline();
+        }
+        catch (std::exception &error)
+        {
+            std::cerr << "Can't read baseline '" << baseline_path.string() << "': " << error.what() << std::endl;
+            return 2;
+        }
+    }
+
+    std::vector<fs::path> programs;
+
+    for (auto &entry : fs::directory_iterator(corpus))
+    {
+        if (entry.path().extension() == ".tm")
+            programs.push_back(entry.path());
+    }
+
+    std::sort(programs.begin(), programs.end());
+
+    Baseline measured {baseline.tolerance, {}};
+    const auto &tol = baseline.tolerance;
+    int failures = 0;
+
+    std::cout << std::left << std::setw(16) << "program"
+              << std::right << std::setw(12) << "wall ms" << std::setw(12) << "base ms"
+              << std::setw(12) << "rss KB" << std::setw(12) << "base KB"
+              << std::setw(16) << "instructions" << "  status" << std::endl;
+
+    for (auto &program : programs)
+    {
+        auto name = program.stem().string();
+        auto input = program;
+        input.replace_extension(".in");
+
+        if (!fs::exists(input))
+            input = "/dev/null";
+
+        Measurement best;
+
+        for (int i = 0; i < repeat; ++i)
+        {
+            auto m = run(tomato, program, input);
+
+            if (i == 0)
+            {
+                best = m;
+                continue;
+            }
+
+            best.wall_ms = std::min(best.wall_ms, m.wall_ms);
+            best.max_rss_kb = std::min(best.max_rss_kb, m.max_rss_kb);
+
+            if (best.instructions && m.instructions)
+                best.instructions = std::min(*best.instructions, *m.instructions);
+        }
+
+        measured.programs[name] = best;
+
+        std::vector<std::string> problems;
+
+        if (!WIFEXITED(best.status) || WEXITSTATUS(best.status) != 0)
+            problems.emplace_back("abnormal exit");
+
+        auto expected = program;
+        expected.replace_extension(".out");
+
+        if (fs::exists(expected) && read_file(expected) != best.output)
+            problems.emplace_back("output mismatch");
+
+        auto base = baseline.programs.find(name);
+
+        if (update)
+        {
+            // baseline is being rewritten, only correctness matters
+        }
+        else if (base == baseline.programs.end())
+        {
+            problems.emplace_back("no baseline");
+        }
+        else
+        {
+            const auto &b = base->second;
+
+            if (best.wall_ms > b.wall_ms * tol.wall_time + tol.wall_time_slack_ms)
+                problems.emplace_back("wall time");
+
+            if (best.max_rss_kb > b.max_rss_kb * tol.max_rss + tol.max_rss_slack_kb)
+                problems.emplace_back("max rss");
+
+            if (best.instructions && b.instructions && *best.instructions > *b.instructions * tol.instructions)
+                problems.emplace_back("instructions");
+        }
+
+        std::string status = "ok";
+
+        if (!problems.empty())
+        {
+            status.clear();
+
+            for (auto &problem : problems)
+                status += (status.empty() ? "" : ", ") + problem;
+
+            failures += 1;
+        }
+
+        std::cout << std::left << std::setw(16) << name << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(12) << best.wall_ms
+                  << std::setw(12) << (base != baseline.programs.end() ? base->second.wall_ms : 0.0)
+                  << std::setw(12) << best.max_rss_kb
+                  << std::setw(12) << (base != baseline.programs.end() ? base->second.max_rss_kb : 0)
+                  << std::setw(16) << (best.instructions ? std::to_string(*best.instructions) : "n/a")
+                  << "  " << status << std::endl;
+    }
+
+    if (update && failures == 0)
+    {
+        write_baseline(baseline_path, measured);
+        std::cout << "Baseline written to '" << baseline_path.string() << "'" << std::endl;
+        return 0;
+    }
+
+    return failures == 0 ? 0 : 1;
+}
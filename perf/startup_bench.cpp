@@ -0,0 +1,106 @@
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "interpreter/interpreter.hpp"
+#include "syntax/parser.hpp"
+
+
+/**
+ * @brief Startup time benchmark.
+ *
+ * Generates a script defining many functions of which only a couple are
+ * called, and measures compilation and execution of it with function bodies
+ * parsed up front and deferred until the first call. Large sources are parsed
+ * on the thread pool, single parser is measured for comparison.
+ */
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+
+    std::string generate(int functions)
+    {
+        std::ostringstream script;
+
+        for (int i = 0; i < functions; ++i)
+        {
+            script << "func f" << i << "(n int) -> int\n"
+                   << "    var total = 0\n"
+                   << "    for k in 0..n do\n"
+                   << "        if k % 3 == 0 then total = total + k * " << i << " else total = total - 1 end\n"
+                   << "    end\n"
+                   << "    while total > 1000 do total = total - 1000 end\n"
+                   << "    return total\n"
+                   << "end\n";
+        }
+
+        script << "print f0(10) + f" << functions - 1 << "(10)\n";
+
+        return script.str();
+    }
+
+
+    using Compiler = std::function<std::shared_ptr<const Tomato::CompiledProgram>(const std::string &)>;
+
+
+    std::shared_ptr<const Tomato::CompiledProgram> single_parser(const std::string &source)
+    {
+        auto tree = std::make_shared<Tomato::Syntax::Program>();
+
+        Tomato::Syntax::Parser parser;
+        parser.set_text(source);
+        parser.parse_program(*tree);
+
+        return std::make_shared<const Tomato::CompiledProgram>(tree);
+    }
+
+
+    void measure(const std::string &name, const std::string &source, const Compiler &compile)
+    {
+        auto start = Clock::now();
+
+        auto program = compile(source);
+
+        auto compiled = Clock::now();
+
+        std::istringstream input;
+        std::ostringstream output;
+
+        Tomato::Interpreter interpreter(input, output);
+        interpreter.execute(*program);
+
+        auto executed = Clock::now();
+
+        using Milliseconds = std::chrono::duration<double, std::milli>;
+
+        std::cout << std::left << std::setw(16) << name << std::right << std::fixed << std::setprecision(1)
+                  << "compile " << std::setw(9) << Milliseconds(compiled - start).count() << " ms   "
+                  << "run " << std::setw(9) << Milliseconds(executed - compiled).count() << " ms"
+                  << std::endl;
+    }
+}
+
+
+int main(int argc, char *argv[])
+{
+    int functions = argc > 1 ? std::atoi(argv[1]) : 10000;
+
+    auto source = generate(functions);
+
+    std::cout << functions << " functions, " << source.size() / 1024 << " KiB of source" << std::endl;
+
+    measure("single parser", source, single_parser);
+    measure("eager", source, [] (const std::string &text) {
+        return Tomato::CompiledProgram::compile(text);
+    });
+    measure("deferred", source, [] (const std::string &text) {
+        return Tomato::CompiledProgram::compile(text, nullptr, true);
+    });
+
+    return 0;
+}
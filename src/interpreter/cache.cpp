@@ -0,0 +1,216 @@
+#include "cache.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "syntax/serializer.hpp"
+
+
+using namespace Tomato;
+
+
+namespace
+{
+    /**
+     * Bump on every change of syntax tree or its binary representation.
+     */
+    const uint32_t FormatVersion = 10;
+
+    const char Magic[4] = {'T', 'M', 'T', 'C'};
+
+    // Numbers temporary files of entries, interpreters of one process may store the same entry concurrently
+    std::atomic<unsigned long> temporaries {0};
+
+
+    struct Header
+    {
+        char magic[4];
+        uint32_t version;
+        uint64_t source_size;   // source text follows the header, hash naming the file only picks the slot
+        uint64_t payload_hash;
+        uint64_t payload_size;
+    };
+
+
+    class MappedFile
+    {
+    public:
+        explicit MappedFile(const std::string &path)
+        {
+            int fd = open(path.c_str(), O_RDONLY);
+
+            if (fd < 0)
+                return;
+
+            struct stat info {};
+
+            if (fstat(fd, &info) == 0 && info.st_size > 0)
+            {
+                void *address = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+
+                if (address != MAP_FAILED)
+                {
+                    data = static_cast<const char *>(address);
+                    size = static_cast<size_t>(info.st_size);
+                }
+            }
+
+            close(fd);
+        }
+
+        ~MappedFile()
+        {
+            if (data)
+                munmap(const_cast<char *>(data), size);
+        }
+
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+
+        const char *data = nullptr;
+        size_t size = 0;
+    };
+}
+
+
+CompilationCache::CompilationCache(const std::string &directory) : directory(directory) {}
+
+
+std::string CompilationCache::default_directory()
+{
+    if (auto dir = std::getenv("TOMATO_CACHE_DIR"))
+        return dir;
+
+    if (auto dir = std::getenv("XDG_CACHE_HOME"))
+        return std::string(dir) + "/tomato";
+
+    if (auto home = std::getenv("HOME"))
+        return std::string(home) + "/.cache/tomato";
+
+    return "";
+}
+
+
+uint64_t CompilationCache::hash(const char *data, size_t size, uint64_t seed)
+{
+    // FNV-1a
+    uint64_t hash = seed;
+
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 0x100000001b3ULL;
+    }
+
+    return hash;
+}
+
+
+std::string CompilationCache::path(const std::string &source, bool deferred) const
+{
+    auto key = hash(reinterpret_cast<const char *>(&FormatVersion), sizeof(FormatVersion),
+                    hash(source.data(), source.size()));
+
+    if (deferred)
+        key = hash("deferred", 8, key);
+
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.tmc", static_cast<unsigned long long>(key));
+
+    return directory + "/" + name;
+}
+
+
+std::shared_ptr<Syntax::Program> CompilationCache::load(const std::string &source, bool deferred) const
+{
+    if (directory.empty())
+        return nullptr;
+
+    MappedFile file(path(source, deferred));
+
+    if (!file.data || file.size < sizeof(Header))
+        return nullptr;
+
+    Header header {};
+    std::memcpy(&header, file.data, sizeof(Header));
+
+    if (std::memcmp(header.magic, Magic, sizeof(Magic)) != 0
+        || header.version != FormatVersion
+        || header.source_size != source.size()
+        || header.source_size > file.size - sizeof(Header))
+    {
+        return nullptr;
+    }
+
+    const char *text = file.data + sizeof(Header);
+    const char *payload = text + header.source_size;
+
+    if (std::memcmp(text, source.data(), source.size()) != 0
+        || header.payload_size != file.size - sizeof(Header) - header.source_size
+        || header.payload_hash != hash(payload, header.payload_size))
+    {
+        return nullptr;
+    }
+
+    try
+    {
+        return Syntax::Deserializer(payload, header.payload_size).program();
+    }
+    catch (Syntax::SerializationError &)
+    {
+        return nullptr;
+    }
+}
+
+
+void CompilationCache::store(const std::string &source, Syntax::Program &program, bool deferred) const
+{
+    if (directory.empty())
+        return;
+
+    std::string payload;
+    Syntax::Serializer(payload).serialize(program);
+
+    Header header {};
+    std::memcpy(header.magic, Magic, sizeof(Magic));
+    header.version = FormatVersion;
+    header.source_size = source.size();
+    header.payload_hash = hash(payload.data(), payload.size());
+    header.payload_size = payload.size();
+
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+
+    if (error)
+        return;
+
+    // Write to temporary file and rename, so concurrent readers never see partial entries
+    auto target = path(source, deferred);
+    auto temporary = target + "." + std::to_string(getpid()) + "." + std::to_string(temporaries++) + ".tmp";
+
+    {
+        std::ofstream file(temporary, std::ios::binary);
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        file.write(source.data(), static_cast<std::streamsize>(source.size()));
+        file.write(payload.data(), static_cast<std::streamsize>(payload.size()));
+
+        if (!file)
+        {
+            file.close();
+            std::remove(temporary.c_str());
+            return;
+        }
+    }
+
+    if (std::rename(temporary.c_str(), target.c_str()) != 0)
+        std::remove(temporary.c_str());
+}
@@ -0,0 +1,54 @@
+#ifndef TOMATO_CACHE_HPP
+#define TOMATO_CACHE_HPP
+
+
+#include <string>
+#include <memory>
+#include <cstdint>
+
+#include "syntax/syntax_tree.hpp"
+
+
+namespace Tomato
+{
+    /**
+     * @brief On-disk cache of compiled programs.
+     *
+     * Entries are keyed by hash of the source text and cache format version.
+     * Entry is mapped into memory on load and fully validated (header, source
+     * text stored in the entry, payload checksum, well-formed tree), any
+     * mismatch is treated as a cache miss.
+     */
+    class CompilationCache
+    {
+    public:
+        explicit CompilationCache(const std::string &directory);
+
+        /**
+         * @brief Default cache location: $TOMATO_CACHE_DIR, $XDG_CACHE_HOME/tomato or ~/.cache/tomato.
+         */
+        static std::string default_directory();
+
+        /**
+         * @param deferred Entry compiled with deferred function bodies, kept apart from fully parsed one.
+         * @return Cached program for given source or nullptr on cache miss.
+         */
+        std::shared_ptr<Syntax::Program> load(const std::string &source, bool deferred = false) const;
+
+        /**
+         * @brief Store compiled program, failures are silently ignored.
+         */
+        void store(const std::string &source, Syntax::Program &program, bool deferred = false) const;
+
+        static uint64_t hash(const char *data, size_t size, uint64_t seed = 0xcbf29ce484222325ULL);
+
+    private:
+        std::string path(const std::string &source, bool deferred) const;
+
+    private:
+        std::string directory;
+    };
+}
+
+
+#endif //TOMATO_CACHE_HPP
@@ -0,0 +1,85 @@
+#include "channel.hpp"
+
+#include "thread_pool.hpp"
+
+
+using namespace Tomato::Semantic;
+using namespace Tomato::Runtime;
+
+
+Channel::State::State(Semantic::Symbol element_type, size_t capacity) : element_type(element_type), ring(capacity) {}
+
+
+Channel::Channel(Semantic::Symbol type, std::shared_ptr<State> state, bool is_mutable)
+        : Object(type, is_mutable), state(std::move(state)) {}
+
+
+void Channel::assign(const Object &object)
+{
+    if (!is_mutable)
+        throw SemanticError("assigning to constant object");
+
+    try
+    {
+        state = dynamic_cast<const Channel &>(object).state;
+    }
+    catch (std::bad_cast &)
+    {
+        throw SemanticError("assigning different types");
+    }
+}
+
+std::shared_ptr<Object> Channel::clone()
+{
+    return std::make_shared<Channel>(type, state, is_mutable);
+}
+
+
+void Channel::send(std::shared_ptr<Object> object)
+{
+    if (object->type != state->element_type)
+        throw SemanticError("channel element type mismatch");
+
+    bool sent = false;
+
+    auto ready = [&] {
+        return state->closed.load() || (sent = state->ring.try_push(object));
+    };
+
+    if (!ready())
+        ThreadPool::shared().block(ready);
+
+    if (!sent)
+        throw SemanticError("sending to closed channel");
+}
+
+
+std::shared_ptr<Object> Channel::receive()
+{
+    std::shared_ptr<Object> object;
+
+    auto ready = [&] {
+        if (state->ring.try_pop(object))
+            return true;
+
+        // Objects sent before close are visible once close is, take the last ones
+        if (state->closed.load())
+        {
+            state->ring.try_pop(object);
+            return true;
+        }
+
+        return false;
+    };
+
+    if (!ready())
+        ThreadPool::shared().block(ready);
+
+    return object;
+}
+
+
+void Channel::close()
+{
+    state->closed = true;
+}
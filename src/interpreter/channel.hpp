@@ -0,0 +1,55 @@
+#ifndef TOMATO_CHANNEL_HPP
+#define TOMATO_CHANNEL_HPP
+
+
+#include <atomic>
+#include <memory>
+
+#include "object.hpp"
+#include "ring_buffer.hpp"
+
+
+namespace Tomato::Runtime
+{
+    /**
+     * @brief Bounded queue of objects passed between tasks, copies of the handle refer to the same queue.
+     *
+     * Send blocks while the channel is full, receive blocks while it is empty.
+     * After close, receivers get the remaining objects and then an end-of-channel mark.
+     */
+    class Channel : public Object
+    {
+    public:
+        struct State
+        {
+            State(Semantic::Symbol element_type, size_t capacity);
+
+            Semantic::Symbol element_type;
+            MpmcRing<std::shared_ptr<Object>> ring;
+            std::atomic<bool> closed {false};
+        };
+
+        Channel(Semantic::Symbol type, std::shared_ptr<State> state, bool is_mutable);
+
+        void assign(const Object &object) override;
+
+        std::shared_ptr<Object> clone() override;
+
+        /**
+         * @throw Semantic::SemanticError Channel is closed or holds objects of different type.
+         */
+        void send(std::shared_ptr<Object> object);
+
+        /**
+         * @return Received object, nullptr if channel is closed and empty.
+         */
+        std::shared_ptr<Object> receive();
+
+        void close();
+
+        std::shared_ptr<State> state;
+    };
+}
+
+
+#endif //TOMATO_CHANNEL_HPP
@@ -0,0 +1,953 @@
+#include "interpreter.hpp"
+
+#include <utility>
+#include <variant>
+
+
+using namespace Tomato;
+
+
+/**
+ * Translates syntax tree into closures executed by the interpreter they are compiled for.
+ *
+ * Closures do what visiting the same nodes does, in the same order and with the same errors,
+ * but dispatch on node kind happens once, during compilation. Names are still resolved when
+ * a closure runs, since functions see variables of their callers. Nodes of tasks, channels,
+ * generators and imports are rare, their closures visit them.
+ *
+ * Expressions are compiled into executable nodes, which give scalars without allocating objects
+ * when their consumer asks for a scalar type. Operations and assignments specialize themselves
+ * to the types they see first, and stay generic once a value of another type comes.
+ */
+class Interpreter::ClosureCompiler : private Syntax::Visitor
+{
+public:
+    explicit ClosureCompiler(Interpreter &context) : context(&context) {}
+
+    Closure statement(Syntax::ASTNode &node)
+    {
+        visit(node);
+
+        Closure result = std::exchange(closure, nullptr);
+
+        if (evaluator)
+            result = [value = std::exchange(evaluator, nullptr)] { value->evaluate(); };
+
+        return result;
+    }
+
+    /**
+     * @brief Names of functions inlined into closures compiled so far, which must not be redefined.
+     */
+    const std::set<std::string> &inlined() const
+    {
+        return inlined_functions;
+    }
+
+private:
+    // Specialization of node to scalar type, generic ones work with objects
+    enum class State { Uninitialized, Int, Float, Bool, Generic };
+
+    template<typename T>
+    static Semantic::Symbol scalar_type(const Interpreter *context)
+    {
+        if constexpr (std::is_same_v<T, int>)
+            return context->symbol_int;
+        else if constexpr (std::is_same_v<T, float>)
+            return context->symbol_float;
+        else if constexpr (std::is_same_v<T, bool>)
+            return context->symbol_bool;
+        else
+            return context->symbol_char;
+    }
+
+    static State specialization(const Interpreter *context, Semantic::Symbol type)
+    {
+        if (type == context->symbol_int)
+            return State::Int;
+
+        if (type == context->symbol_float)
+            return State::Float;
+
+        if (type == context->symbol_bool)
+            return State::Bool;
+
+        return State::Generic;
+    }
+
+    template<typename T>
+    static std::shared_ptr<Runtime::Object> box(const Interpreter *context, T value)
+    {
+        return std::make_shared<Runtime::Scalar<T>>(scalar_type<T>(context), value, false);
+    }
+
+    // Objects of builtin types are always scalars of the matching C++ type
+    template<typename T>
+    static bool unbox(const Interpreter *context, std::shared_ptr<Runtime::Object> result,
+                      T &value, std::shared_ptr<Runtime::Object> &object)
+    {
+        if (result->type != scalar_type<T>(context))
+        {
+            object = std::move(result);
+            return false;
+        }
+
+        value = static_cast<Runtime::Scalar<T> &>(*result).value;
+        return true;
+    }
+
+    /**
+     * Executable expression. Its scalar value may be asked for without an object: evaluate(value, object)
+     * gives true if the expression is of the asked type, otherwise false and the object it evaluated to.
+     */
+    class Node
+    {
+    public:
+        explicit Node(Interpreter *context) : context(context) {}
+        virtual ~Node() = default;
+
+        virtual std::shared_ptr<Runtime::Object> evaluate() = 0;
+
+        virtual bool evaluate(int &value, std::shared_ptr<Runtime::Object> &object)   { return unbox(context, evaluate(), value, object); }
+        virtual bool evaluate(float &value, std::shared_ptr<Runtime::Object> &object) { return unbox(context, evaluate(), value, object); }
+        virtual bool evaluate(bool &value, std::shared_ptr<Runtime::Object> &object)  { return unbox(context, evaluate(), value, object); }
+
+    protected:
+        Interpreter *context;
+    };
+
+    using NodePtr = std::shared_ptr<Node>;
+
+    class Generic : public Node
+    {
+    public:
+        Generic(Interpreter *context, Evaluator evaluator) : Node(context), evaluator(std::move(evaluator)) {}
+
+        using Node::evaluate;
+
+        std::shared_ptr<Runtime::Object> evaluate() override { return evaluator(); }
+
+    private:
+        Evaluator evaluator;
+    };
+
+    // Literal is converted once, every evaluation still gets its own object
+    template<typename T>
+    class Constant : public Node
+    {
+    public:
+        Constant(Interpreter *context, T value) : Node(context), value(value) {}
+
+        std::shared_ptr<Runtime::Object> evaluate() override { return box(context, value); }
+
+        bool evaluate(int &result, std::shared_ptr<Runtime::Object> &object) override   { return scalar(result, object); }
+        bool evaluate(float &result, std::shared_ptr<Runtime::Object> &object) override { return scalar(result, object); }
+        bool evaluate(bool &result, std::shared_ptr<Runtime::Object> &object) override  { return scalar(result, object); }
+
+    private:
+        template<typename U>
+        bool scalar(U &result, std::shared_ptr<Runtime::Object> &object)
+        {
+            if constexpr (std::is_same_v<T, U>)
+            {
+                result = value;
+                return true;
+            }
+            else
+            {
+                object = evaluate();
+                return false;
+            }
+        }
+
+        T value;
+    };
+
+    // Scalar variables are read in place
+    class Variable : public Node
+    {
+    public:
+        Variable(Interpreter *context, const std::string &name) : Node(context), name(name) {}
+
+        std::shared_ptr<Runtime::Object> evaluate() override { return slot(); }
+
+        bool evaluate(int &value, std::shared_ptr<Runtime::Object> &object) override   { return scalar(value, object); }
+        bool evaluate(float &value, std::shared_ptr<Runtime::Object> &object) override { return scalar(value, object); }
+        bool evaluate(bool &value, std::shared_ptr<Runtime::Object> &object) override  { return scalar(value, object); }
+
+        const std::shared_ptr<Runtime::Object> &slot() const
+        {
+            auto symbol = context->symtab.lookup(name);
+
+            for (const Interpreter *owner = context; owner; owner = owner->parent)
+            {
+                auto object = owner->memory.find(symbol);
+
+                if (object != owner->memory.end())
+                    return object->second;
+            }
+
+            throw Semantic::SemanticError(name + " does not name an object");
+        }
+
+    private:
+        template<typename T>
+        bool scalar(T &value, std::shared_ptr<Runtime::Object> &object)
+        {
+            auto &found = slot();
+
+            if (found->type != scalar_type<T>(context))
+            {
+                object = found;
+                return false;
+            }
+
+            value = static_cast<Runtime::Scalar<T> &>(*found).value;
+            return true;
+        }
+
+        const std::string &name;
+    };
+
+    /**
+     * Binary operation specialized to the operand types of its first evaluation. Specialized operation
+     * asks operands for scalars and computes without objects, until an operand of another type turns it
+     * into the generic one for good.
+     */
+    class Operation : public Node
+    {
+    public:
+        Operation(Interpreter *context, NodePtr left, NodePtr right, BinaryOperator operation, bool specialize)
+            : Node(context), left(std::move(left)), right(std::move(right)), operation(operation),
+              state(specialize ? State::Uninitialized : State::Generic) {}
+
+        std::shared_ptr<Runtime::Object> evaluate() override
+        {
+            Result result;
+            std::shared_ptr<Runtime::Object> l, r;
+
+            if (specialized(result, l, r))
+                return std::visit([this] (auto value) { return box(context, value); }, result);
+
+            return generic(*l, *r);
+        }
+
+        bool evaluate(int &value, std::shared_ptr<Runtime::Object> &object) override   { return scalar(value, object); }
+        bool evaluate(float &value, std::shared_ptr<Runtime::Object> &object) override { return scalar(value, object); }
+        bool evaluate(bool &value, std::shared_ptr<Runtime::Object> &object) override  { return scalar(value, object); }
+
+    private:
+        using Result = std::variant<int, float, bool>;
+
+        template<typename T>
+        bool scalar(T &value, std::shared_ptr<Runtime::Object> &object)
+        {
+            Result result;
+            std::shared_ptr<Runtime::Object> l, r;
+
+            if (!specialized(result, l, r))
+                return unbox(context, generic(*l, *r), value, object);
+
+            if (auto computed = std::get_if<T>(&result))
+            {
+                value = *computed;
+                return true;
+            }
+
+            object = std::visit([this] (auto value) { return box(context, value); }, result);
+            return false;
+        }
+
+        /**
+         * Compute result of specialized operation, otherwise give evaluated operands to the generic one.
+         */
+        bool specialized(Result &result, std::shared_ptr<Runtime::Object> &l, std::shared_ptr<Runtime::Object> &r)
+        {
+            switch (state)
+            {
+                case State::Int:
+                    if (operands<int>(result, l, r))
+                        return true;
+                    break;
+
+                case State::Float:
+                    if (operands<float>(result, l, r))
+                        return true;
+                    break;
+
+                case State::Bool:
+                    if (operands<bool>(result, l, r))
+                        return true;
+                    break;
+
+                default:
+                    l = left->evaluate();
+
+                    if (auto decided = context->short_circuit(operation, *l))
+                    {
+                        result = *decided;
+                        return true;
+                    }
+
+                    r = right->evaluate();
+
+                    if (state == State::Uninitialized)
+                        state = specialize(l->type, r->type);
+
+                    return false;
+            }
+
+            // operand of another type, the types are not stable
+            state = State::Generic;
+            return false;
+        }
+
+        template<typename T>
+        bool operands(Result &result, std::shared_ptr<Runtime::Object> &l, std::shared_ptr<Runtime::Object> &r)
+        {
+            T x, y;
+
+            if (!left->evaluate(x, l))
+            {
+                if (auto decided = context->short_circuit(operation, *l))
+                {
+                    result = *decided;
+                    return true;
+                }
+
+                r = right->evaluate();
+                return false;
+            }
+
+            if constexpr (std::is_same_v<T, bool>)
+            {
+                // 'and' and 'or' skip the right operand once the left one decides the result
+                if (x == (operation == BinaryOperator::Or) && operation != BinaryOperator::Xor)
+                {
+                    result = x;
+                    return true;
+                }
+            }
+
+            if (!right->evaluate(y, r))
+            {
+                l = box(context, x);
+                return false;
+            }
+
+            result = compute(x, y);
+            return true;
+        }
+
+        State specialize(Semantic::Symbol ltype, Semantic::Symbol rtype) const
+        {
+            bool logical = operation == BinaryOperator::And || operation == BinaryOperator::Or || operation == BinaryOperator::Xor;
+
+            if (ltype != rtype)
+                return State::Generic;
+
+            if (ltype == context->symbol_int && !logical)
+                return State::Int;
+
+            if (ltype == context->symbol_float && !logical && operation != BinaryOperator::Mod)
+                return State::Float;
+
+            if (ltype == context->symbol_bool && logical)
+                return State::Bool;
+
+            return State::Generic;
+        }
+
+        // The same functions builtin operations of Runtime::Operations call
+        Result compute(int l, int r) const
+        {
+            switch (operation)
+            {
+                case BinaryOperator::Plus:  return Runtime::Sum<int, int, int>(l, r);
+                case BinaryOperator::Minus: return Runtime::Sub<int, int, int>(l, r);
+                case BinaryOperator::Mul:   return Runtime::Mul<int, int, int>(l, r);
+                case BinaryOperator::Div:   return Runtime::Div<int, int, float>(l, r);
+                case BinaryOperator::Mod:   return Runtime::Mod<int, int, int>(l, r);
+                case BinaryOperator::Exp:   return Runtime::Exp<int, int, int>(l, r);
+                default:                    return compare(l, r);
+            }
+        }
+
+        Result compute(float l, float r) const
+        {
+            switch (operation)
+            {
+                case BinaryOperator::Plus:  return Runtime::Sum<float, float, float>(l, r);
+                case BinaryOperator::Minus: return Runtime::Sub<float, float, float>(l, r);
+                case BinaryOperator::Mul:   return Runtime::Mul<float, float, float>(l, r);
+                case BinaryOperator::Div:   return Runtime::Div<float, float, float>(l, r);
+                case BinaryOperator::Exp:   return Runtime::Exp<float, float, float>(l, r);
+                default:                    return compare(l, r);
+            }
+        }
+
+        Result compute(bool l, bool r) const
+        {
+            switch (operation)
+            {
+                case BinaryOperator::And: return Runtime::And<bool, bool>(l, r);
+                case BinaryOperator::Or:  return Runtime::Or<bool, bool>(l, r);
+                case BinaryOperator::Xor: return Runtime::Xor<bool, bool>(l, r);
+                default:                  throw std::logic_error("internal interpreter error");
+            }
+        }
+
+        template<typename T>
+        Result compare(T l, T r) const
+        {
+            switch (operation)
+            {
+                case BinaryOperator::EQ: return Runtime::EQ<T, T>(l, r);
+                case BinaryOperator::NE: return Runtime::NE<T, T>(l, r);
+                case BinaryOperator::LT: return Runtime::LT<T, T>(l, r);
+                case BinaryOperator::LE: return Runtime::LE<T, T>(l, r);
+                case BinaryOperator::GE: return Runtime::GE<T, T>(l, r);
+                case BinaryOperator::GT: return Runtime::GT<T, T>(l, r);
+                default:                 throw std::logic_error("internal interpreter error");
+            }
+        }
+
+        // Handler of the last operand types is kept, they rarely change
+        std::shared_ptr<Runtime::Object> generic(const Runtime::Object &l, const Runtime::Object &r)
+        {
+            if (!handler || handler_types != std::make_pair(l.type, r.type))
+            {
+                handler = &context->operations.lookup(l.type, operation, r.type);
+                handler_types = {l.type, r.type};
+            }
+
+            return (*handler)(l, r);
+        }
+
+        NodePtr left, right;
+        BinaryOperator operation;
+        State state;
+
+        const Runtime::BinaryOperation *handler = nullptr;
+        std::pair<Semantic::Symbol, Semantic::Symbol> handler_types;
+    };
+
+    /**
+     * Whether evaluation of expression never changes variables. A variable operand before it may then be
+     * read as a scalar, instead of by object read after the rest of operands were evaluated.
+     */
+    static bool unchanging(const Syntax::Expression &node)
+    {
+        if (dynamic_cast<const Syntax::Identifier *>(&node) || dynamic_cast<const Syntax::Literal *>(&node))
+            return true;
+
+        if (auto operation = dynamic_cast<const Syntax::BinaryOperation *>(&node))
+            return unchanging(*operation->left) && unchanging(*operation->right);
+
+        if (auto operation = dynamic_cast<const Syntax::UnaryOperation *>(&node))
+            return operation->operation != UnaryOperator::Unpack && unchanging(*operation->operand);
+
+        return false;
+    }
+
+    NodePtr expression(Syntax::Expression &node)
+    {
+        visit(node);
+        return std::exchange(evaluator, nullptr);
+    }
+
+    std::function<bool()> condition(Syntax::Expression &node)
+    {
+        return [value = expression(node)] {
+            bool result;
+            std::shared_ptr<Runtime::Object> object;
+
+            if (!value->evaluate(result, object))
+                throw Semantic::SemanticError("condition must be bool");
+
+            return result;
+        };
+    }
+
+    std::function<long long()> range_bound(Syntax::Expression &node)
+    {
+        return [value = expression(node)] {
+            int result;
+            std::shared_ptr<Runtime::Object> object;
+
+            if (!value->evaluate(result, object))
+                throw Semantic::SemanticError("range bounds and step must be int");
+
+            return static_cast<long long>(result);
+        };
+    }
+
+    std::vector<NodePtr> expressions(const std::vector<std::shared_ptr<Syntax::Expression>> &nodes)
+    {
+        std::vector<NodePtr> evaluators;
+
+        for (auto &node : nodes)
+            evaluators.push_back(expression(*node));
+
+        return evaluators;
+    }
+
+    static std::vector<std::shared_ptr<Runtime::Object>> evaluate(const std::vector<NodePtr> &evaluators)
+    {
+        std::vector<std::shared_ptr<Runtime::Object>> objects;
+        objects.reserve(evaluators.size());
+
+        for (auto &evaluator : evaluators)
+            objects.push_back(evaluator->evaluate());
+
+        return objects;
+    }
+
+    void generic(Evaluator evaluator)
+    {
+        this->evaluator = std::make_shared<Generic>(context, std::move(evaluator));
+    }
+
+    void visited(Syntax::Expression &node)
+    {
+        generic([context = context, &node] {
+            context->visit(node);
+            return std::move(context->temp);
+        });
+    }
+
+    void visited(Syntax::Statement &node)
+    {
+        closure = [context = context, &node] { context->visit(node); };
+    }
+
+    void process(Syntax::Program &node) override
+    {
+        std::vector<Closure> statements;
+
+        for (auto &statement : node.statements)
+            statements.push_back(this->statement(*statement));
+
+        closure = [statements = std::move(statements)] {
+            for (auto &statement : statements)
+                statement();
+        };
+    }
+
+    void process(Syntax::StatementBlock &node) override
+    {
+        std::vector<Closure> statements;
+
+        for (auto &statement : node.statements)
+            statements.push_back(this->statement(*statement));
+
+        closure = [context = context, statements = std::move(statements)] {
+            context->symtab.push_scope();
+
+            try
+            {
+                for (auto &statement : statements)
+                    statement();
+            }
+            catch (...)
+            {
+                context->symtab.pop_scope();
+                throw;
+            }
+
+            context->symtab.pop_scope();
+        };
+    }
+
+    void process(Syntax::ValueDeclaration &node) override
+    {
+        auto init = node.init ? expression(*node.init) : nullptr;
+
+        closure = [context = context, &node, init = std::move(init)] {
+            auto symbol = context->symtab.define(node.value->name);
+            context->declare(node, symbol, init ? init->evaluate() : nullptr);
+        };
+    }
+
+    /**
+     * Store scalar source into scalar variable of the same type in place.
+     * @return false with the source object, if any of them is of another type or the variable is constant.
+     */
+    template<typename T>
+    static bool store(const Interpreter *context, Node &source, Variable &destination, std::shared_ptr<Runtime::Object> &object)
+    {
+        T value;
+
+        if (!source.evaluate(value, object))
+            return false;
+
+        auto &target = destination.slot();
+
+        if (target->type != scalar_type<T>(context) || !target->is_mutable)
+        {
+            object = box(context, value);
+            return false;
+        }
+
+        static_cast<Runtime::Scalar<T> &>(*target).value = value;
+        return true;
+    }
+
+    void process(Syntax::Assignment &node) override
+    {
+        auto identifier = dynamic_cast<Syntax::Identifier *>(node.destination.get());
+
+        if (!identifier)
+        {
+            closure = [source = expression(*node.source), destination = expression(*node.destination)] {
+                auto value = source->evaluate();
+                auto target = destination->evaluate();
+
+                if (target.use_count() == 1)
+                    throw Semantic::SemanticError("assigning to rvalue expression");
+
+                target->assign(*value);
+            };
+
+            return;
+        }
+
+        // Assignment to variable specializes to the type of its first source, variable is never rvalue
+        closure = [context = context, source = expression(*node.source),
+                   destination = std::make_shared<Variable>(context, identifier->name),
+                   state = State::Uninitialized] () mutable {
+            std::shared_ptr<Runtime::Object> value;
+
+            switch (state)
+            {
+                case State::Int:
+                    if (store<int>(context, *source, *destination, value))
+                        return;
+                    break;
+
+                case State::Float:
+                    if (store<float>(context, *source, *destination, value))
+                        return;
+                    break;
+
+                case State::Bool:
+                    if (store<bool>(context, *source, *destination, value))
+                        return;
+                    break;
+
+                default:
+                    value = source->evaluate();
+                    break;
+            }
+
+            state = state == State::Uninitialized ? specialization(context, value->type) : State::Generic;
+
+            destination->slot()->assign(*value);
+        };
+    }
+
+    void process(Syntax::Identifier &node) override
+    {
+        evaluator = std::make_shared<Variable>(context, node.name);
+    }
+
+    void process(Syntax::Literal &node) override
+    {
+        try
+        {
+            switch (node.type)
+            {
+                case Syntax::Literal::Type::Integer:
+                    evaluator = std::make_shared<Constant<int>>(context, std::stoi(node.lexeme));
+                    return;
+
+                case Syntax::Literal::Type::Float:
+                    evaluator = std::make_shared<Constant<float>>(context, std::stof(node.lexeme));
+                    return;
+
+                case Syntax::Literal::Type::Boolean:
+                    evaluator = std::make_shared<Constant<bool>>(context, node.lexeme == "true");
+                    return;
+
+                case Syntax::Literal::Type::Character:
+                    evaluator = std::make_shared<Constant<char>>(context, node.lexeme[1]);
+                    return;
+
+                default:
+                    break;
+            }
+        }
+        catch (std::logic_error &) {}
+
+        // error is reported when literal is evaluated
+        visited(node);
+    }
+
+    void process(Syntax::BinaryOperation &node) override
+    {
+        // Left operand read as scalar mustn't miss changes made by the right one
+        evaluator = std::make_shared<Operation>(context, expression(*node.left), expression(*node.right),
+                                                node.operation, unchanging(*node.right));
+    }
+
+    void process(Syntax::UnaryOperation &node) override
+    {
+        generic([context = context, operand = expression(*node.operand), operation = node.operation] {
+            auto value = operand->evaluate();
+            return context->operations.lookup(operation, value->type)(*value);
+        });
+    }
+
+    void process(Syntax::ConditionalStatement &node) override
+    {
+        auto then_case = statement(*node.then_case);
+        auto else_case = node.else_case ? statement(*node.else_case) : nullptr;
+
+        closure = [condition = condition(*node.condition), then_case = std::move(then_case), else_case = std::move(else_case)] {
+            if (condition())
+                then_case();
+            else if (else_case)
+                else_case();
+        };
+    }
+
+    void process(Syntax::ConditionalLoop &node) override
+    {
+        closure = [condition = condition(*node.condition), body = statement(*node.body)] {
+            while (condition())
+                body();
+        };
+    }
+
+    void process(Syntax::RangeLoop &node) override
+    {
+        auto begin = range_bound(*node.begin);
+        auto end = range_bound(*node.end);
+        auto step = node.step ? range_bound(*node.step) : nullptr;
+
+        closure = [context = context, begin = std::move(begin), end = std::move(end), step = std::move(step),
+                   &name = node.counter->name, body = statement(*node.body)] {
+            long long first = begin();
+            long long last = end();
+            long long increment = step ? step() : 1;
+
+            if (increment == 0)
+                throw Semantic::SemanticError("range step must not be zero");
+
+            context->symtab.push_scope();
+
+            auto counter_sym = context->symtab.define(name);
+            auto counter = std::make_shared<Runtime::Scalar<int>>(context->symbol_int, 0, false);
+
+            context->memory[counter_sym] = counter;
+
+            try
+            {
+                for (long long i = first; increment > 0 ? i < last : i > last; i += increment)
+                {
+                    counter->value = static_cast<int>(i);
+                    body();
+                }
+            }
+            catch (...)
+            {
+                context->memory.erase(counter_sym);
+                context->symtab.pop_scope();
+                throw;
+            }
+
+            context->memory.erase(counter_sym);
+            context->symtab.pop_scope();
+        };
+    }
+
+    void process(Syntax::PrintStatement &node) override
+    {
+        closure = [context = context, value = expression(*node.expression)] {
+            context->print(*value->evaluate());
+        };
+    }
+
+    void process(Syntax::ReadStatement &node) override
+    {
+        closure = [context = context, value = expression(*node.expression)] {
+            context->read(*value->evaluate());
+        };
+    }
+
+    void process(Syntax::ReturnStatement &node) override
+    {
+        closure = [value = expression(*node.expression)] {
+            throw FunctionReturn {value->evaluate()};
+        };
+    }
+
+    void process(Syntax::Call &node) override
+    {
+        generic([context = context, &node, arguments = expressions(node.arguments)] {
+            auto function = context->callee(node);
+
+            // Arguments are evaluated in the scope of caller
+            return context->call(function, evaluate(arguments));
+        });
+    }
+
+    void process(Syntax::InlinedCall &node) override
+    {
+        inlined_functions.insert(node.function->identifier->name);
+
+        // Speculation already failed, the call is compiled as it was written
+        if (!context->inlining_holds(node))
+        {
+            process(*node.call);
+            return;
+        }
+
+        std::vector<Closure> statements;
+
+        if (node.body)
+        {
+            for (auto &statement : node.body->statements)
+                statements.push_back(this->statement(*statement));
+        }
+
+        auto result = node.result ? expression(*node.result) : nullptr;
+
+        generic([context = context, &node, arguments = expressions(node.call->arguments),
+                     statements = std::move(statements), result = std::move(result)] {
+            // Deoptimization: the call is evaluated by the visitor from its arguments on
+            if (!context->inlining_holds(node))
+            {
+                ++context->deoptimizations;
+                context->visit(*node.call);
+
+                return std::move(context->temp);
+            }
+
+            auto &function = *node.function;
+            auto values = evaluate(arguments);
+
+            std::shared_ptr<Runtime::Object> value;
+
+            // The same scopes as invoke() and the body block have
+            size_t scopes = 0;
+
+            try
+            {
+                context->symtab.push_scope();
+                ++scopes;
+
+                context->bind(function, values);
+
+                if (node.body)
+                {
+                    context->symtab.push_scope();
+                    ++scopes;
+
+                    for (auto &statement : statements)
+                        statement();
+                }
+
+                if (result)
+                {
+                    value = result->evaluate();
+
+                    if (value->type != context->symtab.lookup(function.return_type->name))
+                        throw Semantic::SemanticError("function's return type mismatch");
+                }
+                else
+                {
+                    value = std::make_shared<Runtime::Scalar<bool>>(context->symbol_bool, true, false);
+                }
+            }
+            catch (...)
+            {
+                for (; scopes > 0; --scopes)
+                    context->symtab.pop_scope();
+
+                throw;
+            }
+
+            for (; scopes > 0; --scopes)
+                context->symtab.pop_scope();
+
+            return value;
+        });
+    }
+
+    void process(Syntax::Function        &node) override { visited(node); }
+    void process(Syntax::Spawn           &node) override { visited(node); }
+    void process(Syntax::Join            &node) override { visited(node); }
+    void process(Syntax::MakeChannel     &node) override { visited(node); }
+    void process(Syntax::Receive         &node) override { visited(node); }
+    void process(Syntax::ForEachLoop     &node) override { visited(node); }
+    void process(Syntax::ParallelLoop    &node) override { visited(node); }
+    void process(Syntax::SendStatement   &node) override { visited(node); }
+    void process(Syntax::CloseStatement  &node) override { visited(node); }
+    void process(Syntax::YieldStatement  &node) override { visited(node); }
+    void process(Syntax::ImportStatement &node) override { visited(node); }
+
+private:
+    Interpreter *context;
+
+    // result of the last node compiled, closure for statements and evaluator for expressions
+    Closure closure;
+    NodePtr evaluator;
+
+    std::set<std::string> inlined_functions;
+};
+
+
+Interpreter::Closure Interpreter::compile(Syntax::ASTNode &node)
+{
+    return ClosureCompiler(*this).statement(node);
+}
+
+void Interpreter::run_statement(Syntax::ASTNode &node)
+{
+    if (closures)
+        compile(node)();
+    else
+        visit(node);
+}
+
+void Interpreter::run_body(const std::shared_ptr<Syntax::StatementBlock> &body)
+{
+    if (!closures)
+    {
+        visit(*body);
+        return;
+    }
+
+    auto &compiled = bodies[body.get()];
+
+    if (!compiled.closure)
+    {
+        ClosureCompiler compiler(*this);
+        auto closure = compiler.statement(*body);
+
+        compiled = {body, std::make_shared<const Closure>(std::move(closure)), compiler.inlined()};
+    }
+
+    // redefinition of an inlined function during the call drops compiled body, but not this reference
+    auto closure = compiled.closure;
+    (*closure)();
+}
+
+void Interpreter::run_hot_loop(Syntax::ConditionalLoop &node)
+{
+    auto &compiled = hot_loops[&node];
+
+    // address of a freed loop may be reused by another one, the body kept alive tells them apart
+    if (!compiled.closure || compiled.block != node.body)
+    {
+        ClosureCompiler compiler(*this);
+        auto closure = compiler.statement(node);
+
+        compiled = {node.body, std::make_shared<const Closure>(std::move(closure)), compiler.inlined()};
+        ++hot_loops_compiled;
+    }
+
+    auto closure = compiled.closure;
+    (*closure)();
+}
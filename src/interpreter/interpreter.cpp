@@ -1,127 +1,395 @@
 #include "interpreter.hpp"
 
+#include <algorithm>
+#include <cstdlib>
 #include <iostream>
 #include <iomanip>
-
-#include <readline/readline.h>
-#include <readline/history.h>
+#include <limits>
 
 #include "syntax/parser.hpp"
 #include "syntax/printer.hpp"
+#include "semantic/effects.hpp"
+#include "thread_pool.hpp"
 
 
 using namespace Tomato;
 
 
-struct FunctionReturn
+/**
+ * Memoized function keeps a direct-mapped table of results keyed by bytes of
+ * argument values, so its memory is bounded: a colliding call replaces the entry.
+ */
+static const size_t MemoCapacity = 4096;
+
+struct Interpreter::MemoTable
+{
+    struct Entry
+    {
+        std::string key;
+        std::shared_ptr<Runtime::Object> result;    // nullptr if entry is empty
+    };
+
+    std::shared_ptr<Syntax::Function> function;
+    std::set<std::string> reads;                    // names the results depend on
+
+    bool checked = false;
+    std::string impurity;
+
+    // Callee was shadowed by another function, cached results stay valid only if nothing is cached
+    bool redefined = false;
+
+    std::vector<Entry> entries;                     // allocated on the first stored result
+
+    size_t calls = 0;
+    size_t hits = 0;
+};
+
+
+/**
+ * Appends type and value of scalar object to the key.
+ * @return false if object is not a scalar.
+ */
+template<typename T>
+static bool append_key(const Runtime::Object &object, std::string &key)
+{
+    auto scalar = dynamic_cast<const Runtime::Scalar<T> *>(&object);
+
+    if (!scalar)
+        return false;
+
+    key.append(reinterpret_cast<const char *>(&object.type), sizeof(object.type));
+    key.append(reinterpret_cast<const char *>(&scalar->value), sizeof(scalar->value));
+
+    return true;
+}
+
+static bool memo_key(const std::vector<std::shared_ptr<Runtime::Object>> &arguments, std::string &key)
+{
+    for (auto &argument : arguments)
+    {
+        if (!append_key<int>(*argument, key) && !append_key<float>(*argument, key)
+            && !append_key<bool>(*argument, key) && !append_key<char>(*argument, key))
+            return false;
+    }
+
+    return true;
+}
+
+
+/**
+ * Object for a new binding: a temporary nobody else refers to is taken as it is,
+ * object of a variable, cache or any other holder is copied.
+ */
+static std::shared_ptr<Runtime::Object> own(std::shared_ptr<Runtime::Object> object)
+{
+    if (object.use_count() == 1)
+        return object;
+
+    return object->clone();
+}
+
+
+/**
+ * Generator keeps its state on the heap: own context with its variables and
+ * an explicit stack of statements being executed. Every statement which may
+ * contain yield (blocks, conditions and loops) is a step of that stack, the
+ * other statements are executed by regular visiting.
+ */
+struct Interpreter::GeneratorFrame : Runtime::Generator::State
 {
-    std::shared_ptr<Runtime::Object> object;
+    struct Step
+    {
+        Syntax::ASTNode *node = nullptr;
+
+        bool started = false;
+        size_t index = 0;                               // next statement of block
+
+        long long current = 0, end = 0, step = 0;       // range loop
+        std::shared_ptr<Runtime::Scalar<int>> counter = nullptr;
+
+        Semantic::Symbol variable = 0;                  // range and for-each loops
+        Iterator source = nullptr;                      // for-each loop
+    };
+
+    std::unique_ptr<Interpreter> context;
+    std::shared_ptr<Syntax::StatementBlock> body;
+    std::vector<Step> stack;
+
+    std::atomic<bool> running {false};   // resumed through a channel by two threads at once, one of them fails
+    bool finished = false;
+
+    std::shared_ptr<Runtime::Object> next() override
+    {
+        return context->resume(*this);
+    }
 };
 
 
+/**
+ * Parallel loop range is split into fixed number of chunks regardless of
+ * number of threads, so reductions are merged in the same order on every run.
+ */
+static const long long ParallelChunks = 64;
+
+
 Interpreter::Interpreter(std::istream &istream, std::ostream &ostream) : istream(istream), ostream(ostream)
 {
     symbol_int = symtab.define("int");
     symbol_float = symtab.define("float");
     symbol_bool = symtab.define("bool");
     symbol_char = symtab.define("char");
+    symbol_task = symtab.define("task");
+    symbol_channel = symtab.define("channel");
+    symbol_generator = symtab.define("generator");
 
-    types = {symbol_int, symbol_float, symbol_bool, symbol_char};
+    types = {symbol_int, symbol_float, symbol_bool, symbol_char, symbol_task, symbol_channel, symbol_generator};
 
     operations.init_builtins(symbol_int, symbol_float, symbol_bool, symbol_char);
+
+    if (auto engine = std::getenv("TOMATO_ENGINE"))
+        closures = std::string(engine) == "closures";
+
+    if (auto iterations = std::getenv("TOMATO_HOT_LOOP"))
+        hot_loop = std::strtoul(iterations, nullptr, 10);
 }
 
 
-void Interpreter::run()
+Interpreter::Interpreter(const Interpreter &origin, const Interpreter *parent)
+        : istream(origin.istream), ostream(origin.ostream),
+          symbol_int(origin.symbol_int), symbol_float(origin.symbol_float),
+          symbol_bool(origin.symbol_bool), symbol_char(origin.symbol_char),
+          symbol_task(origin.symbol_task), symbol_channel(origin.symbol_channel),
+          symbol_generator(origin.symbol_generator),
+          symtab(origin.symtab), operations(origin.operations), types(origin.types),
+          memoize_all(origin.memoize_all), closures(origin.closures), hot_loop(origin.hot_loop),
+          redefined(origin.redefined),
+          module_path(origin.module_path), modules(origin.modules),
+          io_mutex(origin.io_mutex), parent(parent)
 {
-    Syntax::Parser parser;
+}
 
-    const char * const primary_prompt = ">>> ";
-    const char * const append_prompt = "... ";
 
-    const char * prompt = primary_prompt;
+void Interpreter::interpret(std::istream &file)
+{
+    std::string code((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
 
-    std::string statement;
+    std::shared_ptr<const CompiledProgram> program;
+    std::string syntax_error;
 
-    while (true)
+    try
     {
-        char * line = readline(prompt);
-
-        if (line == nullptr) // EOF reached
-        {
-            ostream << std::endl;
-            break;
-        }
-        else if (line[0] == '\0') // Line is empty
-        {
-            continue;
-        }
+        program = CompiledProgram::compile(code, cache.get(), defer_bodies, optimize);
+    }
+    catch (Syntax::SyntaxError &error)
+    {
+        // statements before the error are still executed
+        syntax_error = error.what();
 
-        using namespace std::string_literals;
-        statement += " "s + line;
-        add_history(line);
-        free(line);
+        auto partial = std::make_shared<Syntax::Program>();
 
-        parser.set_text(statement);
+        Syntax::Parser parser;
+        parser.defer_function_bodies(defer_bodies);
+        parser.set_text(code);
 
         try
         {
-            auto tree = parser.parse();
-            visit(*tree);
+            parser.parse_program(*partial);
         }
-        catch (Syntax::SyntaxError &error)
+        catch (Syntax::SyntaxError &) {}
+
+        program = std::make_shared<const CompiledProgram>(partial);
+    }
+
+    try
+    {
+        execute(*program);
+    }
+    catch (Semantic::SemanticError &error)
+    {
+        ostream << "semantic error: " << error.what() << std::endl;
+        return;
+    }
+    catch (Syntax::SyntaxError &error)
+    {
+        // deferred function body turned out to be malformed
+        ostream << "syntax error: " << error.what() << std::endl;
+        return;
+    }
+
+    if (!syntax_error.empty())
+    {
+        ostream << "syntax error: " << syntax_error << std::endl;
+    }
+}
+
+
+void Interpreter::interpret_stream(std::istream &source)
+{
+    Syntax::Parser parser;
+    parser.defer_function_bodies(defer_bodies);
+
+    std::string text; // lines of the statements being parsed
+
+    // blocks and parenthesized parts pull their lines themselves, so statements are never parsed twice
+    parser.set_input([&source, &text] (std::string &line) {
+        if (!std::getline(source, line))
+            return false;
+
+        text += "\n" + line;
+        return true;
+    });
+
+    std::string line;
+    bool more = true;
+
+    while (more)
+    {
+        more = static_cast<bool>(std::getline(source, line));
+
+        if (more)
+            text += line;
+
+        parser.set_text(text);
+
+        while (true)
         {
-            if (parser.eof()) // unexpected EOF, try read more lines
+            std::shared_ptr<Syntax::ASTNode> statement;
+            auto start = parser.offset();
+
+            try
+            {
+                if (parser.eof())
+                {
+                    text.clear();
+                    break;
+                }
+
+                statement = parser.parse();
+            }
+            catch (Syntax::SyntaxError &error)
             {
-                prompt = append_prompt;
-                continue;
+                // statement continued on the next line at the top level, e.g. after binary operator
+                if (parser.eof() && more)
+                {
+                    text = text.substr(start) + "\n";
+                    break;
+                }
+
+                ostream << "syntax error: " << error.what() << std::endl;
+                return;
             }
 
-            std::cout << "syntax error: " << error.what() << std::endl;
-        }
-        catch (Semantic::SemanticError &error)
-        {
-            std::cout << "semantic error: " << error.what() << std::endl;
+            try
+            {
+                run_statement(*statement);
+            }
+            catch (Semantic::SemanticError &error)
+            {
+                ostream << "semantic error: " << error.what() << std::endl;
+                return;
+            }
+            catch (Syntax::SyntaxError &error)
+            {
+                ostream << "syntax error: " << error.what() << std::endl;
+                return;
+            }
         }
-
-        prompt = primary_prompt;
-        statement.clear();
     }
 }
 
 
-void Interpreter::interpret(std::istream &file)
+void Interpreter::execute(const CompiledProgram &program)
 {
-    std::string code((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    for (auto &statement : program.program->statements)
+        run_statement(*statement);
+}
+
+
+void Interpreter::enable_cache(const std::string &directory)
+{
+    cache = std::make_unique<CompilationCache>(directory);
+}
+
+
+void Interpreter::add_module_path(const std::string &directory)
+{
+    module_path.insert(module_path.begin(), directory);
+}
+
+
+void Interpreter::defer_function_bodies(bool defer)
+{
+    defer_bodies = defer;
+}
+
+void Interpreter::inline_functions(bool enable)
+{
+    optimize = enable;
+}
+
+void Interpreter::compile_closures(bool enable)
+{
+    closures = enable;
+}
+
+void Interpreter::compile_hot_loops(size_t iterations)
+{
+    hot_loop = iterations;
+}
+
 
-    Syntax::Parser parser;
-    parser.set_text(code);
 
-    while (!parser.eof())
+std::shared_ptr<Runtime::Object> Interpreter::object(Semantic::Symbol symbol) const
+{
+    for (auto context = this; context; context = context->parent)
     {
-        try
-        {
-            auto tree = parser.parse();
-            visit(*tree);
-        }
-        catch (Syntax::SyntaxError &error)
-        {
-            std::cout << "syntax error: " << error.what() << std::endl;
-            break;
-        }
-        catch (Semantic::SemanticError &error)
+        auto object = context->memory.find(symbol);
+
+        if (object != context->memory.end())
+            return object->second;
+    }
+
+    return nullptr;
+}
+
+std::shared_ptr<Syntax::Function> Interpreter::function(Semantic::Symbol symbol) const
+{
+    for (auto context = this; context; context = context->parent)
+    {
+        auto function = context->functions.find(symbol);
+
+        if (function != context->functions.end())
+            return function->second;
+    }
+
+    return nullptr;
+}
+
+std::shared_ptr<Syntax::Function> Interpreter::function(const std::string &name)
+{
+    if (auto symbol = symtab.find(name))
+        return function(*symbol);
+
+    // Unused functions of a library cost nothing, the first module defining the name wins
+    for (auto &module : modules)
+    {
+        if (auto func = module->function(name))
         {
-            std::cout << "semantic error: " << error.what() << std::endl;
-            break;
+            functions[symtab.define_global(name)] = func;
+            return func;
         }
     }
-}
 
+    throw Semantic::SemanticError("undefined reference to '" + name + "'");
+}
 
 
 void Interpreter::process(Syntax::Program &node)
 {
-    throw std::runtime_error("this feature is not implemented");
+    for (auto &statement : node.statements)
+    {
+        visit(*statement);
+    }
 }
 
 void Interpreter::process(Syntax::ValueDeclaration &node)
@@ -129,9 +397,15 @@ void Interpreter::process(Syntax::ValueDeclaration &node)
     auto var_sym = symtab.define(node.value->name);
 
     if (node.init)
-    {
         visit(*node.init);
 
+    declare(node, var_sym, node.init ? std::move(temp) : nullptr);
+}
+
+void Interpreter::declare(Syntax::ValueDeclaration &node, Semantic::Symbol var_sym, std::shared_ptr<Runtime::Object> init)
+{
+    if (init)
+    {
         if (node.type)
         {
             auto type_sym = symtab.lookup(node.type->name);
@@ -141,14 +415,14 @@ void Interpreter::process(Syntax::ValueDeclaration &node)
                 throw Semantic::SemanticError(node.type->name + " does not name a type");
             }
 
-            if (type_sym != temp->type)
+            if (type_sym != init->type)
             {
                 throw Semantic::SemanticError("specified type doesn't match initializer");
             }
         }
 
-        memory[var_sym] = temp->clone();
-        memory[var_sym]->is_mutable = !node.constant;
+        auto &value = memory[var_sym] = own(std::move(init));
+        value->is_mutable = !node.constant;
     }
     else if (node.type)
     {
@@ -205,14 +479,10 @@ void Interpreter::process(Syntax::Identifier &node)
 {
     auto var_sym = symtab.lookup(node.name);
 
-    try
-    {
-        temp = memory.at(var_sym);
-    }
-    catch (std::out_of_range &)
-    {
+    temp = object(var_sym);
+
+    if (!temp)
         throw Semantic::SemanticError(node.name + " does not name an object");
-    }
 }
 
 void Interpreter::process(Syntax::Literal &node)
@@ -245,12 +515,32 @@ void Interpreter::process(Syntax::BinaryOperation &node)
     visit(*node.left);
     auto left = temp;
 
+    // 'and' and 'or' skip the right operand once bool left one decides the result
+    if (auto decided = short_circuit(node.operation, *left))
+    {
+        temp = std::make_shared<Runtime::Scalar<bool>>(symbol_bool, *decided, false);
+        return;
+    }
+
     visit(*node.right);
     auto right = temp;
 
     temp = operations.lookup(left->type, node.operation, right->type)(*left, *right);
 }
 
+std::optional<bool> Interpreter::short_circuit(BinaryOperator operation, const Runtime::Object &left) const
+{
+    if ((operation != BinaryOperator::And && operation != BinaryOperator::Or) || left.type != symbol_bool)
+        return std::nullopt;
+
+    bool value = static_cast<const Runtime::Scalar<bool> &>(left).value;
+
+    if (value != (operation == BinaryOperator::Or))
+        return std::nullopt;
+
+    return value;
+}
+
 void Interpreter::process(Syntax::UnaryOperation &node)
 {
     visit(*node.operand);
@@ -258,22 +548,23 @@ void Interpreter::process(Syntax::UnaryOperation &node)
     temp = operations.lookup(node.operation, temp->type)(*temp);
 }
 
-void Interpreter::process(Syntax::ConditionalStatement &node)
+bool Interpreter::condition(Syntax::Expression &expression)
 {
-    visit(*node.condition);
-
-    bool cond;
+    visit(expression);
 
     try
     {
-        cond = dynamic_cast<Runtime::Scalar<bool>&>(*temp).value;
+        return dynamic_cast<Runtime::Scalar<bool> &>(*temp).value;
     }
     catch (std::bad_cast &)
     {
         throw Semantic::SemanticError("condition must be bool");
     }
+}
 
-    if (cond)
+void Interpreter::process(Syntax::ConditionalStatement &node)
+{
+    if (condition(*node.condition))
         visit(*node.then_case);
     else if (node.else_case)
         visit(*node.else_case);
@@ -281,154 +572,1149 @@ void Interpreter::process(Syntax::ConditionalStatement &node)
 
 void Interpreter::process(Syntax::ConditionalLoop &node)
 {
-    bool cond;
+    size_t iterations = 0;
 
-    while (true)
+    while (condition(*node.condition))
     {
-        visit(*node.condition);
+        visit(*node.body);
 
-        try
-        {
-            cond = dynamic_cast<Runtime::Scalar<bool> &>(*temp).value;
-        }
-        catch (std::bad_cast &)
+        // On-stack replacement: state of the loop is all in memory, compiled loop goes on from the next condition check
+        if (++iterations == hot_loop)
         {
-            throw Semantic::SemanticError("condition must be bool");
+            run_hot_loop(node);
+            return;
         }
-
-        if (cond)
-            visit(*node.body);
-        else
-            break;
     }
 }
 
-void Interpreter::process(Syntax::PrintStatement &node)
+long long Interpreter::range_bound(Syntax::Expression &expression)
 {
-    visit(*node.expression);
+    visit(expression);
 
-    try
-    {
-        if (temp->type == symbol_int)
-            ostream << dynamic_cast<Runtime::Scalar<int> &>(*temp).value << std::endl;
-        else if (temp->type == symbol_float)
-            ostream << dynamic_cast<Runtime::Scalar<float> &>(*temp).value << std::endl;
-        else if (temp->type == symbol_bool)
-            ostream << std::boolalpha << dynamic_cast<Runtime::Scalar<bool> &>(*temp).value << std::endl;
-        else if (temp->type == symbol_char)
-            ostream << dynamic_cast<Runtime::Scalar<char> &>(*temp).value << std::endl;
-        else
-            throw std::logic_error("internal interpretation error");
-    }
-    catch (std::bad_cast &)
-    {
-        throw std::logic_error("internal interpretation error");
-    }
+    if (temp->type != symbol_int)
+        throw Semantic::SemanticError("range bounds and step must be int");
+
+    return dynamic_cast<Runtime::Scalar<int> &>(*temp).value;
 }
 
-void Interpreter::process(Syntax::ReadStatement &node)
+void Interpreter::process(Syntax::RangeLoop &node)
 {
-    visit(*node.expression);
+    long long begin = range_bound(*node.begin);
+    long long end = range_bound(*node.end);
+    long long step = node.step ? range_bound(*node.step) : 1;
+
+    if (step == 0)
+        throw Semantic::SemanticError("range step must not be zero");
+
+    // Counter is a single constant object updated in place, loop itself runs on native integer
+    symtab.push_scope();
+
+    auto counter_sym = symtab.define(node.counter->name);
+    auto counter = std::make_shared<Runtime::Scalar<int>>(symbol_int, 0, false);
+
+    memory[counter_sym] = counter;
 
     try
     {
-        if (temp->type == symbol_int)
-            istream >> dynamic_cast<Runtime::Scalar<int> &>(*temp).value;
-        else if (temp->type == symbol_float)
-            istream >> dynamic_cast<Runtime::Scalar<float> &>(*temp).value;
-        else if (temp->type == symbol_bool)
-            istream >> dynamic_cast<Runtime::Scalar<bool> &>(*temp).value;
-        else if (temp->type == symbol_char)
-            istream >> dynamic_cast<Runtime::Scalar<char> &>(*temp).value;
+        for (long long i = begin; step > 0 ? i < end : i > end; i += step)
+        {
+            counter->value = static_cast<int>(i);
+            visit(*node.body);
+        }
     }
-    catch (std::bad_cast &)
+    catch (...)
     {
-        throw std::logic_error("internal interpretation error");
+        memory.erase(counter_sym);
+        symtab.pop_scope();
+        throw;
     }
+
+    memory.erase(counter_sym);
+    symtab.pop_scope();
 }
 
-void Interpreter::process(Syntax::StatementBlock &node)
+Interpreter::Iterator Interpreter::iterator(Syntax::Expression &expression)
 {
-    symtab.push_scope();
+    visit(expression);
 
-    for (auto &statement : node.statements)
-    {
-        visit(*statement);
-    }
+    if (auto channel = std::dynamic_pointer_cast<Runtime::Channel>(temp))
+        return [channel] { return channel->receive(); };
 
-    symtab.pop_scope();
+    if (auto generator = std::dynamic_pointer_cast<Runtime::Generator>(temp))
+        return [state = generator->state] { return state->next(); };
+
+    throw Semantic::SemanticError("object is not iterable");
 }
 
-void Interpreter::process(Syntax::Function &node)
+void Interpreter::process(Syntax::ForEachLoop &node)
 {
-    auto symbol = symtab.define(node.identifier->name);
+    auto source = iterator(*node.iterable);
 
-    functions[symbol] = std::make_shared<Syntax::Function>(node);
+    symtab.push_scope();
+
+    auto variable_sym = symtab.define(node.variable->name);
+
+    try
+    {
+        while (auto object = source())
+        {
+            object->is_mutable = false;
+            memory[variable_sym] = object;
+
+            visit(*node.body);
+        }
+    }
+    catch (...)
+    {
+        memory.erase(variable_sym);
+        symtab.pop_scope();
+        throw;
+    }
+
+    memory.erase(variable_sym);
+    symtab.pop_scope();
 }
 
-void Interpreter::process(Syntax::Call &node)
+void Interpreter::process(Syntax::ParallelLoop &node)
 {
-    auto func_sym = symtab.lookup(node.function->name);
+    using Reduction = Syntax::ParallelLoop::Reduction;
 
-    if (functions.find(func_sym) == functions.end())
-        throw Semantic::SemanticError(node.function->name + " does not name a function");
+    auto &loop = *node.loop;
 
-    auto func = functions[func_sym];
+    long long begin = range_bound(*loop.begin);
+    long long end = range_bound(*loop.end);
+    long long step = loop.step ? range_bound(*loop.step) : 1;
 
-    if (node.arguments.size() != func->arguments.size())
-        throw Semantic::SemanticError(
-                "function " + func->identifier->name + " takes "
-                + std::to_string(func->arguments.size()) + " arguments, but "
-                + std::to_string(node.arguments.size()) + " provided");
+    if (step == 0)
+        throw Semantic::SemanticError("range step must not be zero");
 
-    symtab.push_scope();
+    // Iterations run concurrently, so body may write only its own locals and reduction variables
+    std::set<std::string> reduced;
 
-    for (int i = 0; i < node.arguments.size(); ++i)
+    for (auto &reduction : node.reductions)
     {
-        auto expected_type_sym = symtab.lookup(func->arguments[i].type->name);
-
-        visit(*node.arguments[i]);
+        if (!reduced.insert(reduction.variable->name).second)
+            throw Semantic::SemanticError("variable '" + reduction.variable->name + "' is reduced more than once");
+    }
 
-        if (temp->type != expected_type_sym)
+    Semantic::EffectAnalysis analysis([this] (const std::string &name) -> std::shared_ptr<Syntax::Function> {
+        try
         {
-            symtab.pop_scope();
-            throw Semantic::SemanticError("parameter type mismatch");
+            return function(name);
+        }
+        catch (Semantic::SemanticError &)
+        {
+            return nullptr;
         }
+    });
 
-        auto param_sym = symtab.define(func->arguments[i].param->name);
+    auto effects = analysis.analyze(*loop.body, {loop.counter->name});
 
-        memory[param_sym] = temp->clone();
-        memory[param_sym]->is_mutable = true;
-    }
+    if (effects.io)
+        throw Semantic::SemanticError("parallel loop body must not do input or output");
 
-    try
+    if (effects.returns)
+        throw Semantic::SemanticError("parallel loop body must not return");
+
+    for (auto &name : effects.writes)
     {
-        visit(*func->body);
+        if (reduced.find(name) == reduced.end())
+            throw Semantic::SemanticError("parallel loop body writes shared variable '" + name + "'");
+    }
 
-        if (func->return_type)
-            throw Semantic::SemanticError("function did not return anything");
+    // Resuming generator changes it, chunks may only iterate the ones they make
+    for (auto &name : effects.reads)
+    {
+        auto symbol = symtab.find(name);
+        auto value = symbol ? object(*symbol) : nullptr;
 
-        temp = std::make_shared<Runtime::Scalar<bool>>(symbol_bool, true, false);
+        if (value && value->type == symbol_generator)
+            throw Semantic::SemanticError("parallel loop body uses generator '" + name + "' made outside of it");
     }
-    catch (FunctionReturn &ret)
+
+    std::vector<Semantic::Symbol> symbols;
+    std::vector<std::shared_ptr<Runtime::Object>> targets;
+
+    for (auto &reduction : node.reductions)
+    {
+        auto &name = reduction.variable->name;
+        auto symbol = symtab.lookup(name);
+        auto target = object(symbol);
+
+        if (!target)
+            throw Semantic::SemanticError(name + " does not name an object");
+
+        if (!target->is_mutable)
+            throw Semantic::SemanticError("reduction variable '" + name + "' must be mutable");
+
+        bool logical = reduction.type == Reduction::Type::And || reduction.type == Reduction::Type::Or;
+
+        if (logical ? target->type != symbol_bool : target->type != symbol_int && target->type != symbol_float)
+            throw Semantic::SemanticError("reduction variable '" + name + "' has unsupported type");
+
+        symbols.push_back(symbol);
+        targets.push_back(target);
+    }
+
+    long long count = step > 0
+            ? (end > begin ? (end - begin + step - 1) / step : 0)
+            : (begin > end ? (begin - end - step - 1) / -step : 0);
+
+    long long chunks = std::min(count, ParallelChunks);
+
+    std::vector<std::vector<std::shared_ptr<Runtime::Object>>> partials(chunks);
+    std::vector<std::exception_ptr> errors(chunks);
+    std::atomic<long long> remaining(chunks);
+
+    auto &pool = Runtime::ThreadPool::shared();
+
+    for (long long chunk = 0; chunk < chunks; ++chunk)
+    {
+        pool.submit([&, chunk] {
+            try
+            {
+                Interpreter worker(*this, this);
+
+                // every chunk accumulates into private copies of reduction variables
+                for (size_t i = 0; i < symbols.size(); ++i)
+                    worker.memory[symbols[i]] = identity(node.reductions[i].type, targets[i]->type);
+
+                worker.symtab.push_scope();
+
+                auto counter = std::make_shared<Runtime::Scalar<int>>(symbol_int, 0, false);
+                worker.memory[worker.symtab.define(loop.counter->name)] = counter;
+
+                for (long long k = count * chunk / chunks; k < count * (chunk + 1) / chunks; ++k)
+                {
+                    counter->value = static_cast<int>(begin + k * step);
+                    worker.visit(*loop.body);
+                }
+
+                for (auto symbol : symbols)
+                    partials[chunk].push_back(worker.memory[symbol]);
+            }
+            catch (...)
+            {
+                errors[chunk] = std::current_exception();
+            }
+
+            remaining -= 1;
+        });
+    }
+
+    pool.wait([&] { return remaining == 0; });
+
+    for (auto &error : errors)
+    {
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+    for (size_t i = 0; i < targets.size(); ++i)
     {
-        if (!func->return_type)
-            throw Semantic::SemanticError("function tries to return something");
+        auto value = targets[i];
+
+        for (auto &partial : partials)
+            value = reduce(node.reductions[i].type, value, partial[i]);
+
+        targets[i]->assign(*value);
+    }
+}
+
+std::shared_ptr<Runtime::Object> Interpreter::identity(Syntax::ParallelLoop::Reduction::Type type, Semantic::Symbol value_type)
+{
+    using Type = Syntax::ParallelLoop::Reduction::Type;
+
+    const bool is_int = value_type == symbol_int;
+    const float infinity = std::numeric_limits<float>::infinity();
+
+    switch (type)
+    {
+        case Type::Sum:
+            if (is_int) return std::make_shared<Runtime::Scalar<int>>(symbol_int, 0, true);
+            else return std::make_shared<Runtime::Scalar<float>>(symbol_float, 0.0f, true);
+
+        case Type::Product:
+            if (is_int) return std::make_shared<Runtime::Scalar<int>>(symbol_int, 1, true);
+            else return std::make_shared<Runtime::Scalar<float>>(symbol_float, 1.0f, true);
+
+        case Type::Min:
+            if (is_int) return std::make_shared<Runtime::Scalar<int>>(symbol_int, std::numeric_limits<int>::max(), true);
+            else return std::make_shared<Runtime::Scalar<float>>(symbol_float, infinity, true);
+
+        case Type::Max:
+            if (is_int) return std::make_shared<Runtime::Scalar<int>>(symbol_int, std::numeric_limits<int>::min(), true);
+            else return std::make_shared<Runtime::Scalar<float>>(symbol_float, -infinity, true);
+
+        case Type::And:
+            return std::make_shared<Runtime::Scalar<bool>>(symbol_bool, true, true);
+
+        case Type::Or:
+            return std::make_shared<Runtime::Scalar<bool>>(symbol_bool, false, true);
+    }
+
+    throw std::logic_error("unknown reduction");
+}
+
+std::shared_ptr<Runtime::Object> Interpreter::reduce(
+        Syntax::ParallelLoop::Reduction::Type type,
+        const std::shared_ptr<Runtime::Object> &left,
+        const std::shared_ptr<Runtime::Object> &right)
+{
+    using Type = Syntax::ParallelLoop::Reduction::Type;
+
+    auto apply = [&] (BinaryOperator op) {
+        return operations.lookup(left->type, op, right->type)(*left, *right);
+    };
 
-        auto ret_sym = symtab.lookup(func->return_type->name);
+    switch (type)
+    {
+        case Type::Sum:     return apply(BinaryOperator::Plus);
+        case Type::Product: return apply(BinaryOperator::Mul);
+        case Type::And:     return apply(BinaryOperator::And);
+        case Type::Or:      return apply(BinaryOperator::Or);
 
-        if (ret.object->type != ret_sym)
-            throw Semantic::SemanticError("function's return type mismatch");
+        case Type::Min:
+            return dynamic_cast<Runtime::Scalar<bool> &>(*apply(BinaryOperator::GT)).value ? right : left;
 
-        temp = ret.object;
+        case Type::Max:
+            return dynamic_cast<Runtime::Scalar<bool> &>(*apply(BinaryOperator::LT)).value ? right : left;
+    }
+
+    throw std::logic_error("unknown reduction");
+}
+
+void Interpreter::process(Syntax::PrintStatement &node)
+{
+    visit(*node.expression);
+    print(*temp);
+}
+
+void Interpreter::print(Runtime::Object &object)
+{
+    std::lock_guard<std::mutex> lock(*io_mutex);
+
+    if (object.type == symbol_task)
+        throw Semantic::SemanticError("task can't be printed, join it first");
+
+    if (object.type == symbol_channel)
+        throw Semantic::SemanticError("channel can't be printed");
+
+    if (object.type == symbol_generator)
+        throw Semantic::SemanticError("generator can't be printed");
+
+    try
+    {
+        if (object.type == symbol_int)
+            ostream << dynamic_cast<Runtime::Scalar<int> &>(object).value << std::endl;
+        else if (object.type == symbol_float)
+            ostream << dynamic_cast<Runtime::Scalar<float> &>(object).value << std::endl;
+        else if (object.type == symbol_bool)
+            ostream << std::boolalpha << dynamic_cast<Runtime::Scalar<bool> &>(object).value << std::endl;
+        else if (object.type == symbol_char)
+            ostream << dynamic_cast<Runtime::Scalar<char> &>(object).value << std::endl;
+        else
+            throw std::logic_error("internal interpretation error");
+    }
+    catch (std::bad_cast &)
+    {
+        throw std::logic_error("internal interpretation error");
+    }
+}
+
+void Interpreter::process(Syntax::ReadStatement &node)
+{
+    visit(*node.expression);
+    read(*temp);
+}
+
+void Interpreter::read(Runtime::Object &object)
+{
+    std::lock_guard<std::mutex> lock(*io_mutex);
+
+    try
+    {
+        if (object.type == symbol_int)
+            istream >> dynamic_cast<Runtime::Scalar<int> &>(object).value;
+        else if (object.type == symbol_float)
+            istream >> dynamic_cast<Runtime::Scalar<float> &>(object).value;
+        else if (object.type == symbol_bool)
+            istream >> dynamic_cast<Runtime::Scalar<bool> &>(object).value;
+        else if (object.type == symbol_char)
+            istream >> dynamic_cast<Runtime::Scalar<char> &>(object).value;
+    }
+    catch (std::bad_cast &)
+    {
+        throw std::logic_error("internal interpretation error");
+    }
+}
+
+void Interpreter::process(Syntax::StatementBlock &node)
+{
+    symtab.push_scope();
+
+    try
+    {
+        for (auto &statement : node.statements)
+        {
+            visit(*statement);
+        }
+    }
+    catch (...)
+    {
+        symtab.pop_scope();
+        throw;
     }
 
     symtab.pop_scope();
 }
 
+void Interpreter::process(Syntax::Function &node)
+{
+    auto symbol = symtab.define(node.identifier->name);
+
+    functions[symbol] = std::make_shared<Syntax::Function>(node);
+
+    // Name may refer to different functions from now on, depending on scope,
+    // so memoized functions calling it can't cache their results anymore
+    if (!defined.insert(node.identifier->name).second && redefined.insert(node.identifier->name).second)
+    {
+        for (auto &[body, table] : memo)
+        {
+            if (table->reads.find(node.identifier->name) != table->reads.end())
+            {
+                table->entries.clear();
+                table->redefined = true;
+            }
+        }
+
+        // Compiled bodies and hot loops which inlined it are compiled again on their next run, with a guarded call there
+        auto invalidate = [&] (auto &compiled) {
+            for (auto body = compiled.begin(); body != compiled.end();)
+            {
+                if (body->second.inlined.count(node.identifier->name))
+                {
+                    body = compiled.erase(body);
+                    ++invalidations;
+                }
+                else
+                    ++body;
+            }
+        };
+
+        invalidate(bodies);
+        invalidate(hot_loops);
+    }
+}
+
+std::string Interpreter::impurity(Syntax::Function &function, std::set<std::string> &reads)
+{
+    if (function.generator)
+        return "is a generator";
+
+    auto resolver = [this] (const std::string &name) -> std::shared_ptr<Syntax::Function> {
+        try
+        {
+            return this->function(name);
+        }
+        catch (Semantic::SemanticError &)
+        {
+            return nullptr;
+        }
+    };
+
+    Semantic::EffectAnalysis analysis(resolver);
+
+    auto effects = analysis.analyze(function);
+    reads = effects.reads;
+
+    if (effects.io)
+        return "does input or output";
+
+    if (effects.communicates)
+        return "uses tasks, channels or generators";
+
+    if (!effects.writes.empty())
+        return "writes variable '" + *effects.writes.begin() + "'";
+
+    // Function sees variables of its caller, its result may depend only on arguments
+    for (auto &name : effects.reads)
+    {
+        if (!resolver(name))
+            return "reads variable '" + name + "'";
+    }
+
+    return {};
+}
+
+std::shared_ptr<Interpreter::MemoTable> Interpreter::memo_table(const std::shared_ptr<Syntax::Function> &function)
+{
+    if (!function->memo && !memoize_all)
+        return nullptr;
+
+    auto &table = memo[function->deferred ? static_cast<const void *>(function->deferred.get()) : function->body.get()];
+
+    if (!table)
+    {
+        table = std::make_shared<MemoTable>();
+        table->function = function;
+    }
+
+    if (!table->checked)
+    {
+        table->impurity = impurity(*function, table->reads);
+        table->checked = true;
+
+        for (auto &name : table->reads)
+            table->redefined = table->redefined || redefined.find(name) != redefined.end();
+    }
+
+    if (table->impurity.empty())
+        return table->redefined ? nullptr : table;
+
+    if (function->memo)
+        throw Semantic::SemanticError("memo function '" + function->identifier->name + "' " + table->impurity);
+
+    return nullptr;
+}
+
+void Interpreter::memoize_pure_functions(bool memoize)
+{
+    memoize_all = memoize;
+}
+
+void Interpreter::print_stats(std::ostream &stream) const
+{
+    std::vector<const MemoTable *> tables;
+
+    for (auto &[body, table] : memo)
+    {
+        if (table->calls > 0)
+            tables.push_back(table.get());
+    }
+
+    std::sort(tables.begin(), tables.end(), [] (const MemoTable *left, const MemoTable *right) {
+        return left->function->identifier->name < right->function->identifier->name;
+    });
+
+    for (auto table : tables)
+    {
+        stream << "memo " << table->function->identifier->name << ": "
+               << table->calls << " calls, " << table->hits << " hits ("
+               << std::fixed << std::setprecision(1) << 100.0 * table->hits / table->calls << "%)" << std::endl;
+    }
+
+    if (hot_loops_compiled > 0)
+        stream << "hot loops compiled: " << hot_loops_compiled << std::endl;
+
+    if (deoptimizations > 0)
+        stream << "inlined calls deoptimized: " << deoptimizations << std::endl;
+
+    if (invalidations > 0)
+        stream << "compiled bodies invalidated: " << invalidations << std::endl;
+}
+
+std::shared_ptr<Syntax::Function> Interpreter::callee(Syntax::Call &node)
+{
+    auto func = function(node.function->name);
+
+    if (!func)
+        throw Semantic::SemanticError(node.function->name + " does not name a function");
+
+    if (node.arguments.size() != func->arguments.size())
+        throw Semantic::SemanticError(
+                "function " + func->identifier->name + " takes "
+                + std::to_string(func->arguments.size()) + " arguments, but "
+                + std::to_string(node.arguments.size()) + " provided");
+
+    return func;
+}
+
+void Interpreter::bind(const Syntax::Function &function, const std::vector<std::shared_ptr<Runtime::Object>> &arguments)
+{
+    for (size_t i = 0; i < arguments.size(); ++i)
+    {
+        auto expected_type_sym = symtab.lookup(function.arguments[i].type->name);
+
+        if (arguments[i]->type != expected_type_sym)
+            throw Semantic::SemanticError("parameter type mismatch");
+
+        auto param_sym = symtab.define(function.arguments[i].param->name);
+
+        // argument only the list refers to is a temporary, the list isn't used after binding
+        auto &value = memory[param_sym] = arguments[i].use_count() == 1 ? arguments[i] : arguments[i]->clone();
+        value->is_mutable = true;
+    }
+}
+
+std::shared_ptr<Runtime::Object> Interpreter::invoke(
+        const Syntax::Function &function,
+        const std::vector<std::shared_ptr<Runtime::Object>> &arguments)
+{
+    if (function.generator)
+        return generator(function, arguments);
+
+    std::shared_ptr<Runtime::Object> result;
+
+    symtab.push_scope();
+
+    try
+    {
+        bind(function, arguments);
+
+        try
+        {
+            run_body(function.definition());
+
+            if (function.return_type)
+                throw Semantic::SemanticError("function did not return anything");
+
+            result = std::make_shared<Runtime::Scalar<bool>>(symbol_bool, true, false);
+        }
+        catch (FunctionReturn &ret)
+        {
+            if (!function.return_type)
+                throw Semantic::SemanticError("function tries to return something");
+
+            auto ret_sym = symtab.lookup(function.return_type->name);
+
+            if (ret.object->type != ret_sym)
+                throw Semantic::SemanticError("function's return type mismatch");
+
+            result = ret.object;
+        }
+    }
+    catch (...)
+    {
+        symtab.pop_scope();
+        throw;
+    }
+
+    symtab.pop_scope();
+
+    return result;
+}
+
+void Interpreter::process(Syntax::Call &node)
+{
+    auto func = callee(node);
+
+    // Arguments are evaluated in the scope of caller
+    std::vector<std::shared_ptr<Runtime::Object>> arguments;
+
+    for (auto &argument : node.arguments)
+    {
+        visit(*argument);
+        arguments.push_back(std::move(temp));
+    }
+
+    temp = call(func, arguments);
+}
+
+std::shared_ptr<Runtime::Object> Interpreter::call(
+        const std::shared_ptr<Syntax::Function> &function,
+        const std::vector<std::shared_ptr<Runtime::Object>> &arguments)
+{
+    auto table = memo_table(function);
+    std::string key;
+
+    if (!table || !memo_key(arguments, key))
+        return invoke(*function, arguments);
+
+    ++table->calls;
+
+    auto slot = std::hash<std::string>()(key) % MemoCapacity;
+
+    if (!table->entries.empty() && table->entries[slot].result && table->entries[slot].key == key)
+    {
+        ++table->hits;
+        return table->entries[slot].result->clone();
+    }
+
+    auto result = invoke(*function, arguments);
+
+    // callee redefined during the call, result may come from the old one
+    if (table->redefined)
+        return result;
+
+    if (table->entries.empty())
+        table->entries.resize(MemoCapacity);
+
+    table->entries[slot] = {std::move(key), result->clone()};
+
+    return result;
+}
+
+bool Interpreter::inlining_holds(const Syntax::InlinedCall &node)
+{
+    auto &name = node.function->identifier->name;
+
+    for (const Interpreter *context = this; context; context = context->parent)
+    {
+        if (context->redefined.find(name) == context->redefined.end())
+            continue;
+
+        try
+        {
+            return function(name)->body == node.function->body;
+        }
+        catch (Semantic::SemanticError &)
+        {
+            return false; // the original call reports it
+        }
+    }
+
+    return true;
+}
+
+void Interpreter::process(Syntax::InlinedCall &node)
+{
+    // Deoptimization: the call is evaluated as it was written, from its arguments on
+    if (!inlining_holds(node))
+    {
+        ++deoptimizations;
+        visit(*node.call);
+        return;
+    }
+
+    auto &function = *node.function;
+
+    std::vector<std::shared_ptr<Runtime::Object>> arguments;
+
+    for (auto &argument : node.call->arguments)
+    {
+        visit(*argument);
+        arguments.push_back(std::move(temp));
+    }
+
+    // The same scopes as invoke() and the body block have
+    size_t scopes = 0;
+
+    try
+    {
+        symtab.push_scope();
+        ++scopes;
+
+        bind(function, arguments);
+
+        if (node.body)
+        {
+            symtab.push_scope();
+            ++scopes;
+
+            for (auto &statement : node.body->statements)
+                visit(*statement);
+        }
+
+        if (node.result)
+        {
+            visit(*node.result);
+
+            if (temp->type != symtab.lookup(function.return_type->name))
+                throw Semantic::SemanticError("function's return type mismatch");
+        }
+        else
+        {
+            temp = std::make_shared<Runtime::Scalar<bool>>(symbol_bool, true, false);
+        }
+    }
+    catch (...)
+    {
+        for (; scopes > 0; --scopes)
+            symtab.pop_scope();
+
+        throw;
+    }
+
+    for (; scopes > 0; --scopes)
+        symtab.pop_scope();
+}
+
+void Interpreter::process(Syntax::Spawn &node)
+{
+    auto func = callee(*node.call);
+
+    // Task runs concurrently with its creator, so it may only touch its own frame and streams
+    auto effects = analyze_effects(*func);
+
+    if (!effects.writes.empty())
+        throw Semantic::SemanticError("spawned function writes shared variable '" + *effects.writes.begin() + "'");
+
+    // Task frame gets copies of everything the function uses, taken at the moment of spawn
+    std::shared_ptr<Interpreter> worker(new Interpreter(*this, nullptr));
+
+    worker->functions[symtab.lookup(node.call->function->name)] = func;
+    capture(*worker, effects.reads, true);
+
+    std::vector<std::shared_ptr<Runtime::Object>> arguments;
+
+    for (auto &argument : node.call->arguments)
+    {
+        visit(*argument);
+
+        // generator made just for the task is its own, others would be resumed by both threads
+        if (auto generator = dynamic_cast<Runtime::Generator *>(temp.get()))
+        {
+            if (temp.use_count() > 1 || generator->state.use_count() > 1)
+                throw Semantic::SemanticError("generator can't be shared with a task");
+        }
+
+        arguments.push_back(temp->clone());
+    }
+
+    auto state = std::make_shared<Runtime::Task::State>();
+
+    Runtime::ThreadPool::shared().submit([worker, func, arguments, state] {
+        try
+        {
+            state->result = worker->invoke(*func, arguments);
+        }
+        catch (...)
+        {
+            state->error = std::current_exception();
+        }
+
+        state->done = true;
+    });
+
+    temp = std::make_shared<Runtime::Task>(symbol_task, state, false);
+}
+
+void Interpreter::process(Syntax::Join &node)
+{
+    visit(*node.task);
+
+    auto task = std::dynamic_pointer_cast<Runtime::Task>(temp);
+
+    if (!task)
+        throw Semantic::SemanticError("join expects a task");
+
+    auto state = task->state;
+
+    // Joining thread executes pending tasks meanwhile, so nested joins never starve the pool
+    Runtime::ThreadPool::shared().wait([&state] { return state->done.load(); });
+
+    if (state->error)
+        std::rethrow_exception(state->error);
+
+    temp = state->result;
+}
+
+std::shared_ptr<Runtime::Channel> Interpreter::channel(Syntax::Expression &expression)
+{
+    visit(expression);
+
+    auto channel = std::dynamic_pointer_cast<Runtime::Channel>(temp);
+
+    if (!channel)
+        throw Semantic::SemanticError("channel expected");
+
+    return channel;
+}
+
+void Interpreter::process(Syntax::MakeChannel &node)
+{
+    auto type_sym = symtab.lookup(node.type->name);
+
+    if (types.find(type_sym) == types.end())
+        throw Semantic::SemanticError(node.type->name + " does not name a type");
+
+    visit(*node.capacity);
+
+    if (temp->type != symbol_int || dynamic_cast<Runtime::Scalar<int> &>(*temp).value <= 0)
+        throw Semantic::SemanticError("channel capacity must be positive int");
+
+    auto capacity = static_cast<size_t>(dynamic_cast<Runtime::Scalar<int> &>(*temp).value);
+    auto state = std::make_shared<Runtime::Channel::State>(type_sym, capacity);
+
+    temp = std::make_shared<Runtime::Channel>(symbol_channel, state, false);
+}
+
+void Interpreter::process(Syntax::Receive &node)
+{
+    temp = channel(*node.channel)->receive();
+
+    if (!temp)
+        throw Semantic::SemanticError("receiving from closed channel");
+}
+
+void Interpreter::process(Syntax::SendStatement &node)
+{
+    auto target = channel(*node.channel);
+
+    visit(*node.value);
+
+    // receiver gets its own copy, unless the value is a temporary
+    target->send(own(std::move(temp)));
+}
+
+void Interpreter::process(Syntax::CloseStatement &node)
+{
+    channel(*node.channel)->close();
+}
+
+Semantic::Effects Interpreter::analyze_effects(const Syntax::Function &function)
+{
+    Semantic::EffectAnalysis analysis([this] (const std::string &name) -> std::shared_ptr<Syntax::Function> {
+        try
+        {
+            return this->function(name);
+        }
+        catch (Semantic::SemanticError &)
+        {
+            return nullptr;
+        }
+    });
+
+    return analysis.analyze(function);
+}
+
+void Interpreter::capture(Interpreter &context, const std::set<std::string> &names, bool copy) const
+{
+    for (auto &name : names)
+    {
+        auto symbol = symtab.find(name);
+
+        if (!symbol)
+            continue; // reported by the context when it gets there
+
+        auto value = object(*symbol);
+
+        // copy of generator shares its state, which can't be resumed from two threads
+        if (value && copy && value->type == symbol_generator)
+            throw Semantic::SemanticError("generator '" + name + "' can't be shared with a task");
+
+        if (value)
+            context.memory[*symbol] = copy ? value->clone() : value;
+        else if (auto used = function(*symbol))
+            context.functions[*symbol] = used;
+    }
+}
+
+std::shared_ptr<Runtime::Object> Interpreter::generator(
+        const Syntax::Function &function,
+        const std::vector<std::shared_ptr<Runtime::Object>> &arguments)
+{
+    if (function.return_type && symtab.lookup(function.return_type->name) != symbol_generator)
+        throw Semantic::SemanticError("generator " + function.identifier->name + " must return generator");
+
+    // Generator may outlive its caller, e.g. a task, so it gets the objects and functions it uses
+    // when created, objects are shared, so it sees their later values like a regular call
+    auto frame = std::make_shared<GeneratorFrame>();
+
+    frame->context.reset(new Interpreter(*this, nullptr));
+    capture(*frame->context, analyze_effects(function).reads, false);
+
+    frame->context->symtab.push_scope();
+    frame->context->bind(function, arguments);
+
+    frame->body = function.definition();
+    frame->stack.push_back({frame->body.get()});
+
+    return std::make_shared<Runtime::Generator>(symbol_generator, frame, false);
+}
+
+std::shared_ptr<Runtime::Object> Interpreter::resume(GeneratorFrame &frame)
+{
+    if (frame.running.exchange(true))
+        throw Semantic::SemanticError("generator is already running");
+
+    if (frame.finished)
+    {
+        frame.running = false;
+        return nullptr;
+    }
+
+    try
+    {
+        while (!frame.stack.empty())
+        {
+            if (auto object = advance(frame))
+            {
+                frame.running = false;
+                return object;
+            }
+        }
+    }
+    catch (...)
+    {
+        frame.finished = true;
+        frame.running = false;
+        throw;
+    }
+
+    frame.finished = true;
+    frame.running = false;
+
+    return nullptr;
+}
+
+std::shared_ptr<Runtime::Object> Interpreter::advance(GeneratorFrame &frame)
+{
+    auto &step = frame.stack.back();
+
+    if (auto block = dynamic_cast<Syntax::StatementBlock *>(step.node))
+    {
+        if (!step.started)
+        {
+            symtab.push_scope();
+            step.started = true;
+        }
+
+        if (step.index == block->statements.size())
+        {
+            symtab.pop_scope();
+            frame.stack.pop_back();
+
+            return nullptr;
+        }
+
+        return enter(frame, *block->statements[step.index++]);
+    }
+
+    if (auto loop = dynamic_cast<Syntax::ConditionalLoop *>(step.node))
+    {
+        if (condition(*loop->condition))
+            frame.stack.push_back({loop->body.get()});
+        else
+            frame.stack.pop_back();
+
+        return nullptr;
+    }
+
+    if (auto loop = dynamic_cast<Syntax::RangeLoop *>(step.node))
+    {
+        if (!step.started)
+        {
+            step.current = range_bound(*loop->begin);
+            step.end = range_bound(*loop->end);
+            step.step = loop->step ? range_bound(*loop->step) : 1;
+
+            if (step.step == 0)
+                throw Semantic::SemanticError("range step must not be zero");
+
+            symtab.push_scope();
+
+            step.variable = symtab.define(loop->counter->name);
+            step.counter = std::make_shared<Runtime::Scalar<int>>(symbol_int, 0, false);
+            memory[step.variable] = step.counter;
+
+            step.started = true;
+        }
+        else
+        {
+            step.current += step.step;
+        }
+
+        if (step.step > 0 ? step.current < step.end : step.current > step.end)
+        {
+            step.counter->value = static_cast<int>(step.current);
+            frame.stack.push_back({loop->body.get()});
+        }
+        else
+        {
+            memory.erase(step.variable);
+            symtab.pop_scope();
+            frame.stack.pop_back();
+        }
+
+        return nullptr;
+    }
+
+    if (auto loop = dynamic_cast<Syntax::ForEachLoop *>(step.node))
+    {
+        if (!step.started)
+        {
+            step.source = iterator(*loop->iterable);
+
+            symtab.push_scope();
+            step.variable = symtab.define(loop->variable->name);
+
+            step.started = true;
+        }
+
+        if (auto object = step.source())
+        {
+            object->is_mutable = false;
+            memory[step.variable] = object;
+
+            frame.stack.push_back({loop->body.get()});
+        }
+        else
+        {
+            memory.erase(step.variable);
+            symtab.pop_scope();
+            frame.stack.pop_back();
+        }
+
+        return nullptr;
+    }
+
+    throw std::logic_error("unexpected statement in generator");
+}
+
+std::shared_ptr<Runtime::Object> Interpreter::enter(GeneratorFrame &frame, Syntax::Statement &statement)
+{
+    if (auto yield = dynamic_cast<Syntax::YieldStatement *>(&statement))
+    {
+        visit(*yield->expression);
+
+        // consumer gets a copy, so generator's variables stay its own
+        return own(std::move(temp));
+    }
+
+    if (auto conditional = dynamic_cast<Syntax::ConditionalStatement *>(&statement))
+    {
+        if (condition(*conditional->condition))
+            frame.stack.push_back({conditional->then_case.get()});
+        else if (conditional->else_case)
+            frame.stack.push_back({conditional->else_case.get()});
+
+        return nullptr;
+    }
+
+    if (dynamic_cast<Syntax::ReturnStatement *>(&statement))
+        throw Semantic::SemanticError("generator can't return a value");
+
+    if (dynamic_cast<Syntax::StatementBlock *>(&statement)
+        || dynamic_cast<Syntax::ConditionalLoop *>(&statement)
+        || dynamic_cast<Syntax::RangeLoop *>(&statement)
+        || dynamic_cast<Syntax::ForEachLoop *>(&statement))
+    {
+        frame.stack.push_back({&statement});
+        return nullptr;
+    }
+
+    visit(statement);
+
+    return nullptr;
+}
+
+void Interpreter::process(Syntax::YieldStatement &)
+{
+    throw Semantic::SemanticError("yield outside of generator");
+}
+
 void Interpreter::process(Syntax::ReturnStatement &node)
 {
     visit(*node.expression);
 
     throw FunctionReturn {temp};
 }
+
+
+void Interpreter::process(Syntax::ImportStatement &node)
+{
+    auto module = ModuleLoader::shared().load(node.module->name, module_path, cache.get());
+
+    for (auto &imported : modules)
+    {
+        if (imported == module)
+            return;
+    }
+
+    modules.push_back(module);
+
+    for (auto &statement : module->statements)
+        visit(*statement);
+}
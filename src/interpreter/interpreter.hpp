@@ -3,17 +3,28 @@
 
 
 #include <ios>
+#include <functional>
+#include <mutex>
+#include <optional>
 #include <set>
 #include "syntax/visitor.hpp"
 
 #include "object.hpp"
+#include "channel.hpp"
 #include "syntax/syntax_tree.hpp"
 #include "semantic/symtab.hpp"
+#include "semantic/effects.hpp"
 #include "operations.hpp"
+#include "cache.hpp"
+#include "program.hpp"
+#include "module.hpp"
 
 
 namespace Tomato
 {
+    /**
+     * @brief Execution context, owns memory of running program and its input/output streams.
+     */
     class Interpreter : private Syntax::Visitor
     {
     public:
@@ -23,10 +34,78 @@ namespace Tomato
 
         void interpret(std::istream &file);
 
+        /**
+         * @brief Execute statements read from source one by one, as soon as each of them is complete.
+         *
+         * Only the statement being read is kept, so source may be an endless pipe.
+         * Like interpret(), stops at the first error. Source may be the input stream of this context,
+         * then 'read' takes the lines following the statement.
+         */
+        void interpret_stream(std::istream &source);
+
+        /**
+         * @brief Execute compiled program in this context.
+         * @throw Semantic::SemanticError
+         */
+        void execute(const CompiledProgram &program);
+
+        /**
+         * @brief Keep compiled programs in given directory, reuse them when the same source is interpreted.
+         */
+        void enable_cache(const std::string &directory);
+
+        /**
+         * @brief Search for imported modules in given directory before all directories known so far.
+         */
+        void add_module_path(const std::string &directory);
+
+        /**
+         * @brief Make interpret() parse function bodies on their first call, see CompiledProgram::compile.
+         */
+        void defer_function_bodies(bool defer);
+
+        /**
+         * @brief Make interpret() inline calls of small functions, enabled by default.
+         */
+        void inline_functions(bool enable);
+
+        /**
+         * @brief Cache results of every pure function called, not only of those declared 'memo'.
+         */
+        void memoize_pure_functions(bool memoize);
+
+        /**
+         * @brief Execute statements as closures compiled from the syntax tree instead of visiting it.
+         *
+         * Every node is translated once into a callable with its children, literal values and
+         * operator handlers captured, function bodies are translated on their first call.
+         * Enabled by default if environment variable TOMATO_ENGINE is 'closures'.
+         */
+        void compile_closures(bool enable);
+
+        /**
+         * @brief Continue visited while loops as closures once they ran given number of iterations, 0 disables it.
+         *
+         * The rest of iterations of a hot loop run compiled, even if the loop is at the top level and
+         * never gets into a compiled function. Default is 1000 or environment variable TOMATO_HOT_LOOP.
+         */
+        void compile_hot_loops(size_t iterations);
+
+        /**
+         * @brief Print statistics of execution so far: calls and cache hits of memoized functions,
+         *        hot loops compiled, inlined calls deoptimized and compiled bodies invalidated.
+         */
+        void print_stats(std::ostream &stream) const;
+
     private:
         void process(Syntax::Program               &node) override;
         void process(Syntax::Function              &node) override;
         void process(Syntax::Call                  &node) override;
+        void process(Syntax::InlinedCall           &node) override;
+        void process(Syntax::Spawn                 &node) override;
+        void process(Syntax::Join                  &node) override;
+        void process(Syntax::MakeChannel           &node) override;
+        void process(Syntax::Receive               &node) override;
         void process(Syntax::ReturnStatement       &node) override;
         void process(Syntax::ValueDeclaration      &node) override;
         void process(Syntax::Assignment            &node) override;
@@ -36,10 +115,159 @@ namespace Tomato
         void process(Syntax::UnaryOperation        &node) override;
         void process(Syntax::ConditionalStatement  &node) override;
         void process(Syntax::ConditionalLoop       &node) override;
+        void process(Syntax::RangeLoop             &node) override;
+        void process(Syntax::ForEachLoop           &node) override;
+        void process(Syntax::ParallelLoop          &node) override;
         void process(Syntax::PrintStatement        &node) override;
         void process(Syntax::ReadStatement         &node) override;
+        void process(Syntax::SendStatement         &node) override;
+        void process(Syntax::CloseStatement        &node) override;
+        void process(Syntax::YieldStatement        &node) override;
+        void process(Syntax::ImportStatement       &node) override;
         void process(Syntax::StatementBlock        &node) override;
 
+    private:
+        /**
+         * @brief Worker context with the same types and scopes as origin.
+         * @param parent Context whose objects and functions are visible, but never modified by worker, may be nullptr.
+         */
+        Interpreter(const Interpreter &origin, const Interpreter *parent);
+
+        struct FunctionReturn
+        {
+            std::shared_ptr<Runtime::Object> object;
+        };
+
+        class ClosureCompiler;
+
+        using Closure = std::function<void()>;
+        using Evaluator = std::function<std::shared_ptr<Runtime::Object>()>;
+
+        Closure compile(Syntax::ASTNode &node);
+
+        /**
+         * @brief Execute statement by the selected engine.
+         */
+        void run_statement(Syntax::ASTNode &node);
+
+        /**
+         * @brief Execute function body by the selected engine, compiled bodies are kept for next calls.
+         */
+        void run_body(const std::shared_ptr<Syntax::StatementBlock> &body);
+
+        /**
+         * @brief Run the rest of hot while loop compiled, the closure is kept for its next hot entries.
+         */
+        void run_hot_loop(Syntax::ConditionalLoop &node);
+
+        std::shared_ptr<Runtime::Object> object(Semantic::Symbol symbol) const;
+        std::shared_ptr<Syntax::Function> function(Semantic::Symbol symbol) const;
+
+        /**
+         * @brief Function visible by name, functions of imported modules are defined on first reference.
+         * @throw Semantic::SemanticError Name is undefined.
+         */
+        std::shared_ptr<Syntax::Function> function(const std::string &name);
+
+        std::shared_ptr<Syntax::Function> callee(Syntax::Call &node);
+
+        /**
+         * @brief Guard of inlined call: callee's name still resolves to the function inlined.
+         *
+         * Inliner assumes the function is never redefined, which holds for the program inlined,
+         * but not for statements run later by the same interpreter, which may shadow it.
+         * Failed guard deoptimizes the call, it is evaluated as the original one.
+         */
+        bool inlining_holds(const Syntax::InlinedCall &node);
+        std::shared_ptr<Runtime::Object> invoke(
+                const Syntax::Function &function,
+                const std::vector<std::shared_ptr<Runtime::Object>> &arguments
+        );
+
+        long long range_bound(Syntax::Expression &expression);
+
+        std::shared_ptr<Runtime::Channel> channel(Syntax::Expression &expression);
+
+        bool condition(Syntax::Expression &expression);
+
+        /**
+         * @brief Result of 'and' or 'or' decided by its left operand alone, nullopt if the right one is needed.
+         */
+        std::optional<bool> short_circuit(BinaryOperator operation, const Runtime::Object &left) const;
+
+        using Iterator = std::function<std::shared_ptr<Runtime::Object>()>;
+
+        /**
+         * @brief Evaluate iterable object, returned function gives its items, nullptr after the last one.
+         */
+        Iterator iterator(Syntax::Expression &expression);
+
+        struct GeneratorFrame;
+
+        struct MemoTable;
+
+        /**
+         * @brief Result cache of function, nullptr if its results are not cached.
+         * @throw Semantic::SemanticError Function is declared 'memo', but it is not pure.
+         */
+        std::shared_ptr<MemoTable> memo_table(const std::shared_ptr<Syntax::Function> &function);
+
+        /**
+         * @brief Why results of function may not be cached, empty if function is pure.
+         * @param reads Receives names the result depends on, including those used by callees.
+         */
+        std::string impurity(Syntax::Function &function, std::set<std::string> &reads);
+
+        /**
+         * @brief Define parameters in the current scope, arguments referred to only by the list are not copied.
+         */
+        void bind(const Syntax::Function &function, const std::vector<std::shared_ptr<Runtime::Object>> &arguments);
+
+        /**
+         * @brief Call function with evaluated arguments, results of memoized functions are taken from cache.
+         */
+        std::shared_ptr<Runtime::Object> call(
+                const std::shared_ptr<Syntax::Function> &function,
+                const std::vector<std::shared_ptr<Runtime::Object>> &arguments
+        );
+
+        /**
+         * @brief Store initial value of declared variable, init is nullptr if declaration has no initializer.
+         *
+         * Temporary init is stored as it is, object referred to elsewhere, e.g. by a variable, is copied.
+         */
+        void declare(Syntax::ValueDeclaration &node, Semantic::Symbol symbol, std::shared_ptr<Runtime::Object> init);
+
+        void print(Runtime::Object &object);
+        void read(Runtime::Object &object);
+
+        /**
+         * @brief Effects of calling function, callees are resolved in this context.
+         */
+        Semantic::Effects analyze_effects(const Syntax::Function &function);
+
+        /**
+         * @brief Give context the objects and functions of given names visible here, so it never looks them up here.
+         * @param copy Context gets copies of objects, so it may run concurrently with this one.
+         */
+        void capture(Interpreter &context, const std::set<std::string> &names, bool copy) const;
+
+        std::shared_ptr<Runtime::Object> generator(
+                const Syntax::Function &function,
+                const std::vector<std::shared_ptr<Runtime::Object>> &arguments
+        );
+
+        std::shared_ptr<Runtime::Object> resume(GeneratorFrame &frame);
+        std::shared_ptr<Runtime::Object> advance(GeneratorFrame &frame);
+        std::shared_ptr<Runtime::Object> enter(GeneratorFrame &frame, Syntax::Statement &statement);
+
+        std::shared_ptr<Runtime::Object> identity(Syntax::ParallelLoop::Reduction::Type type, Semantic::Symbol value_type);
+        std::shared_ptr<Runtime::Object> reduce(
+                Syntax::ParallelLoop::Reduction::Type type,
+                const std::shared_ptr<Runtime::Object> &left,
+                const std::shared_ptr<Runtime::Object> &right
+        );
+
     private:
         std::istream &istream;
         std::ostream &ostream;
@@ -48,6 +276,9 @@ namespace Tomato
         Semantic::Symbol symbol_float;
         Semantic::Symbol symbol_bool;
         Semantic::Symbol symbol_char;
+        Semantic::Symbol symbol_task;
+        Semantic::Symbol symbol_channel;
+        Semantic::Symbol symbol_generator;
 
         Semantic::SymbolTable symtab;
         std::shared_ptr<Runtime::Object> temp;
@@ -57,6 +288,39 @@ namespace Tomato
         std::set<Semantic::Symbol> types;
         std::map<Semantic::Symbol, std::shared_ptr<Runtime::Object>> memory;
         std::map<Semantic::Symbol, std::shared_ptr<Syntax::Function>> functions;
+
+        std::unique_ptr<CompilationCache> cache;
+        bool defer_bodies = false;
+        bool optimize = true;
+
+        bool memoize_all = false;
+
+        bool closures = false;
+        size_t hot_loop = 1000;
+        size_t hot_loops_compiled = 0;
+        size_t deoptimizations = 0;
+        size_t invalidations = 0;
+
+        struct CompiledBody
+        {
+            std::shared_ptr<Syntax::StatementBlock> block;  ///< Keeps the block alive, so its address isn't reused
+            std::shared_ptr<const Closure> closure;         ///< Shared with running calls, which outlive invalidation
+            std::set<std::string> inlined;                  ///< Names of functions inlined, invalidated by redefinition
+        };
+
+        std::map<const Syntax::StatementBlock *, CompiledBody> bodies;
+        std::map<const Syntax::ConditionalLoop *, CompiledBody> hot_loops;  // block is the body of the loop
+        std::map<const void *, std::shared_ptr<MemoTable>> memo;   // by body, shared by copies of the function
+        std::set<std::string> defined;                              // names of functions defined so far
+        std::set<std::string> redefined;                            // names defined more than once
+
+        std::vector<std::string> module_path = ModuleLoader::default_path();
+        std::vector<std::shared_ptr<const Module>> modules; // imported, in order of import
+
+        // streams are shared with tasks
+        std::shared_ptr<std::mutex> io_mutex = std::make_shared<std::mutex>();
+
+        const Interpreter *parent = nullptr;
     };
 }
 
@@ -0,0 +1,136 @@
+#include "module.hpp"
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#include "syntax/parser.hpp"
+#include "semantic/symtab.hpp"
+
+
+using namespace Tomato;
+
+
+Module::Module(std::string name, std::string path, std::shared_ptr<const CompiledProgram> program)
+        : name(std::move(name)), path(std::move(path)), program(std::move(program))
+{
+    for (auto &statement : this->program->tree().statements)
+    {
+        auto function = std::dynamic_pointer_cast<Syntax::Function>(statement);
+
+        if (!function)
+        {
+            statements.push_back(statement);
+            continue;
+        }
+
+        if (!functions.emplace(function->identifier->name, function).second)
+            throw Semantic::SemanticError(
+                    "module '" + this->name + "' defines function '" + function->identifier->name + "' twice");
+    }
+}
+
+
+std::shared_ptr<Syntax::Function> Module::function(const std::string &name) const
+{
+    auto function = functions.find(name);
+
+    return function != functions.end() ? function->second : nullptr;
+}
+
+
+ModuleLoader &ModuleLoader::shared()
+{
+    static ModuleLoader loader;
+
+    return loader;
+}
+
+
+std::vector<std::string> ModuleLoader::default_path()
+{
+    std::vector<std::string> path;
+
+    if (auto variable = std::getenv("TOMATO_PATH"))
+    {
+        std::istringstream directories(variable);
+        std::string directory;
+
+        while (std::getline(directories, directory, ':'))
+        {
+            if (!directory.empty())
+                path.push_back(directory);
+        }
+    }
+
+    path.emplace_back(".");
+
+    return path;
+}
+
+
+std::shared_ptr<const Module> ModuleLoader::load(
+        const std::string &name,
+        const std::vector<std::string> &search_path,
+        const CompilationCache *cache)
+{
+    namespace fs = std::filesystem;
+
+    fs::path relative;
+    std::istringstream parts(name);
+    std::string part;
+
+    while (std::getline(parts, part, '.'))
+        relative /= part;
+
+    relative += ".tm";
+
+    std::error_code error;
+    fs::path file;
+
+    for (auto &directory : search_path)
+    {
+        auto candidate = fs::path(directory) / relative;
+
+        if (fs::is_regular_file(candidate, error))
+        {
+            file = fs::canonical(candidate, error);
+            break;
+        }
+    }
+
+    if (file.empty())
+        throw Semantic::SemanticError("module '" + name + "' not found");
+
+    // Parsing is done under the lock, so concurrent imports of the same module don't repeat it
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto loaded = modules.find(file.string());
+
+    if (loaded != modules.end())
+        return loaded->second;
+
+    std::ifstream stream(file);
+
+    if (!stream.is_open())
+        throw Semantic::SemanticError("can't open module '" + name + "'");
+
+    std::shared_ptr<const CompiledProgram> program;
+
+    try
+    {
+        // libraries are mostly unused by any single script, so their function bodies wait for the first call
+        program = CompiledProgram::compile(stream, cache, true);
+    }
+    catch (Syntax::SyntaxError &error)
+    {
+        throw Semantic::SemanticError("module '" + name + "': syntax error: " + error.what());
+    }
+
+    auto module = std::make_shared<const Module>(name, file.string(), program);
+
+    modules.emplace(file.string(), module);
+
+    return module;
+}
@@ -0,0 +1,79 @@
+#ifndef TOMATO_MODULE_HPP
+#define TOMATO_MODULE_HPP
+
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+
+#include "syntax/syntax_tree.hpp"
+#include "program.hpp"
+#include "cache.hpp"
+
+
+namespace Tomato
+{
+    /**
+     * @brief Compiled library file, immutable and shared by all interpreters of the process.
+     *
+     * Top-level functions are indexed by name, but not defined anywhere, importing
+     * context materializes each of them on first reference only.
+     */
+    class Module
+    {
+    public:
+        /**
+         * @throw Semantic::SemanticError Module defines the same function twice.
+         */
+        Module(std::string name, std::string path, std::shared_ptr<const CompiledProgram> program);
+
+        /**
+         * @return Top-level function of given name or nullptr.
+         */
+        std::shared_ptr<Syntax::Function> function(const std::string &name) const;
+
+        const std::string name;
+        const std::string path;
+
+        std::vector<std::shared_ptr<Syntax::Statement>> statements; ///< Top-level statements other than functions, run on import
+
+    private:
+        std::shared_ptr<const CompiledProgram> program;
+        std::map<std::string, std::shared_ptr<Syntax::Function>> functions;
+    };
+
+
+    /**
+     * @brief Process-wide registry of modules, every file is read, parsed and analyzed once.
+     */
+    class ModuleLoader
+    {
+    public:
+        static ModuleLoader & shared();
+
+        /**
+         * @brief Default search path: directories of $TOMATO_PATH (colon separated), then current directory.
+         */
+        static std::vector<std::string> default_path();
+
+        /**
+         * @brief Find module 'a.b' as file 'a/b.tm' in the first directory of search path containing it.
+         * @param cache Used for parsing module, may be nullptr.
+         * @throw Semantic::SemanticError Module is not found or is malformed.
+         */
+        std::shared_ptr<const Module> load(
+                const std::string &name,
+                const std::vector<std::string> &search_path,
+                const CompilationCache *cache
+        );
+
+    private:
+        std::mutex mutex;
+        std::map<std::string, std::shared_ptr<const Module>> modules; // by canonical file path
+    };
+}
+
+
+#endif //TOMATO_MODULE_HPP
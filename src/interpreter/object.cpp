@@ -38,3 +38,51 @@ template class Scalar<int>;
 template class Scalar<float>;
 template class Scalar<bool>;
 template class Scalar<char>;
+
+
+Task::Task(Semantic::Symbol type, std::shared_ptr<State> state, bool is_mutable)
+        : Object(type, is_mutable), state(std::move(state)) {}
+
+void Task::assign(const Object &object)
+{
+    if (!is_mutable)
+        throw SemanticError("assigning to constant object");
+
+    try
+    {
+        state = dynamic_cast<const Task &>(object).state;
+    }
+    catch (std::bad_cast &)
+    {
+        throw SemanticError("assigning different types");
+    }
+}
+
+std::shared_ptr<Object> Task::clone()
+{
+    return std::make_shared<Task>(type, state, is_mutable);
+}
+
+
+Generator::Generator(Semantic::Symbol type, std::shared_ptr<State> state, bool is_mutable)
+        : Object(type, is_mutable), state(std::move(state)) {}
+
+void Generator::assign(const Object &object)
+{
+    if (!is_mutable)
+        throw SemanticError("assigning to constant object");
+
+    try
+    {
+        state = dynamic_cast<const Generator &>(object).state;
+    }
+    catch (std::bad_cast &)
+    {
+        throw SemanticError("assigning different types");
+    }
+}
+
+std::shared_ptr<Object> Generator::clone()
+{
+    return std::make_shared<Generator>(type, state, is_mutable);
+}
@@ -3,6 +3,9 @@
 
 
 #include <any>
+#include <atomic>
+#include <exception>
+#include <memory>
 
 #include "semantic/symtab.hpp"
 
@@ -39,6 +42,57 @@ namespace Tomato::Runtime
     extern template class Scalar<float>;
     extern template class Scalar<bool>;
     extern template class Scalar<char>;
+
+
+    /**
+     * @brief Handle of a function call running concurrently, copies of the handle refer to the same call.
+     */
+    class Task : public Object
+    {
+    public:
+        struct State
+        {
+            std::atomic<bool> done {false};     ///< Set after result or error is stored
+            std::shared_ptr<Object> result;
+            std::exception_ptr error;
+        };
+
+        Task(Semantic::Symbol type, std::shared_ptr<State> state, bool is_mutable);
+
+        void assign(const Object &object) override;
+
+        std::shared_ptr<Object> clone() override;
+
+        std::shared_ptr<State> state;
+    };
+
+
+    /**
+     * @brief Suspended function producing values on demand, copies of the handle refer to the same generator.
+     */
+    class Generator : public Object
+    {
+    public:
+        class State
+        {
+        public:
+            virtual ~State() = default;
+
+            /**
+             * @brief Run generator until it yields.
+             * @return Yielded object, nullptr when generator has finished.
+             */
+            virtual std::shared_ptr<Object> next() = 0;
+        };
+
+        Generator(Semantic::Symbol type, std::shared_ptr<State> state, bool is_mutable);
+
+        void assign(const Object &object) override;
+
+        std::shared_ptr<Object> clone() override;
+
+        std::shared_ptr<State> state;
+    };
 }
 
 
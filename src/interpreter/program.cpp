@@ -0,0 +1,147 @@
+#include "program.hpp"
+
+#include <algorithm>
+#include <atomic>
+
+#include "syntax/parser.hpp"
+#include "syntax/printer.hpp"
+#include "optimizer/inliner.hpp"
+#include "thread_pool.hpp"
+
+
+using namespace Tomato;
+
+
+namespace
+{
+    /**
+     * Smaller sources are parsed sequentially, splitting them isn't worth scheduling tasks.
+     */
+    const size_t ParallelParseThreshold = 256 * 1024;
+    const size_t MinPartSize = 32 * 1024;
+
+
+    void parse_sequential(const std::string &source, bool defer_bodies, Syntax::Program &program)
+    {
+        Syntax::Parser parser;
+        parser.defer_function_bodies(defer_bodies);
+        parser.set_text(source);
+        parser.parse_program(program);
+    }
+
+
+    /**
+     * Source is split before top-level functions into parts of similar size, parts are
+     * parsed on the thread pool and concatenated. If any part fails, the split may be
+     * wrong, so the whole source is parsed sequentially to get the usual error.
+     */
+    void parse(const std::string &source, bool defer_bodies, Syntax::Program &program)
+    {
+        auto &pool = Runtime::ThreadPool::shared();
+
+        if (source.size() < ParallelParseThreshold || pool.size() < 2)
+            return parse_sequential(source, defer_bodies, program);
+
+        auto part_size = std::max(MinPartSize, source.size() / (pool.size() * 4));
+
+        std::vector<size_t> bounds = {0};
+
+        for (auto offset : Syntax::Parser::top_level_functions(source))
+        {
+            if (offset - bounds.back() >= part_size)
+                bounds.push_back(offset);
+        }
+
+        bounds.push_back(source.size());
+
+        size_t parts = bounds.size() - 1;
+
+        std::vector<Syntax::Program> programs(parts);
+        std::atomic<size_t> remaining(parts);
+        std::atomic<bool> failed(false);
+
+        for (size_t i = 0; i < parts; ++i)
+        {
+            pool.submit([&, i] {
+                try
+                {
+                    parse_sequential(source.substr(bounds[i], bounds[i + 1] - bounds[i]), defer_bodies, programs[i]);
+                }
+                catch (...)
+                {
+                    failed = true;
+                }
+
+                --remaining;
+            });
+        }
+
+        pool.wait([&remaining] { return remaining.load() == 0; });
+
+        if (failed)
+            return parse_sequential(source, defer_bodies, program);
+
+        for (auto &part : programs)
+        {
+            program.statements.insert(program.statements.end(),
+                                      std::make_move_iterator(part.statements.begin()),
+                                      std::make_move_iterator(part.statements.end()));
+        }
+    }
+}
+
+
+CompiledProgram::CompiledProgram(std::shared_ptr<Syntax::Program> tree) : program(std::move(tree)) {}
+
+
+std::shared_ptr<const CompiledProgram> CompiledProgram::compile(
+        const std::string &source,
+        const CompilationCache *cache,
+        bool defer_bodies,
+        bool optimize)
+{
+    std::shared_ptr<Syntax::Program> tree;
+
+    if (cache)
+        tree = cache->load(source, defer_bodies);
+
+    if (!tree)
+    {
+        tree = std::make_shared<Syntax::Program>();
+
+        parse(source, defer_bodies, *tree);
+
+        if (cache)
+            cache->store(source, *tree, defer_bodies);
+    }
+
+    // cache keeps the tree as written, inlining is cheap enough to redo
+    if (optimize)
+        Optimizer::Inliner().optimize(*tree);
+
+    return std::make_shared<const CompiledProgram>(tree);
+}
+
+
+std::shared_ptr<const CompiledProgram> CompiledProgram::compile(
+        std::istream &source,
+        const CompilationCache *cache,
+        bool defer_bodies,
+        bool optimize)
+{
+    std::string code((std::istreambuf_iterator<char>(source)), std::istreambuf_iterator<char>());
+
+    return compile(code, cache, defer_bodies, optimize);
+}
+
+
+const Syntax::Program &CompiledProgram::tree() const
+{
+    return *program;
+}
+
+
+void CompiledProgram::print(std::ostream &stream) const
+{
+    Syntax::Printer(stream).print(*program);
+}
@@ -0,0 +1,63 @@
+#ifndef TOMATO_PROGRAM_HPP
+#define TOMATO_PROGRAM_HPP
+
+
+#include <string>
+#include <memory>
+#include <istream>
+
+#include "syntax/syntax_tree.hpp"
+#include "cache.hpp"
+
+
+namespace Tomato
+{
+    /**
+     * @brief Immutable compiled form of a script.
+     *
+     * Compiled once, it may be shared and executed any number of times by
+     * execution contexts (Interpreter instances), each having its own input,
+     * output and memory.
+     */
+    class CompiledProgram
+    {
+    public:
+        explicit CompiledProgram(std::shared_ptr<Syntax::Program> tree);
+
+        /**
+         * @brief Compile source text, reusing cache entry if cache is provided.
+         * @param defer_bodies Pre-parse function bodies only, each is parsed on its first call
+         *                     and its syntax errors are reported then.
+         * @param optimize Inline calls of small functions, see Optimizer::Inliner.
+         * @throw Syntax::SyntaxError
+         */
+        static std::shared_ptr<const CompiledProgram> compile(
+                const std::string &source,
+                const CompilationCache *cache = nullptr,
+                bool defer_bodies = false,
+                bool optimize = true
+        );
+
+        static std::shared_ptr<const CompiledProgram> compile(
+                std::istream &source,
+                const CompilationCache *cache = nullptr,
+                bool defer_bodies = false,
+                bool optimize = true
+        );
+
+        const Syntax::Program & tree() const;
+
+        /**
+         * @brief Write the tree as it is executed, i.e. after optimization, as source text.
+         */
+        void print(std::ostream &stream) const;
+
+    private:
+        std::shared_ptr<Syntax::Program> program;
+
+        friend class Interpreter;
+    };
+}
+
+
+#endif //TOMATO_PROGRAM_HPP
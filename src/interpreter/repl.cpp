@@ -0,0 +1,88 @@
+#include "interpreter.hpp"
+
+#include <iostream>
+
+#include <readline/readline.h>
+#include <readline/history.h>
+
+#include "syntax/parser.hpp"
+
+
+using namespace Tomato;
+
+
+void Interpreter::run()
+{
+    Syntax::Parser parser;
+    parser.defer_function_bodies(defer_bodies);
+
+    const char * const primary_prompt = ">>> ";
+    const char * const append_prompt = "... ";
+
+    const char * prompt = primary_prompt;
+
+    std::string statement;
+
+    // Lines needed inside blocks and parentheses are read by the parser itself, so it never starts over
+    parser.set_input([&statement, append_prompt] (std::string &text) {
+        char * line = readline(append_prompt);
+
+        if (line == nullptr)
+            return false;
+
+        if (line[0] != '\0')
+            add_history(line);
+
+        text = line;
+        free(line);
+
+        statement += "\n" + text;
+
+        return true;
+    });
+
+    while (true)
+    {
+        char * line = readline(prompt);
+
+        if (line == nullptr) // EOF reached
+        {
+            ostream << std::endl;
+            break;
+        }
+        else if (line[0] == '\0') // Line is empty
+        {
+            continue;
+        }
+
+        using namespace std::string_literals;
+        statement += " "s + line;
+        add_history(line);
+        free(line);
+
+        parser.set_text(statement);
+
+        try
+        {
+            auto tree = parser.parse();
+            run_statement(*tree);
+        }
+        catch (Syntax::SyntaxError &error)
+        {
+            if (parser.eof()) // unexpected EOF at the top level, e.g. after binary operator, try read more lines
+            {
+                prompt = append_prompt;
+                continue;
+            }
+
+            ostream << "syntax error: " << error.what() << std::endl;
+        }
+        catch (Semantic::SemanticError &error)
+        {
+            ostream << "semantic error: " << error.what() << std::endl;
+        }
+
+        prompt = primary_prompt;
+        statement.clear();
+    }
+}
@@ -0,0 +1,130 @@
+#ifndef TOMATO_RING_BUFFER_HPP
+#define TOMATO_RING_BUFFER_HPP
+
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+
+namespace Tomato::Runtime
+{
+    /**
+     * @brief Size of the destructive interference range, hot counters are kept apart by it.
+     */
+    constexpr size_t CacheLine = 64;
+
+
+    inline size_t ring_capacity(size_t requested)
+    {
+        size_t capacity = 2;
+
+        while (capacity < requested)
+            capacity *= 2;
+
+        return capacity;
+    }
+
+
+    /**
+     * @brief Lock-free bounded queue for any number of producers and consumers.
+     *
+     * Every cell carries a sequence number telling whether it is ready to be written
+     * or read at given position (D. Vyukov's algorithm). Positions are claimed by CAS,
+     * which never retries without contention, so one producer and one consumer
+     * pay about the same as with a dedicated single-producer ring.
+     * Capacity is rounded up to a power of two.
+     */
+    template <typename T>
+    class MpmcRing
+    {
+    public:
+        explicit MpmcRing(size_t capacity)
+                : mask(ring_capacity(capacity) - 1), cells(new Cell[mask + 1])
+        {
+            for (size_t i = 0; i <= mask; ++i)
+                cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+
+        bool try_push(T &value)
+        {
+            auto position = head.load(std::memory_order_relaxed);
+
+            while (true)
+            {
+                auto &cell = cells[position & mask];
+                auto sequence = cell.sequence.load(std::memory_order_acquire);
+                auto difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+
+                if (difference == 0)
+                {
+                    if (head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                    {
+                        cell.value = std::move(value);
+                        cell.sequence.store(position + 1, std::memory_order_release);
+
+                        return true;
+                    }
+                }
+                else if (difference < 0)
+                {
+                    return false;
+                }
+                else
+                {
+                    position = head.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        bool try_pop(T &value)
+        {
+            auto position = tail.load(std::memory_order_relaxed);
+
+            while (true)
+            {
+                auto &cell = cells[position & mask];
+                auto sequence = cell.sequence.load(std::memory_order_acquire);
+                auto difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position + 1);
+
+                if (difference == 0)
+                {
+                    if (tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                    {
+                        value = std::move(cell.value);
+                        cell.sequence.store(position + mask + 1, std::memory_order_release);
+
+                        return true;
+                    }
+                }
+                else if (difference < 0)
+                {
+                    return false;
+                }
+                else
+                {
+                    position = tail.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        size_t capacity() const { return mask + 1; }
+
+    private:
+        struct Cell
+        {
+            std::atomic<size_t> sequence;
+            T value;
+        };
+
+        const size_t mask;
+        const std::unique_ptr<Cell[]> cells;
+
+        alignas(CacheLine) std::atomic<size_t> head {0};
+        alignas(CacheLine) std::atomic<size_t> tail {0};
+    };
+}
+
+
+#endif //TOMATO_RING_BUFFER_HPP
@@ -0,0 +1,235 @@
+#include "thread_pool.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+
+
+using namespace Tomato::Runtime;
+
+
+namespace
+{
+    // Pool and index of the worker running on current thread, helpers have no index
+    thread_local const ThreadPool *current_pool = nullptr;
+    thread_local int current_worker = -1;
+
+    const int SpinsBeforeHelper = 64;
+    const int SpinsBeforeSleep = 1024;
+}
+
+
+ThreadPool::ThreadPool(unsigned threads)
+{
+    threads = std::max(1u, threads);
+
+    for (unsigned i = 0; i <= threads; ++i)
+        queues.push_back(std::make_unique<Queue>());
+
+    for (unsigned i = 0; i < threads; ++i)
+        this->threads.emplace_back(&ThreadPool::work, this, static_cast<int>(i));
+}
+
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        stopping = true;
+    }
+
+    wakeup.notify_all();
+
+    for (auto &thread : threads)
+        thread.join();
+
+    while (helpers > 0)
+        std::this_thread::yield();
+}
+
+
+ThreadPool &ThreadPool::shared()
+{
+    static ThreadPool pool([] {
+        if (auto threads = std::getenv("TOMATO_THREADS"))
+        {
+            try
+            {
+                return static_cast<unsigned>(std::stoi(threads));
+            }
+            catch (std::exception &) {}
+        }
+
+        return std::thread::hardware_concurrency();
+    }());
+
+    return pool;
+}
+
+
+unsigned ThreadPool::size() const
+{
+    return static_cast<unsigned>(threads.size());
+}
+
+
+void ThreadPool::submit(Task task)
+{
+    int index = current_pool == this && current_worker >= 0 ? current_worker : static_cast<int>(threads.size());
+
+    // Count the task before publishing it, so taking it never makes counter negative
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        pending += 1;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(queues[index]->mutex);
+        queues[index]->tasks.push_back(std::move(task));
+    }
+
+    wakeup.notify_one();
+
+    if (waiting > 0)
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        finished.notify_all();
+    }
+}
+
+
+bool ThreadPool::run_pending(int self)
+{
+    Task task;
+
+    // Own tasks are taken from the back (most recent first), others are stolen from the front
+    if (self >= 0)
+    {
+        std::lock_guard<std::mutex> lock(queues[self]->mutex);
+
+        if (!queues[self]->tasks.empty())
+        {
+            task = std::move(queues[self]->tasks.back());
+            queues[self]->tasks.pop_back();
+        }
+    }
+
+    for (size_t i = 0; !task && i < queues.size(); ++i)
+    {
+        auto victim = (static_cast<size_t>(self + 1) + i) % queues.size();
+
+        std::lock_guard<std::mutex> lock(queues[victim]->mutex);
+
+        if (!queues[victim]->tasks.empty())
+        {
+            task = std::move(queues[victim]->tasks.front());
+            queues[victim]->tasks.pop_front();
+        }
+    }
+
+    if (!task)
+        return false;
+
+    pending -= 1;
+    task();
+
+    // Finished task may be the one a sleeping thread waits for
+    if (waiting > 0)
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        finished.notify_all();
+    }
+
+    return true;
+}
+
+
+void ThreadPool::wait(const std::function<bool()> &done)
+{
+    int self = current_pool == this ? current_worker : -1;
+
+    for (int spin = 0; !done(); ++spin)
+    {
+        if (run_pending(self))
+            spin = 0;
+        else if (spin < SpinsBeforeSleep)
+            std::this_thread::yield();
+        else
+        {
+            // Awaited task runs on another thread, spinning would take the core from it
+            waiting += 1;
+
+            {
+                std::unique_lock<std::mutex> lock(sleep_mutex);
+                finished.wait_for(lock, std::chrono::milliseconds(100), [this, &done] { return pending > 0 || done(); });
+            }
+
+            waiting -= 1;
+        }
+    }
+}
+
+
+void ThreadPool::block(const std::function<bool()> &done)
+{
+    std::shared_ptr<std::atomic<bool>> released;
+
+    for (int spin = 0; !done(); ++spin)
+    {
+        // Tasks still blocked at exit would never be released
+        if (stopping)
+            throw std::runtime_error("thread pool is shutting down");
+
+        // Blocked pool thread can't run tasks, which may be exactly the ones it waits for
+        if (spin == SpinsBeforeHelper && current_pool == this)
+        {
+            released = std::make_shared<std::atomic<bool>>(false);
+            helpers += 1;
+            std::thread(&ThreadPool::help, this, released).detach();
+        }
+
+        if (spin < SpinsBeforeSleep)
+            std::this_thread::yield();
+        else
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+
+    // Helper finishes its current task and exits
+    if (released)
+        *released = true;
+}
+
+
+void ThreadPool::help(std::shared_ptr<std::atomic<bool>> released)
+{
+    current_pool = this;
+    current_worker = -1;
+
+    while (!*released && !stopping)
+    {
+        if (!run_pending(-1))
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+
+    helpers -= 1;
+}
+
+
+void ThreadPool::work(int index)
+{
+    current_pool = this;
+    current_worker = index;
+
+    while (true)
+    {
+        if (run_pending(index))
+            continue;
+
+        std::unique_lock<std::mutex> lock(sleep_mutex);
+        wakeup.wait_for(lock, std::chrono::milliseconds(100), [this] { return stopping || pending > 0; });
+
+        if (stopping && pending == 0)
+            return;
+    }
+}
@@ -0,0 +1,91 @@
+#ifndef TOMATO_THREAD_POOL_HPP
+#define TOMATO_THREAD_POOL_HPP
+
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace Tomato::Runtime
+{
+    /**
+     * @brief Work-stealing thread pool.
+     *
+     * Every worker owns a deque: tasks submitted from a worker are pushed to
+     * and popped from the back of its own deque, idle workers steal from the
+     * front of others. Threads waiting for their tasks execute pending tasks
+     * instead of blocking, so tasks may submit and wait for nested tasks.
+     */
+    class ThreadPool
+    {
+    public:
+        using Task = std::function<void()>;
+
+        explicit ThreadPool(unsigned threads);
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool &) = delete;
+        ThreadPool &operator=(const ThreadPool &) = delete;
+
+        /**
+         * @brief Process-wide pool, size is $TOMATO_THREADS or number of hardware threads.
+         */
+        static ThreadPool &shared();
+
+        /**
+         * @brief Schedule task, task must not throw.
+         */
+        void submit(Task task);
+
+        /**
+         * @brief Execute pending tasks until condition becomes true.
+         *
+         * With nothing left to execute, the caller sleeps until some task finishes or is submitted.
+         */
+        void wait(const std::function<bool()> &done);
+
+        /**
+         * @brief Wait until condition becomes true without executing tasks.
+         *
+         * Used when condition depends on progress of other tasks, e.g. space in a channel.
+         * If the caller is a pool thread, a helper thread executes pending tasks meanwhile.
+         * @throw std::runtime_error Pool is being destroyed.
+         */
+        void block(const std::function<bool()> &done);
+
+        unsigned size() const;
+
+    private:
+        struct Queue
+        {
+            std::mutex mutex;
+            std::deque<Task> tasks;
+        };
+
+        bool run_pending(int self);
+        void work(int index);
+        void help(std::shared_ptr<std::atomic<bool>> released);
+
+    private:
+        std::vector<std::unique_ptr<Queue>> queues; // one per worker, the last one for external submissions
+        std::vector<std::thread> threads;
+
+        std::atomic<size_t> pending {0};
+        std::atomic<size_t> helpers {0};
+        std::atomic<size_t> waiting {0};
+        std::atomic<bool> stopping {false};
+
+        std::mutex sleep_mutex;
+        std::condition_variable wakeup;
+        std::condition_variable finished;   // threads waiting in wait() with nothing to execute
+    };
+}
+
+
+#endif //TOMATO_THREAD_POOL_HPP
@@ -0,0 +1,169 @@
+#include "analysis.hpp"
+
+#include <algorithm>
+
+
+using namespace Tomato::IR;
+
+
+DominatorTree::DominatorTree(const Function &function)
+{
+    // postorder by iterative depth-first search
+    std::vector<std::pair<Block *, size_t>> stack {{function.entry(), 0}};
+    std::set<const Block *> visited {function.entry()};
+
+    while (!stack.empty())
+    {
+        auto &[block, next] = stack.back();
+        auto successors = block->successors();
+
+        if (next < successors.size())
+        {
+            auto successor = successors[next++];
+
+            if (visited.insert(successor).second)
+                stack.emplace_back(successor, 0);
+
+            continue;
+        }
+
+        blocks.push_back(block);
+        stack.pop_back();
+    }
+
+    std::reverse(blocks.begin(), blocks.end());
+
+    for (size_t i = 0; i < blocks.size(); ++i)
+        number[blocks[i]] = i;
+
+    auto entry = function.entry();
+    immediate[entry] = entry;
+
+    auto intersect = [&] (Block *left, Block *right) {
+        while (left != right)
+        {
+            while (number[left] > number[right])
+                left = immediate[left];
+
+            while (number[right] > number[left])
+                right = immediate[right];
+        }
+
+        return left;
+    };
+
+    for (bool changed = true; changed;)
+    {
+        changed = false;
+
+        for (auto block : blocks)
+        {
+            if (block == entry)
+                continue;
+
+            Block *dominator = nullptr;
+
+            for (auto predecessor : block->predecessors)
+            {
+                if (!immediate.count(predecessor))
+                    continue;
+
+                dominator = dominator ? intersect(predecessor, dominator) : predecessor;
+            }
+
+            if (immediate[block] != dominator)
+            {
+                immediate[block] = dominator;
+                changed = true;
+            }
+        }
+    }
+
+    immediate[entry] = nullptr;
+
+    for (auto block : blocks)
+    {
+        if (auto dominator = immediate[block])
+            tree[dominator].push_back(block);
+    }
+}
+
+Block *DominatorTree::idom(const Block *block) const
+{
+    auto dominator = immediate.find(block);
+
+    return dominator == immediate.end() ? nullptr : dominator->second;
+}
+
+bool DominatorTree::dominates(const Block *dominator, const Block *block) const
+{
+    if (!reachable(dominator) || !reachable(block))
+        return false;
+
+    while (block && block != dominator)
+        block = idom(block);
+
+    return block == dominator;
+}
+
+bool DominatorTree::reachable(const Block *block) const
+{
+    return number.count(block) > 0;
+}
+
+const std::vector<Block *> &DominatorTree::children(const Block *block) const
+{
+    static const std::vector<Block *> none;
+
+    auto children = tree.find(block);
+
+    return children == tree.end() ? none : children->second;
+}
+
+const std::vector<Block *> &DominatorTree::order() const
+{
+    return blocks;
+}
+
+
+std::vector<Loop> Tomato::IR::find_loops(const Function &, const DominatorTree &dominators)
+{
+    std::vector<Loop> loops;
+
+    for (auto header : dominators.order())
+    {
+        Loop loop {header, {header}};
+        std::vector<Block *> pending;
+
+        for (auto predecessor : header->predecessors)
+        {
+            // back edge
+            if (dominators.dominates(header, predecessor) && loop.blocks.insert(predecessor).second)
+                pending.push_back(predecessor);
+        }
+
+        if (pending.empty() && !std::count(header->predecessors.begin(), header->predecessors.end(), header))
+            continue;
+
+        while (!pending.empty())
+        {
+            auto block = pending.back();
+            pending.pop_back();
+
+            for (auto predecessor : block->predecessors)
+            {
+                if (dominators.reachable(predecessor) && loop.blocks.insert(predecessor).second)
+                    pending.push_back(predecessor);
+            }
+        }
+
+        loops.push_back(std::move(loop));
+    }
+
+    // a loop contained in another one has fewer blocks
+    std::stable_sort(loops.begin(), loops.end(), [] (const Loop &left, const Loop &right) {
+        return left.blocks.size() < right.blocks.size();
+    });
+
+    return loops;
+}
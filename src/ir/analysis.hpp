@@ -0,0 +1,65 @@
+#ifndef TOMATO_IR_ANALYSIS_HPP
+#define TOMATO_IR_ANALYSIS_HPP
+
+
+#include <map>
+#include <set>
+#include <vector>
+
+#include "ir.hpp"
+
+
+namespace Tomato::IR
+{
+    /**
+     * @brief Dominators of blocks reachable from entry, by Cooper, Harvey and Kennedy's iterative algorithm.
+     */
+    class DominatorTree
+    {
+    public:
+        explicit DominatorTree(const Function &function);
+
+        /**
+         * @brief Immediate dominator, nullptr for entry and unreachable blocks.
+         */
+        Block *idom(const Block *block) const;
+
+        /**
+         * @brief Every block dominates itself, unreachable blocks dominate nothing.
+         */
+        bool dominates(const Block *dominator, const Block *block) const;
+
+        bool reachable(const Block *block) const;
+
+        const std::vector<Block *> &children(const Block *block) const;
+
+        /**
+         * @brief Reachable blocks in reverse postorder, dominators come before blocks they dominate.
+         */
+        const std::vector<Block *> &order() const;
+
+    private:
+        std::vector<Block *> blocks;
+        std::map<const Block *, size_t> number;             // position in reverse postorder
+        std::map<const Block *, Block *> immediate;
+        std::map<const Block *, std::vector<Block *>> tree;
+    };
+
+
+    /**
+     * @brief Natural loop, blocks of all back edges to the same header.
+     */
+    struct Loop
+    {
+        Block *header;
+        std::set<Block *> blocks;                           ///< Including header
+    };
+
+    /**
+     * @brief Loops of function, inner loops come before loops containing them.
+     */
+    std::vector<Loop> find_loops(const Function &function, const DominatorTree &dominators);
+}
+
+
+#endif //TOMATO_IR_ANALYSIS_HPP
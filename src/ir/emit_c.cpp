@@ -0,0 +1,674 @@
+#include "emit_c.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <set>
+#include <sstream>
+
+
+using namespace std::string_literals;
+using namespace Tomato;
+using namespace Tomato::IR;
+
+
+namespace
+{
+    /**
+     * Runtime support, each piece is written only if the program uses it.
+     * Reading emulates 'std::istream >>' of libstdc++: once reading fails, the stream stays failed
+     * and values are left unchanged.
+     */
+    enum class Helper { Power, Bits, Trap, Mod, Input, Unread, Integer, ReadInt, ReadFloat, ReadBool, ReadChar };
+
+    const std::map<Helper, const char *> helpers = {
+            {Helper::Power,
+             "static int tomato_power(int base, int exponent)\n"
+             "{\n"
+             "    unsigned result = 1;\n"
+             "    int bits = 0, i;\n"
+             "\n"
+             "    for (i = exponent; i > 0; i >>= 1)\n"
+             "        ++bits;\n"
+             "\n"
+             "    for (i = bits - 1; i >= 0; --i)\n"
+             "    {\n"
+             "        result *= result;\n"
+             "\n"
+             "        if (exponent & (1 << i))\n"
+             "            result *= (unsigned) base;\n"
+             "    }\n"
+             "\n"
+             "    return (int) result;\n"
+             "}\n"},
+
+            {Helper::Bits,
+             "static float tomato_float(uint32_t bits)\n"
+             "{\n"
+             "    float value;\n"
+             "    memcpy(&value, &bits, sizeof value);\n"
+             "    return value;\n"
+             "}\n"},
+
+            {Helper::Trap,
+             "#ifdef __GNUC__\n"
+             "__attribute__((noreturn))\n"
+             "#endif\n"
+             "static void tomato_trap(const char *message)\n"
+             "{\n"
+             "    printf(\"semantic error: %s\\n\", message);\n"
+             "    exit(0);\n"
+             "}\n"},
+
+            {Helper::Mod,
+             "static int tomato_mod(int dividend, int divisor)\n"
+             "{\n"
+             "    if (divisor == 0)\n"
+             "        tomato_trap(\"division by zero\");\n"
+             "\n"
+             "    /* INT_MIN % -1 overflows in C, though the remainder is 0 */\n"
+             "    return divisor == -1 ? 0 : dividend % divisor;\n"
+             "}\n"},
+
+            {Helper::Input,
+             "static int tomato_input_eof, tomato_input_fail;\n"
+             "\n"
+             "/* First non-space character, EOF if the stream is done */\n"
+             "static int tomato_skip(void)\n"
+             "{\n"
+             "    int c;\n"
+             "\n"
+             "    if (tomato_input_eof || tomato_input_fail)\n"
+             "    {\n"
+             "        tomato_input_fail = 1;\n"
+             "        return EOF;\n"
+             "    }\n"
+             "\n"
+             "    do\n"
+             "        c = getchar();\n"
+             "    while (c != EOF && isspace(c));\n"
+             "\n"
+             "    if (c == EOF)\n"
+             "        tomato_input_eof = tomato_input_fail = 1;\n"
+             "\n"
+             "    return c;\n"
+             "}\n"},
+
+            {Helper::Unread,
+             "/* Put back the character which ended a number */\n"
+             "static void tomato_unread(int c)\n"
+             "{\n"
+             "    if (c == EOF)\n"
+             "        tomato_input_eof = 1;\n"
+             "    else\n"
+             "        ungetc(c, stdin);\n"
+             "}\n"},
+
+            {Helper::Integer,
+             "/* Decimal integer, saturated beyond int, 0 without digits */\n"
+             "static int tomato_read_integer(int c, long long *value)\n"
+             "{\n"
+             "    int negative = 0, digits = 0;\n"
+             "\n"
+             "    *value = 0;\n"
+             "\n"
+             "    if (c == '+' || c == '-')\n"
+             "    {\n"
+             "        negative = c == '-';\n"
+             "        c = getchar();\n"
+             "    }\n"
+             "\n"
+             "    for (; c != EOF && isdigit(c); c = getchar(), digits = 1)\n"
+             "    {\n"
+             "        if (*value <= 2147483648LL)\n"
+             "            *value = *value * 10 + (c - '0');\n"
+             "    }\n"
+             "\n"
+             "    tomato_unread(c);\n"
+             "\n"
+             "    if (negative)\n"
+             "        *value = -*value;\n"
+             "\n"
+             "    if (!digits)\n"
+             "        tomato_input_fail = 1;\n"
+             "\n"
+             "    return digits;\n"
+             "}\n"},
+
+            {Helper::ReadInt,
+             "static int tomato_read_int(int old)\n"
+             "{\n"
+             "    long long value;\n"
+             "    int c = tomato_skip();\n"
+             "\n"
+             "    if (c == EOF)\n"
+             "        return old;\n"
+             "\n"
+             "    tomato_read_integer(c, &value);\n"
+             "\n"
+             "    if (value < INT_MIN || value > INT_MAX)\n"
+             "    {\n"
+             "        tomato_input_fail = 1;\n"
+             "        return value < 0 ? INT_MIN : INT_MAX;\n"
+             "    }\n"
+             "\n"
+             "    return (int) value;\n"
+             "}\n"},
+
+            {Helper::ReadFloat,
+             "static char tomato_text[128];\n"
+             "static size_t tomato_length;\n"
+             "\n"
+             "static int tomato_keep(int c)\n"
+             "{\n"
+             "    if (tomato_length < sizeof tomato_text - 1)\n"
+             "        tomato_text[tomato_length++] = (char) c;\n"
+             "\n"
+             "    return getchar();\n"
+             "}\n"
+             "\n"
+             "static float tomato_read_float(float old)\n"
+             "{\n"
+             "    int c = tomato_skip(), digits = 0;\n"
+             "    char *end;\n"
+             "    float value;\n"
+             "\n"
+             "    if (c == EOF)\n"
+             "        return old;\n"
+             "\n"
+             "    tomato_length = 0;\n"
+             "\n"
+             "    if (c == '+' || c == '-')\n"
+             "        c = tomato_keep(c);\n"
+             "\n"
+             "    for (; c != EOF && isdigit(c); digits = 1)\n"
+             "        c = tomato_keep(c);\n"
+             "\n"
+             "    if (c == '.')\n"
+             "    {\n"
+             "        for (c = tomato_keep(c); c != EOF && isdigit(c); digits = 1)\n"
+             "            c = tomato_keep(c);\n"
+             "    }\n"
+             "\n"
+             "    if (digits && (c == 'e' || c == 'E'))\n"
+             "    {\n"
+             "        c = tomato_keep(c);\n"
+             "\n"
+             "        if (c == '+' || c == '-')\n"
+             "            c = tomato_keep(c);\n"
+             "\n"
+             "        while (c != EOF && isdigit(c))\n"
+             "            c = tomato_keep(c);\n"
+             "    }\n"
+             "\n"
+             "    tomato_unread(c);\n"
+             "    tomato_text[tomato_length] = '\\0';\n"
+             "\n"
+             "    value = strtof(tomato_text, &end);\n"
+             "\n"
+             "    if (end == tomato_text || *end != '\\0')\n"
+             "    {\n"
+             "        tomato_input_fail = 1;\n"
+             "        return 0;\n"
+             "    }\n"
+             "\n"
+             "    if (isinf(value))\n"
+             "    {\n"
+             "        tomato_input_fail = 1;\n"
+             "        return value > 0 ? FLT_MAX : -FLT_MAX;\n"
+             "    }\n"
+             "\n"
+             "    return value;\n"
+             "}\n"},
+
+            {Helper::ReadBool,
+             "static bool tomato_read_bool(bool old)\n"
+             "{\n"
+             "    long long value;\n"
+             "    int c = tomato_skip();\n"
+             "\n"
+             "    if (c == EOF)\n"
+             "        return old;\n"
+             "\n"
+             "    if (!tomato_read_integer(c, &value))\n"
+             "        return false;\n"
+             "\n"
+             "    if (value != 0 && value != 1)\n"
+             "        tomato_input_fail = 1;\n"
+             "\n"
+             "    return value != 0;\n"
+             "}\n"},
+
+            {Helper::ReadChar,
+             "static char tomato_read_char(char old)\n"
+             "{\n"
+             "    int c = tomato_skip();\n"
+             "    return c == EOF ? old : (char) c;\n"
+             "}\n"},
+    };
+
+
+    class Emitter
+    {
+    public:
+        explicit Emitter(const Module &module) : module(module) {}
+
+        void emit(std::ostream &stream)
+        {
+            std::stringstream declarations, functions;
+
+            for (auto &function : module.functions)
+            {
+                declarations << signature(*function) << ";\n";
+                functions << "\n";
+                emit(*function, functions);
+            }
+
+            stream << "#include <ctype.h>\n"
+                      "#include <float.h>\n"
+                      "#include <limits.h>\n"
+                      "#include <math.h>\n"
+                      "#include <stdbool.h>\n"
+                      "#include <stdint.h>\n"
+                      "#include <stdio.h>\n"
+                      "#include <stdlib.h>\n"
+                      "#include <string.h>\n"
+                      "\n";
+
+            if (used.count(Helper::Mod))
+                used.insert(Helper::Trap);
+
+            if (used.count(Helper::ReadInt) || used.count(Helper::ReadBool))
+                used.insert(Helper::Integer);
+
+            if (used.count(Helper::Integer) || used.count(Helper::ReadFloat))
+                used.insert(Helper::Unread);
+
+            if (used.count(Helper::Unread) || used.count(Helper::ReadChar))
+                used.insert(Helper::Input);
+
+            for (auto &[helper, code] : helpers)
+            {
+                if (used.count(helper))
+                    stream << code << "\n";
+            }
+
+            stream << declarations.str()
+                   << functions.str()
+                   << "\n"
+                      "int main(void)\n"
+                      "{\n"
+                      "    " << name(*module.functions.back()) << "();\n"
+                      "    return 0;\n"
+                      "}\n";
+        }
+
+    private:
+        void emit(const Function &function, std::ostream &stream)
+        {
+            values.clear();
+            std::map<Type, std::vector<std::string>> locals;
+            std::set<const Block *> targets;
+
+            for (auto &block : function.blocks)
+            {
+                for (auto &instruction : block->instructions)
+                {
+                    for (auto target : instruction->targets)
+                        targets.insert(target);
+
+                    if (instruction->type == Type::Void || instruction->opcode == Opcode::Constant)
+                        continue;
+
+                    auto number = std::to_string(values.size());
+                    values[instruction.get()] = "v" + number;
+                    locals[instruction->type].push_back("v" + number);
+
+                    // phis are assigned on edges to a copy first, so that phis of one block don't see each other's new values
+                    if (instruction->opcode == Opcode::Phi)
+                        locals[instruction->type].push_back("p" + number);
+                }
+            }
+
+            stream << signature(function) << "\n{\n";
+
+            for (auto &[type, names] : locals)
+            {
+                stream << "    " << c_type(type);
+
+                for (size_t i = 0; i < names.size(); ++i)
+                    stream << (i == 0 ? " " : ", ") << names[i];
+
+                stream << ";\n";
+            }
+
+            if (!locals.empty())
+                stream << "\n";
+
+            for (auto &block : function.blocks)
+            {
+                if (targets.count(block.get()))
+                    stream << "\nb" << block->id << ":\n";
+
+                for (auto &instruction : block->instructions)
+                    emit(*instruction, stream);
+            }
+
+            stream << "}\n";
+        }
+
+        void emit(const Instruction &instruction, std::ostream &stream)
+        {
+            auto &operands = instruction.operands;
+
+            switch (instruction.opcode)
+            {
+                case Opcode::Constant:
+                    return;
+
+                case Opcode::Parameter:
+                    assign(instruction, stream) << "a" << instruction.index << ";\n";
+                    return;
+
+                case Opcode::Undefined:
+                    assign(instruction, stream) << "0;\n";
+                    return;
+
+                case Opcode::Binary:
+                    assign(instruction, stream) << binary(instruction) << ";\n";
+                    return;
+
+                case Opcode::Phi:
+                    assign(instruction, stream) << "p" << values.at(&instruction).substr(1) << ";\n";
+                    return;
+
+                case Opcode::Call:
+                    if (instruction.type == Type::Void)
+                        stream << "    ";
+                    else
+                        assign(instruction, stream);
+
+                    stream << name(*instruction.callee) << "(";
+
+                    for (size_t i = 0; i < operands.size(); ++i)
+                        stream << (i == 0 ? "" : ", ") << value(operands[i]);
+
+                    stream << ");\n";
+                    return;
+
+                case Opcode::Print:
+                    switch (operands[0]->type)
+                    {
+                        case Type::Int:
+                            stream << "    printf(\"%d\\n\", " << value(operands[0]) << ");\n";
+                            return;
+
+                        case Type::Float:
+                            stream << "    printf(\"%g\\n\", (double) " << value(operands[0]) << ");\n";
+                            return;
+
+                        case Type::Bool:
+                            stream << "    puts(" << value(operands[0]) << " ? \"true\" : \"false\");\n";
+                            return;
+
+                        default:
+                            stream << "    printf(\"%c\\n\", " << value(operands[0]) << ");\n";
+                            return;
+                    }
+
+                case Opcode::Read:
+                {
+                    static const std::map<Type, std::pair<Helper, const char *>> readers = {
+                            {Type::Int,   {Helper::ReadInt,   "tomato_read_int"}},
+                            {Type::Float, {Helper::ReadFloat, "tomato_read_float"}},
+                            {Type::Bool,  {Helper::ReadBool,  "tomato_read_bool"}},
+                            {Type::Char,  {Helper::ReadChar,  "tomato_read_char"}},
+                    };
+
+                    auto &[helper, function] = readers.at(instruction.type);
+                    used.insert(helper);
+
+                    assign(instruction, stream) << function << "(" << value(operands[0]) << ");\n";
+                    return;
+                }
+
+                case Opcode::Jump:
+                    for (auto &statement : edge(instruction.block, instruction.targets[0]))
+                        stream << "    " << statement << "\n";
+
+                    return;
+
+                case Opcode::Branch:
+                    stream << "    if (" << value(operands[0]) << ")\n";
+                    write(edge(instruction.block, instruction.targets[0]), stream);
+                    stream << "    else\n";
+                    write(edge(instruction.block, instruction.targets[1]), stream);
+                    return;
+
+                case Opcode::Return:
+                    stream << "    return" << (operands.empty() ? "" : " " + value(operands[0])) << ";\n";
+                    return;
+
+                case Opcode::Trap:
+                    used.insert(Helper::Trap);
+                    stream << "    tomato_trap(" << quote(instruction.message) << ");\n";
+                    return;
+            }
+        }
+
+        /**
+         * Statements assigning phis of target their values coming from block and jumping there.
+         */
+        std::vector<std::string> edge(const Block *block, const Block *target)
+        {
+            std::vector<std::string> statements;
+
+            // all edges from a block to the same target carry the same values
+            auto i = std::find(target->predecessors.begin(), target->predecessors.end(), block) - target->predecessors.begin();
+
+            for (auto &instruction : target->instructions)
+            {
+                if (instruction->opcode != Opcode::Phi)
+                    break;
+
+                statements.push_back("p" + values.at(instruction.get()).substr(1) + " = " + value(instruction->operands[i]) + ";");
+            }
+
+            statements.push_back("goto b" + std::to_string(target->id) + ";");
+            return statements;
+        }
+
+        static void write(const std::vector<std::string> &statements, std::ostream &stream)
+        {
+            if (statements.size() == 1)
+            {
+                stream << "        " << statements[0] << "\n";
+                return;
+            }
+
+            stream << "    {\n";
+
+            for (auto &statement : statements)
+                stream << "        " << statement << "\n";
+
+            stream << "    }\n";
+        }
+
+        std::ostream &assign(const Instruction &instruction, std::ostream &stream)
+        {
+            return stream << "    " << values.at(&instruction) << " = ";
+        }
+
+        std::string binary(const Instruction &instruction)
+        {
+            auto left = instruction.operands[0], right = instruction.operands[1];
+            auto l = value(left), r = value(right);
+
+            static const std::map<BinaryOperator, const char *> symbols = {
+                    {BinaryOperator::Plus, "+"}, {BinaryOperator::Minus, "-"}, {BinaryOperator::Mul, "*"},
+                    {BinaryOperator::Div, "/"}, {BinaryOperator::Mod, "%"},
+                    {BinaryOperator::LT, "<"}, {BinaryOperator::LE, "<="}, {BinaryOperator::EQ, "=="},
+                    {BinaryOperator::NE, "!="}, {BinaryOperator::GE, ">="}, {BinaryOperator::GT, ">"},
+                    {BinaryOperator::And, "&&"}, {BinaryOperator::Or, "||"}, {BinaryOperator::Xor, "!="},
+            };
+
+            auto symbol = " "s + (instruction.operation == BinaryOperator::Exp ? "" : symbols.at(instruction.operation)) + " ";
+
+            switch (instruction.type)
+            {
+                case Type::Char:
+                    return "(char) ((char) " + l + symbol + "(char) " + r + ")";
+
+                case Type::Int:
+                    if (instruction.operation == BinaryOperator::Exp)
+                    {
+                        used.insert(Helper::Power);
+                        return "tomato_power(" + l + ", " + r + ")";
+                    }
+
+                    if (instruction.operation == BinaryOperator::Mod)
+                    {
+                        // divisor of zero and -1 are undefined behaviour in C, others are left to the operator
+                        if (right->opcode == Opcode::Constant && right->constant.int_value != 0
+                            && right->constant.int_value != -1)
+                            return l + symbol + r;
+
+                        used.insert(Helper::Mod);
+                        return "tomato_mod(" + l + ", " + r + ")";
+                    }
+
+                    // signed overflow wraps around as it does in the interpreter
+                    return "(int) ((unsigned) " + l + symbol + "(unsigned) " + r + ")";
+
+                case Type::Float:
+                    if (left->type == Type::Int)
+                        l = "(float) " + l;
+
+                    if (right->type == Type::Int)
+                        r = "(float) " + r;
+
+                    if (instruction.operation == BinaryOperator::Exp)
+                        return "powf(" + l + ", " + r + ")";
+
+                    return l + symbol + r;
+
+                default:
+                    if (left->type != right->type)
+                    {
+                        if (left->type == Type::Int)
+                            l = "(float) " + l;
+                        else
+                            r = "(float) " + r;
+                    }
+
+                    return l + symbol + r;
+            }
+        }
+
+        std::string value(const Instruction *instruction)
+        {
+            if (instruction->opcode != Opcode::Constant)
+                return values.at(instruction);
+
+            auto &constant = instruction->constant;
+
+            switch (constant.type)
+            {
+                case Type::Int:
+                    if (constant.int_value == INT32_MIN)
+                        return "(-2147483647 - 1)";
+
+                    return constant.int_value < 0 ? "(" + std::to_string(constant.int_value) + ")"
+                                                  : std::to_string(constant.int_value);
+
+                case Type::Float:
+                {
+                    if (!std::isfinite(constant.float_value))
+                    {
+                        uint32_t bits;
+                        std::memcpy(&bits, &constant.float_value, sizeof bits);
+
+                        used.insert(Helper::Bits);
+
+                        std::stringstream literal;
+                        literal << "tomato_float(0x" << std::hex << bits << "u)";
+                        return literal.str();
+                    }
+
+                    // hexadecimal literal is exact
+                    char literal[64];
+                    std::snprintf(literal, sizeof literal, "%af", double(constant.float_value));
+
+                    return std::signbit(constant.float_value) ? "("s + literal + ")" : literal;
+                }
+
+                case Type::Bool:
+                    return constant.bool_value ? "true" : "false";
+
+                default:
+                    return "((char) " + std::to_string(int(constant.char_value)) + ")";
+            }
+        }
+
+        static std::string quote(const std::string &text)
+        {
+            std::stringstream literal;
+            literal << "\"";
+
+            for (unsigned char c : text)
+            {
+                if (c == '"' || c == '\\')
+                    literal << '\\' << c;
+                else if (c < 32 || c >= 127 || c == '?')
+                    // octal escape never takes more than three digits, so any character may follow
+                    literal << '\\' << char('0' + (c >> 6)) << char('0' + ((c >> 3) & 7)) << char('0' + (c & 7));
+                else
+                    literal << c;
+            }
+
+            literal << "\"";
+            return literal.str();
+        }
+
+        static std::string c_type(Type type)
+        {
+            switch (type)
+            {
+                case Type::Int:     return "int";
+                case Type::Float:   return "float";
+                case Type::Bool:    return "bool";
+                case Type::Char:    return "char";
+                default:            return "void";
+            }
+        }
+
+        std::string name(const Function &function) const
+        {
+            // prefix keeps names of the language apart from C keywords and library
+            return &function == module.functions.back().get() ? "tomato_program" : "f_" + function.name;
+        }
+
+        std::string signature(const Function &function) const
+        {
+            std::string text = "static " + c_type(function.return_type) + " " + name(function) + "(";
+
+            for (size_t i = 0; i < function.parameters.size(); ++i)
+                text += (i == 0 ? "" : ", ") + c_type(function.parameters[i]) + " a" + std::to_string(i);
+
+            return text + (function.parameters.empty() ? "void)" : ")");
+        }
+
+    private:
+        const Module &module;
+
+        std::map<const Instruction *, std::string> values;
+        std::set<Helper> used;
+    };
+}
+
+
+void IR::emit_c(const Module &module, std::ostream &stream)
+{
+    Emitter(module).emit(stream);
+}
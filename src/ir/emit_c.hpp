@@ -0,0 +1,23 @@
+#ifndef TOMATO_IR_EMIT_C_HPP
+#define TOMATO_IR_EMIT_C_HPP
+
+
+#include <ostream>
+
+#include "ir.hpp"
+
+
+namespace Tomato::IR
+{
+    /**
+     * @brief Write module as a standalone C99 program, which needs only the C standard library.
+     *
+     * Operations compute what Runtime::Operations does: int arithmetic wraps, int '/' gives float,
+     * int '^' is the interpreter's integer power. Values are printed and read as C++ streams do,
+     * runtime errors print the interpreter's "semantic error: ..." and stop the program.
+     */
+    void emit_c(const Module &module, std::ostream &stream);
+}
+
+
+#endif //TOMATO_IR_EMIT_C_HPP
@@ -0,0 +1,511 @@
+#include "ir.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <set>
+
+#include "interpreter/operations.hpp"
+
+
+using namespace Tomato;
+using namespace Tomato::IR;
+
+
+std::string IR::to_string(Type type)
+{
+    switch (type)
+    {
+        case Type::Void:    return "void";
+        case Type::Int:     return "int";
+        case Type::Float:   return "float";
+        case Type::Bool:    return "bool";
+        case Type::Char:    return "char";
+    }
+
+    return "?";
+}
+
+
+Constant Constant::of(int value)
+{
+    Constant constant;
+    constant.type = Type::Int;
+    constant.int_value = value;
+    return constant;
+}
+
+Constant Constant::of(float value)
+{
+    Constant constant;
+    constant.type = Type::Float;
+    constant.float_value = value;
+    return constant;
+}
+
+Constant Constant::of(bool value)
+{
+    Constant constant;
+    constant.type = Type::Bool;
+    constant.bool_value = value;
+    return constant;
+}
+
+Constant Constant::of(char value)
+{
+    Constant constant;
+    constant.type = Type::Char;
+    constant.char_value = value;
+    return constant;
+}
+
+Constant Constant::initial(Type type)
+{
+    switch (type)
+    {
+        case Type::Int:     return of(0);
+        case Type::Float:   return of(0.0f);
+        case Type::Bool:    return of(false);
+        case Type::Char:    return of('a');
+        default:            return {};
+    }
+}
+
+bool Constant::operator==(const Constant &other) const
+{
+    if (type != other.type)
+        return false;
+
+    switch (type)
+    {
+        case Type::Int:     return int_value == other.int_value;
+        case Type::Float:   return std::memcmp(&float_value, &other.float_value, sizeof(float)) == 0;
+        case Type::Bool:    return bool_value == other.bool_value;
+        case Type::Char:    return char_value == other.char_value;
+        default:            return true;
+    }
+}
+
+bool Constant::operator!=(const Constant &other) const
+{
+    return !(*this == other);
+}
+
+bool Constant::operator<(const Constant &other) const
+{
+    if (type != other.type)
+        return type < other.type;
+
+    switch (type)
+    {
+        case Type::Int:     return int_value < other.int_value;
+        case Type::Float:   return std::memcmp(&float_value, &other.float_value, sizeof(float)) < 0;
+        case Type::Bool:    return bool_value < other.bool_value;
+        case Type::Char:    return char_value < other.char_value;
+        default:            return false;
+    }
+}
+
+std::ostream &IR::operator<<(std::ostream &stream, const Constant &constant)
+{
+    switch (constant.type)
+    {
+        case Type::Int:     return stream << constant.int_value;
+        case Type::Float:   return stream << constant.float_value;
+        case Type::Bool:    return stream << (constant.bool_value ? "true" : "false");
+        case Type::Char:    return stream << '\'' << constant.char_value << '\'';
+        default:            return stream << "void";
+    }
+}
+
+
+Instruction::Instruction(Opcode opcode, Type type) : opcode(opcode), type(type) {}
+
+bool Instruction::terminator() const
+{
+    return opcode == Opcode::Jump || opcode == Opcode::Branch || opcode == Opcode::Return || opcode == Opcode::Trap;
+}
+
+bool Instruction::side_effects() const
+{
+    return terminator() || opcode == Opcode::Call || opcode == Opcode::Print || opcode == Opcode::Read;
+}
+
+bool Instruction::may_trap() const
+{
+    // int remainder by zero crashes the interpreter, it must not be introduced or removed
+    return opcode == Opcode::Binary && operation == BinaryOperator::Mod
+           && !(operands[1]->opcode == Opcode::Constant && operands[1]->constant.int_value != 0);
+}
+
+
+Block::Block(size_t id) : id(id) {}
+
+Instruction *Block::terminator() const
+{
+    if (instructions.empty() || !instructions.back()->terminator())
+        return nullptr;
+
+    return instructions.back().get();
+}
+
+std::vector<Block *> Block::successors() const
+{
+    if (auto last = terminator())
+        return last->targets;
+
+    return {};
+}
+
+Instruction *Block::insert(std::unique_ptr<Instruction> instruction)
+{
+    instruction->block = this;
+
+    auto position = terminator() ? instructions.end() - 1 : instructions.end();
+
+    return instructions.insert(position, std::move(instruction))->get();
+}
+
+
+Block *Function::entry() const
+{
+    return blocks.front().get();
+}
+
+Block *Function::add_block()
+{
+    blocks.push_back(std::make_unique<Block>(next_block++));
+    return blocks.back().get();
+}
+
+void Function::replace_uses(Instruction *value, Instruction *replacement)
+{
+    for (auto &block : blocks)
+    {
+        for (auto &instruction : block->instructions)
+            std::replace(instruction->operands.begin(), instruction->operands.end(), value, replacement);
+    }
+}
+
+void Function::remove_edge(Block *block, Block *successor)
+{
+    auto &predecessors = successor->predecessors;
+    auto position = std::find(predecessors.begin(), predecessors.end(), block) - predecessors.begin();
+
+    predecessors.erase(predecessors.begin() + position);
+
+    for (auto &instruction : successor->instructions)
+    {
+        if (instruction->opcode == Opcode::Phi)
+            instruction->operands.erase(instruction->operands.begin() + position);
+    }
+}
+
+bool Function::remove_unreachable()
+{
+    std::set<Block *> reached {entry()};
+    std::vector<Block *> pending {entry()};
+
+    while (!pending.empty())
+    {
+        auto block = pending.back();
+        pending.pop_back();
+
+        for (auto successor : block->successors())
+        {
+            if (reached.insert(successor).second)
+                pending.push_back(successor);
+        }
+    }
+
+    if (reached.size() == blocks.size())
+        return false;
+
+    for (auto &block : blocks)
+    {
+        if (reached.count(block.get()))
+            continue;
+
+        for (auto successor : block->successors())
+        {
+            if (reached.count(successor))
+                remove_edge(block.get(), successor);
+        }
+    }
+
+    blocks.erase(std::remove_if(blocks.begin(), blocks.end(), [&] (const std::unique_ptr<Block> &block) {
+        return !reached.count(block.get());
+    }), blocks.end());
+
+    return true;
+}
+
+
+Function *Module::function(const std::string &name) const
+{
+    for (auto &function : functions)
+    {
+        if (function->name == name)
+            return function.get();
+    }
+
+    return nullptr;
+}
+
+
+Type IR::binary_type(BinaryOperator operation, Type left, Type right)
+{
+    bool numbers = (left == Type::Int || left == Type::Float) && (right == Type::Int || right == Type::Float);
+    bool integers = left == Type::Int && right == Type::Int;
+
+    switch (operation)
+    {
+        case BinaryOperator::Plus:
+        case BinaryOperator::Minus:
+            if ((left == Type::Char && right == Type::Int) || (left == Type::Int && right == Type::Char))
+                return Type::Char;
+            [[fallthrough]];
+
+        case BinaryOperator::Mul:
+        case BinaryOperator::Exp:
+            if (integers)
+                return Type::Int;
+            return numbers ? Type::Float : Type::Void;
+
+        case BinaryOperator::Div:
+            return numbers ? Type::Float : Type::Void;
+
+        case BinaryOperator::Mod:
+            return integers ? Type::Int : Type::Void;
+
+        case BinaryOperator::LT:
+        case BinaryOperator::LE:
+        case BinaryOperator::EQ:
+        case BinaryOperator::NE:
+        case BinaryOperator::GE:
+        case BinaryOperator::GT:
+            return numbers ? Type::Bool : Type::Void;
+
+        case BinaryOperator::And:
+        case BinaryOperator::Or:
+        case BinaryOperator::Xor:
+            return left == Type::Bool && right == Type::Bool ? Type::Bool : Type::Void;
+    }
+
+    return Type::Void;
+}
+
+
+namespace
+{
+    template<typename G, typename L, typename R>
+    std::optional<Constant> arithmetic(BinaryOperator operation, L left, R right)
+    {
+        switch (operation)
+        {
+            case BinaryOperator::Plus:  return Constant::of(Runtime::Sum<L, R, G>(left, right));
+            case BinaryOperator::Minus: return Constant::of(Runtime::Sub<L, R, G>(left, right));
+            case BinaryOperator::Mul:   return Constant::of(Runtime::Mul<L, R, G>(left, right));
+            case BinaryOperator::Div:   return Constant::of(Runtime::Div<L, R, G>(left, right));
+            case BinaryOperator::Exp:   return Constant::of(Runtime::Exp<L, R, G>(left, right));
+            case BinaryOperator::EQ:    return Constant::of(Runtime::EQ<L, R>(left, right));
+            case BinaryOperator::NE:    return Constant::of(Runtime::NE<L, R>(left, right));
+            case BinaryOperator::LT:    return Constant::of(Runtime::LT<L, R>(left, right));
+            case BinaryOperator::LE:    return Constant::of(Runtime::LE<L, R>(left, right));
+            case BinaryOperator::GE:    return Constant::of(Runtime::GE<L, R>(left, right));
+            case BinaryOperator::GT:    return Constant::of(Runtime::GT<L, R>(left, right));
+            default:                    return std::nullopt;
+        }
+    }
+}
+
+
+std::optional<Constant> IR::fold(BinaryOperator operation, const Constant &left, const Constant &right)
+{
+    auto type = binary_type(operation, left.type, right.type);
+
+    if (type == Type::Void)
+        return std::nullopt;
+
+    auto l = left.type, r = right.type;
+
+    if (type == Type::Char)
+    {
+        if (l == Type::Char)
+            return operation == BinaryOperator::Plus
+                   ? Constant::of(Runtime::Sum<char, int, char>(left.char_value, right.int_value))
+                   : Constant::of(Runtime::Sub<char, int, char>(left.char_value, right.int_value));
+
+        return operation == BinaryOperator::Plus
+               ? Constant::of(Runtime::Sum<int, char, char>(left.int_value, right.char_value))
+               : Constant::of(Runtime::Sub<int, char, char>(left.int_value, right.char_value));
+    }
+
+    if (l == Type::Bool)
+    {
+        switch (operation)
+        {
+            case BinaryOperator::And:   return Constant::of(Runtime::And(left.bool_value, right.bool_value));
+            case BinaryOperator::Or:    return Constant::of(Runtime::Or(left.bool_value, right.bool_value));
+            default:                    return Constant::of(Runtime::Xor(left.bool_value, right.bool_value));
+        }
+    }
+
+    if (l == Type::Int && r == Type::Int)
+    {
+        auto a = left.int_value, b = right.int_value;
+
+        switch (operation)
+        {
+            // remainder by zero is left to run time
+            case BinaryOperator::Mod:   return b == 0 ? std::nullopt : std::optional(Constant::of(Runtime::Mod<int, int, int>(a, b)));
+            case BinaryOperator::Div:   return Constant::of(Runtime::Div<int, int, float>(a, b));
+            default:                    return arithmetic<int>(operation, a, b);
+        }
+    }
+
+    if (l == Type::Int)
+        return arithmetic<float>(operation, left.int_value, right.float_value);
+
+    if (r == Type::Int)
+        return arithmetic<float>(operation, left.float_value, right.int_value);
+
+    return arithmetic<float>(operation, left.float_value, right.float_value);
+}
+
+
+int IR::power(int base, int exponent)
+{
+    return Runtime::Exp<int, int, int>(base, exponent);
+}
+
+
+namespace
+{
+    std::string name(Opcode opcode, BinaryOperator operation)
+    {
+        switch (opcode)
+        {
+            case Opcode::Parameter: return "param";
+            case Opcode::Constant:  return "const";
+            case Opcode::Undefined: return "undef";
+            case Opcode::Phi:       return "phi";
+            case Opcode::Call:      return "call";
+            case Opcode::Print:     return "print";
+            case Opcode::Read:      return "read";
+            case Opcode::Jump:      return "jump";
+            case Opcode::Branch:    return "branch";
+            case Opcode::Return:    return "return";
+            case Opcode::Trap:      return "trap";
+            case Opcode::Binary:    break;
+        }
+
+        switch (operation)
+        {
+            case BinaryOperator::Plus:  return "add";
+            case BinaryOperator::Minus: return "sub";
+            case BinaryOperator::Mul:   return "mul";
+            case BinaryOperator::Div:   return "div";
+            case BinaryOperator::Mod:   return "mod";
+            case BinaryOperator::Exp:   return "exp";
+            case BinaryOperator::LT:    return "lt";
+            case BinaryOperator::LE:    return "le";
+            case BinaryOperator::EQ:    return "eq";
+            case BinaryOperator::NE:    return "ne";
+            case BinaryOperator::GE:    return "ge";
+            case BinaryOperator::GT:    return "gt";
+            case BinaryOperator::And:   return "and";
+            case BinaryOperator::Or:    return "or";
+            case BinaryOperator::Xor:   return "xor";
+        }
+
+        return "?";
+    }
+}
+
+
+void IR::dump(const Function &function, std::ostream &stream)
+{
+    std::map<const Instruction *, size_t> numbers;
+
+    for (auto &block : function.blocks)
+    {
+        for (auto &instruction : block->instructions)
+        {
+            if (instruction->type != Type::Void)
+                numbers.emplace(instruction.get(), numbers.size());
+        }
+    }
+
+    auto value = [&] (const Instruction *instruction) {
+        auto number = numbers.find(instruction);
+        return number == numbers.end() ? std::string("%?") : "%" + std::to_string(number->second);
+    };
+
+    stream << "func " << function.name << "(";
+
+    for (size_t i = 0; i < function.parameters.size(); ++i)
+        stream << (i == 0 ? "" : ", ") << to_string(function.parameters[i]);
+
+    stream << ") -> " << to_string(function.return_type) << "\n";
+
+    for (auto &block : function.blocks)
+    {
+        stream << "b" << block->id << ":";
+
+        if (!block->predecessors.empty())
+        {
+            stream << "    ; from";
+
+            for (auto predecessor : block->predecessors)
+                stream << " b" << predecessor->id;
+        }
+
+        stream << "\n";
+
+        for (auto &instruction : block->instructions)
+        {
+            stream << "    ";
+
+            if (instruction->type != Type::Void)
+                stream << value(instruction.get()) << " = ";
+
+            stream << name(instruction->opcode, instruction->operation);
+
+            if (instruction->type != Type::Void)
+                stream << " " << to_string(instruction->type);
+
+            switch (instruction->opcode)
+            {
+                case Opcode::Parameter: stream << " " << instruction->index; break;
+                case Opcode::Constant:  stream << " " << instruction->constant; break;
+                case Opcode::Call:      stream << " " << instruction->callee->name; break;
+                case Opcode::Trap:      stream << " \"" << instruction->message << "\""; break;
+                default: break;
+            }
+
+            for (size_t i = 0; i < instruction->operands.size(); ++i)
+            {
+                stream << (i == 0 ? " " : ", ") << value(instruction->operands[i]);
+
+                if (instruction->opcode == Opcode::Phi && i < block->predecessors.size())
+                    stream << " b" << block->predecessors[i]->id;
+            }
+
+            for (size_t i = 0; i < instruction->targets.size(); ++i)
+                stream << (i == 0 && instruction->operands.empty() ? " " : ", ") << "b" << instruction->targets[i]->id;
+
+            stream << "\n";
+        }
+    }
+}
+
+void IR::dump(const Module &module, std::ostream &stream)
+{
+    for (size_t i = 0; i < module.functions.size(); ++i)
+    {
+        if (i > 0)
+            stream << "\n";
+
+        dump(*module.functions[i], stream);
+    }
+}
@@ -0,0 +1,199 @@
+#ifndef TOMATO_IR_HPP
+#define TOMATO_IR_HPP
+
+
+#include <map>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "operators.hpp"
+
+
+namespace Tomato::IR
+{
+    /**
+     * @brief Types of values, the builtin scalar types of the language.
+     */
+    enum class Type { Void, Int, Float, Bool, Char };
+
+    std::string to_string(Type type);
+
+
+    struct Constant
+    {
+        Type type = Type::Void;
+
+        int int_value = 0;
+        float float_value = 0;
+        bool bool_value = false;
+        char char_value = 0;
+
+        static Constant of(int value);
+        static Constant of(float value);
+        static Constant of(bool value);
+        static Constant of(char value);
+
+        /**
+         * @brief Value of type declared without initializer, e.g. 'var x int'.
+         */
+        static Constant initial(Type type);
+
+        /**
+         * @brief Floats are compared bitwise, so 0.0 and -0.0 differ and NaN equals itself.
+         */
+        bool operator==(const Constant &other) const;
+        bool operator!=(const Constant &other) const;
+        bool operator<(const Constant &other) const;
+    };
+
+    std::ostream &operator<<(std::ostream &stream, const Constant &constant);
+
+
+    enum class Opcode
+    {
+        Parameter,      ///< Function argument number 'index'
+        Constant,       ///< 'constant'
+        Undefined,      ///< Value of variable on a path which is never executed
+        Binary,         ///< 'operation' on two operands, as Runtime::Operations defines it
+        Phi,            ///< Operand i comes from predecessor i of the block
+        Call,           ///< 'callee' with operands as arguments
+        Print,          ///< Write operand to output
+        Read,           ///< Value of 'type' read from input
+
+        // Terminators, the last instruction of every block
+        Jump,           ///< To targets[0]
+        Branch,         ///< To targets[0] if bool operand is true, else to targets[1]
+        Return,         ///< Operand is the result, none for function returning nothing
+        Trap,           ///< Runtime error with 'message', execution stops
+    };
+
+
+    struct Block;
+    struct Function;
+
+
+    /**
+     * @brief Instruction and the value it defines.
+     */
+    struct Instruction
+    {
+        Instruction(Opcode opcode, Type type);
+
+        Opcode opcode;
+        Type type;                              ///< Type of the result, Void if there is none
+
+        std::vector<Instruction *> operands;
+        std::vector<Block *> targets;
+
+        BinaryOperator operation = BinaryOperator::Plus;
+        Constant constant;
+        size_t index = 0;
+        Function *callee = nullptr;
+        std::string message;
+
+        Block *block = nullptr;
+
+        bool terminator() const;
+
+        /**
+         * @brief Instruction can't be removed or moved even if its value is unused.
+         */
+        bool side_effects() const;
+
+        /**
+         * @brief Instruction may stop the program, e.g. int remainder by zero.
+         */
+        bool may_trap() const;
+    };
+
+
+    struct Block
+    {
+        explicit Block(size_t id);
+
+        size_t id;
+
+        std::vector<std::unique_ptr<Instruction>> instructions;   ///< Phis first, terminator last
+        std::vector<Block *> predecessors;                        ///< With repetitions, parallel to phi operands
+
+        Instruction *terminator() const;
+        std::vector<Block *> successors() const;
+
+        /**
+         * @brief Insert before terminator, or at the end if there is none yet.
+         */
+        Instruction *insert(std::unique_ptr<Instruction> instruction);
+    };
+
+
+    struct Function
+    {
+        std::string name;
+        std::vector<Type> parameters;
+        Type return_type = Type::Void;
+
+        std::vector<std::unique_ptr<Block>> blocks;               ///< The first one is entry
+
+        Block *entry() const;
+        Block *add_block();
+
+        /**
+         * @brief Make every use of value refer to replacement.
+         */
+        void replace_uses(Instruction *value, Instruction *replacement);
+
+        /**
+         * @brief Remove edge from block to successor, with the matching operands of successor's phis.
+         */
+        void remove_edge(Block *block, Block *successor);
+
+        /**
+         * @brief Remove blocks not reachable from entry.
+         * @return Whether anything was removed.
+         */
+        bool remove_unreachable();
+
+    private:
+        size_t next_block = 0;
+    };
+
+
+    /**
+     * @brief Functions of a program and its top-level statements as function '$program'.
+     */
+    struct Module
+    {
+        std::vector<std::unique_ptr<Function>> functions;         ///< In order of definition, program is the last
+
+        Function *function(const std::string &name) const;
+    };
+
+
+    /**
+     * @brief Result type of binary operation, Void if Runtime::Operations doesn't define it.
+     */
+    Type binary_type(BinaryOperator operation, Type left, Type right);
+
+    /**
+     * @brief Compute operation the way the interpreter does, std::nullopt if result isn't known at compile time.
+     */
+    std::optional<Constant> fold(BinaryOperator operation, const Constant &left, const Constant &right);
+
+    /**
+     * @brief Integer power the way Runtime::Operations computes it, 1 for negative exponent.
+     */
+    int power(int base, int exponent);
+
+
+    /**
+     * @brief Write module as text, values are numbered in order of definition.
+     */
+    void dump(const Module &module, std::ostream &stream);
+    void dump(const Function &function, std::ostream &stream);
+}
+
+
+#endif //TOMATO_IR_HPP
@@ -0,0 +1,972 @@
+#include "lowering.hpp"
+
+#include <set>
+
+#include "semantic/effects.hpp"
+
+
+using namespace Tomato;
+using namespace Tomato::IR;
+
+
+namespace
+{
+    /**
+     * Runtime error found while lowering an expression, the statement containing it ends with a trap.
+     */
+    struct Trapped
+    {
+        std::string message;
+    };
+
+
+    struct Variable
+    {
+        std::string name;
+        Type type;
+        bool constant;
+        bool initialized;
+    };
+
+
+    std::optional<Type> builtin(const std::string &name)
+    {
+        if (name == "int")      return Type::Int;
+        if (name == "float")    return Type::Float;
+        if (name == "bool")     return Type::Bool;
+        if (name == "char")     return Type::Char;
+
+        return std::nullopt;
+    }
+
+    bool type_name(const std::string &name)
+    {
+        return builtin(name) || name == "task" || name == "channel" || name == "generator";
+    }
+
+
+    /**
+     * SSA construction as described by Braun et al., "Simple and Efficient Construction of
+     * Static Single Assignment Form": variables are looked up through predecessors on demand,
+     * phis of blocks whose predecessors aren't all known yet are completed when the block is sealed.
+     */
+    class Lowering : private Syntax::Visitor
+    {
+    public:
+        Module lower(Syntax::Program &program)
+        {
+            for (auto &statement : program.statements)
+            {
+                if (auto function = std::dynamic_pointer_cast<Syntax::Function>(statement))
+                    declare_function(function);
+            }
+
+            for (auto &[name, node] : definitions)
+                lower_function(*node, *module.function(name));
+
+            auto entry = std::make_unique<IR::Function>();
+            entry->name = "$program";
+
+            begin(*entry, nullptr);
+            visit(program);
+
+            if (current)
+                emit(Opcode::Return, Type::Void);
+
+            finish();
+
+            module.functions.push_back(std::move(entry));
+
+            return std::move(module);
+        }
+
+    private:
+        void declare_function(const std::shared_ptr<Syntax::Function> &node)
+        {
+            auto &name = node->identifier->name;
+
+            if (definitions.count(name))
+                throw LoweringError("function '" + name + "' is defined more than once");
+
+            if (node->generator)
+                throw LoweringError("generator '" + name + "' is not supported");
+
+            auto function = std::make_unique<IR::Function>();
+            function->name = name;
+
+            std::set<std::string> parameters;
+
+            for (auto &argument : node->arguments)
+            {
+                auto type = builtin(argument.type->name);
+
+                if (!type)
+                    throw LoweringError("parameter '" + argument.param->name + "' of '" + name + "' has unsupported type");
+
+                if (!parameters.insert(argument.param->name).second)
+                    throw LoweringError("function '" + name + "' has two parameters '" + argument.param->name + "'");
+
+                function->parameters.push_back(*type);
+            }
+
+            if (node->return_type)
+            {
+                auto type = builtin(node->return_type->name);
+
+                if (!type)
+                    throw LoweringError("function '" + name + "' returns unsupported type");
+
+                function->return_type = *type;
+            }
+
+            definitions[name] = node;
+            module.functions.push_back(std::move(function));
+        }
+
+        void lower_function(Syntax::Function &node, IR::Function &function)
+        {
+            begin(function, &node);
+
+            for (size_t i = 0; i < node.arguments.size(); ++i)
+            {
+                auto parameter = emit(Opcode::Parameter, function.parameters[i]);
+                parameter->index = i;
+
+                write(declare(node.arguments[i].param->name, function.parameters[i], false), current, parameter);
+            }
+
+            visit(*node.definition());
+
+            if (current && node.return_type)
+                terminate("function did not return anything");
+            else if (current)
+                emit(Opcode::Return, Type::Void);
+
+            finish();
+        }
+
+        void begin(IR::Function &ir, Syntax::Function *node)
+        {
+            function = &ir;
+            source = node;
+
+            scopes.assign(1, {});
+            definitions_in_block.clear();
+            sealed.clear();
+            incomplete.clear();
+
+            current = function->add_block();
+            sealed.insert(current);
+        }
+
+        void finish()
+        {
+            for (auto &block : function->blocks)
+                seal(block.get());
+
+            function->remove_unreachable();
+            remove_trivial_phis();
+        }
+
+
+        // Variables
+
+        Variable *declare(const std::string &name, Type type, bool constant, bool initialized = true)
+        {
+            if (type_name(name))
+                throw LoweringError("variable '" + name + "' has the name of a type");
+
+            if (definitions.count(name))
+                throw LoweringError("variable '" + name + "' has the name of a function");
+
+            if (scopes.back().count(name))
+                throw Trapped {"name '" + name + "' is already defined at this scope"};
+
+            variables.push_back(std::make_unique<Variable>(Variable {name, type, constant, initialized}));
+
+            return scopes.back()[name] = variables.back().get();
+        }
+
+        Variable *lookup(const std::string &name) const
+        {
+            for (auto scope = scopes.rbegin(); scope != scopes.rend(); ++scope)
+            {
+                auto variable = scope->find(name);
+
+                if (variable != scope->end())
+                    return variable->second;
+            }
+
+            return nullptr;
+        }
+
+        // Function defined by the time the code being lowered runs
+        bool visible(const std::string &name) const
+        {
+            return definitions.count(name) && (source || defined.count(name));
+        }
+
+        Variable *object(const std::string &name) const
+        {
+            if (auto variable = lookup(name))
+            {
+                if (!variable->initialized)
+                    throw Trapped {name + " does not name an object"};
+
+                return variable;
+            }
+
+            if (type_name(name) || visible(name))
+                throw Trapped {name + " does not name an object"};
+
+            // the name may be declared by the caller
+            if (source)
+                throw LoweringError("function '" + source->identifier->name + "' uses variable '" + name + "' of its caller");
+
+            throw Trapped {"undefined reference to '" + name + "'"};
+        }
+
+        Type type(const std::string &name) const
+        {
+            if (auto type = builtin(name))
+                return *type;
+
+            if (type_name(name))
+                throw LoweringError("type '" + name + "' is not supported");
+
+            if (lookup(name) || visible(name))
+                throw Trapped {name + " does not name a type"};
+
+            if (source)
+                throw LoweringError("function '" + source->identifier->name + "' uses type '" + name + "' of its caller");
+
+            throw Trapped {"undefined reference to '" + name + "'"};
+        }
+
+
+        // SSA construction
+
+        void write(Variable *variable, Block *block, Instruction *value)
+        {
+            definitions_in_block[block][variable] = value;
+        }
+
+        Instruction *read(Variable *variable, Block *block)
+        {
+            auto &values = definitions_in_block[block];
+            auto value = values.find(variable);
+
+            if (value != values.end())
+                return value->second;
+
+            Instruction *result;
+
+            if (!sealed.count(block))
+            {
+                result = phi(block, variable->type);
+                incomplete[block].emplace_back(variable, result);
+            }
+            else if (block->predecessors.size() == 1)
+            {
+                result = read(variable, block->predecessors.front());
+            }
+            else if (block->predecessors.empty())
+            {
+                result = undefined(variable->type);
+            }
+            else
+            {
+                // written first to break cycles through loops
+                result = phi(block, variable->type);
+                write(variable, block, result);
+                complete(variable, result);
+            }
+
+            write(variable, block, result);
+
+            return result;
+        }
+
+        void complete(Variable *variable, Instruction *phi)
+        {
+            for (auto predecessor : phi->block->predecessors)
+                phi->operands.push_back(read(variable, predecessor));
+        }
+
+        void seal(Block *block)
+        {
+            if (!sealed.insert(block).second)
+                return;
+
+            for (auto &[variable, phi] : incomplete[block])
+                complete(variable, phi);
+
+            incomplete.erase(block);
+        }
+
+        Instruction *phi(Block *block, Type type)
+        {
+            auto position = block->instructions.begin();
+
+            while (position != block->instructions.end() && (*position)->opcode == Opcode::Phi)
+                ++position;
+
+            auto instruction = std::make_unique<Instruction>(Opcode::Phi, type);
+            instruction->block = block;
+
+            return block->instructions.insert(position, std::move(instruction))->get();
+        }
+
+        Instruction *undefined(Type type)
+        {
+            auto entry = function->entry();
+
+            auto instruction = std::make_unique<Instruction>(Opcode::Undefined, type);
+            instruction->block = entry;
+
+            return entry->instructions.insert(entry->instructions.begin(), std::move(instruction))->get();
+        }
+
+        // Phi whose operands are all the same value or the phi itself
+        void remove_trivial_phis()
+        {
+            for (bool changed = true; changed;)
+            {
+                changed = false;
+
+                for (auto &block : function->blocks)
+                {
+                    auto &instructions = block->instructions;
+
+                    for (size_t i = 0; i < instructions.size() && instructions[i]->opcode == Opcode::Phi;)
+                    {
+                        auto phi = instructions[i].get();
+                        Instruction *same = nullptr;
+                        bool trivial = true;
+
+                        for (auto operand : phi->operands)
+                        {
+                            if (operand == same || operand == phi)
+                                continue;
+
+                            if (same)
+                                trivial = false;
+
+                            same = operand;
+                        }
+
+                        if (!trivial)
+                        {
+                            ++i;
+                            continue;
+                        }
+
+                        function->replace_uses(phi, same ? same : undefined(phi->type));
+                        instructions.erase(instructions.begin() + i);
+                        changed = true;
+                    }
+                }
+            }
+        }
+
+
+        // Emission
+
+        Instruction *emit(Opcode opcode, Type type, std::vector<Instruction *> operands = {})
+        {
+            auto instruction = std::make_unique<Instruction>(opcode, type);
+            instruction->operands = std::move(operands);
+
+            return current->insert(std::move(instruction));
+        }
+
+        Instruction *constant(const Constant &value)
+        {
+            auto instruction = emit(Opcode::Constant, value.type);
+            instruction->constant = value;
+
+            return instruction;
+        }
+
+        Instruction *binary(BinaryOperator operation, Instruction *left, Instruction *right)
+        {
+            auto instruction = emit(Opcode::Binary, binary_type(operation, left->type, right->type), {left, right});
+            instruction->operation = operation;
+
+            return instruction;
+        }
+
+        void jump(Block *target)
+        {
+            emit(Opcode::Jump, Type::Void)->targets = {target};
+            target->predecessors.push_back(current);
+
+            current = nullptr;
+        }
+
+        void branch(Instruction *condition, Block *then, Block *otherwise)
+        {
+            emit(Opcode::Branch, Type::Void, {condition})->targets = {then, otherwise};
+            then->predecessors.push_back(current);
+            otherwise->predecessors.push_back(current);
+
+            current = nullptr;
+        }
+
+        void terminate(const std::string &message)
+        {
+            emit(Opcode::Trap, Type::Void)->message = message;
+
+            current = nullptr;
+        }
+
+        Instruction *expression(Syntax::Expression &node)
+        {
+            visit(node);
+
+            return value;
+        }
+
+        // Statements after return or trap are never executed
+        void statement(Syntax::Statement &node)
+        {
+            if (!current)
+                return;
+
+            try
+            {
+                visit(node);
+            }
+            catch (Trapped &trapped)
+            {
+                terminate(trapped.message);
+            }
+        }
+
+        Instruction *condition(Syntax::Expression &node)
+        {
+            auto condition = expression(node);
+
+            if (condition->type != Type::Bool)
+                throw Trapped {"condition must be bool"};
+
+            return condition;
+        }
+
+        Instruction *range_bound(Syntax::Expression &node)
+        {
+            auto bound = expression(node);
+
+            if (bound->type != Type::Int)
+                throw Trapped {"range bounds and step must be int"};
+
+            return bound;
+        }
+
+
+        void process(Syntax::Program &node) override
+        {
+            for (auto &statement : node.statements)
+            {
+                // call written after the definition may run the function
+                if (auto function = std::dynamic_pointer_cast<Syntax::Function>(statement))
+                    defined.insert(function->identifier->name);
+                else
+                    this->statement(*statement);
+            }
+        }
+
+        void process(Syntax::StatementBlock &node) override
+        {
+            scopes.emplace_back();
+
+            for (auto &statement : node.statements)
+                this->statement(*statement);
+
+            scopes.pop_back();
+        }
+
+        void process(Syntax::ValueDeclaration &node) override
+        {
+            // name is defined before initializer is evaluated, as the interpreter does
+            auto variable = declare(node.value->name, Type::Void, node.constant, false);
+
+            Instruction *init = nullptr;
+
+            if (node.init)
+                init = expression(*node.init);
+
+            if (node.type)
+            {
+                variable->type = type(node.type->name);
+
+                if (init && init->type != variable->type)
+                    throw Trapped {"specified type doesn't match initializer"};
+            }
+            else
+            {
+                variable->type = init->type;
+            }
+
+            write(variable, current, init ? init : constant(Constant::initial(variable->type)));
+            variable->initialized = true;
+        }
+
+        void process(Syntax::Assignment &node) override
+        {
+            auto value = expression(*node.source);
+            auto identifier = std::dynamic_pointer_cast<Syntax::Identifier>(node.destination);
+
+            if (!identifier)
+                throw LoweringError("assignment to expression is not supported");
+
+            auto variable = object(identifier->name);
+
+            if (variable->constant)
+                throw Trapped {"assigning to constant object"};
+
+            if (variable->type != value->type)
+                throw Trapped {"assigning different types"};
+
+            write(variable, current, value);
+        }
+
+        void process(Syntax::Function &node) override
+        {
+            throw LoweringError("nested function '" + node.identifier->name + "' is not supported");
+        }
+
+        void process(Syntax::ReturnStatement &node) override
+        {
+            if (!source)
+                throw LoweringError("return outside of function is not supported");
+
+            auto result = expression(*node.expression);
+
+            if (!source->return_type)
+                throw Trapped {"function tries to return something"};
+
+            if (result->type != function->return_type)
+                throw Trapped {"function's return type mismatch"};
+
+            emit(Opcode::Return, Type::Void, {result});
+
+            current = nullptr;
+        }
+
+        void process(Syntax::Call &node) override
+        {
+            auto &name = node.function->name;
+
+            if (lookup(name) || type_name(name))
+                throw Trapped {name + " does not name a function"};
+
+            auto definition = definitions.find(name);
+
+            if (definition == definitions.end() && source)
+                throw LoweringError("function '" + source->identifier->name + "' calls '" + name + "' which is not a function");
+
+            if (definition == definitions.end() || !visible(name))
+                throw Trapped {"undefined reference to '" + name + "'"};
+
+            auto &callee = *definition->second;
+            auto effects = analyze(callee);
+
+            if (!source)
+            {
+                // names are resolved at run time, everything the call may reach must be defined already
+                for (auto &read : effects.reads)
+                {
+                    if (definitions.count(read) && !defined.count(read))
+                        throw LoweringError("call of '" + name + "' may reach '" + read + "' before its definition");
+                }
+            }
+
+            if (node.arguments.size() != callee.arguments.size())
+                throw Trapped {
+                        "function " + name + " takes " + std::to_string(callee.arguments.size()) + " arguments, but "
+                        + std::to_string(node.arguments.size()) + " provided"};
+
+            std::vector<Instruction *> arguments;
+
+            for (auto &argument : node.arguments)
+                arguments.push_back(expression(*argument));
+
+            if (callee.memo && effects.io)
+                throw Trapped {"memo function '" + name + "' does input or output"};
+
+            auto target = module.function(name);
+
+            for (size_t i = 0; i < arguments.size(); ++i)
+            {
+                if (arguments[i]->type != target->parameters[i])
+                    throw Trapped {"parameter type mismatch"};
+            }
+
+            auto call = emit(Opcode::Call, target->return_type, arguments);
+            call->callee = target;
+
+            // call of function returning nothing evaluates to true
+            value = target->return_type == Type::Void ? constant(Constant::of(true)) : call;
+        }
+
+        void process(Syntax::InlinedCall &node) override
+        {
+            visit(*node.call);
+        }
+
+        void process(Syntax::Spawn &) override
+        {
+            throw LoweringError("tasks are not supported");
+        }
+
+        void process(Syntax::Join &) override
+        {
+            throw LoweringError("tasks are not supported");
+        }
+
+        void process(Syntax::MakeChannel &) override
+        {
+            throw LoweringError("channels are not supported");
+        }
+
+        void process(Syntax::Receive &) override
+        {
+            throw LoweringError("channels are not supported");
+        }
+
+        void process(Syntax::Identifier &node) override
+        {
+            value = read(object(node.name), current);
+        }
+
+        void process(Syntax::Literal &node) override
+        {
+            try
+            {
+                switch (node.type)
+                {
+                    case Syntax::Literal::Type::Integer:
+                        value = constant(Constant::of(std::stoi(node.lexeme)));
+                        return;
+
+                    case Syntax::Literal::Type::Float:
+                        value = constant(Constant::of(std::stof(node.lexeme)));
+                        return;
+
+                    case Syntax::Literal::Type::Boolean:
+                        value = constant(Constant::of(node.lexeme == "true"));
+                        return;
+
+                    case Syntax::Literal::Type::Character:
+                        value = constant(Constant::of(node.lexeme[1]));
+                        return;
+
+                    default:
+                        break;
+                }
+            }
+            catch (std::logic_error &) {}
+
+            throw LoweringError("literal " + node.lexeme + " is not supported");
+        }
+
+        void process(Syntax::BinaryOperation &node) override
+        {
+            auto left = expression(*node.left);
+
+            bool logical = node.operation == BinaryOperator::And || node.operation == BinaryOperator::Or;
+
+            if (logical && left->type == Type::Bool)
+            {
+                value = short_circuit(node, left);
+                return;
+            }
+
+            auto right = expression(*node.right);
+
+            if (binary_type(node.operation, left->type, right->type) != Type::Void)
+            {
+                value = binary(node.operation, left, right);
+                return;
+            }
+
+            // the interpreter registers them, but fails to compute them
+            bool equality = node.operation == BinaryOperator::EQ || node.operation == BinaryOperator::NE;
+
+            if (equality && left->type == Type::Char && right->type == Type::Char)
+                throw LoweringError("comparison of chars is not supported");
+
+            throw Trapped {"undefined operation"};
+        }
+
+        /**
+         * 'and' and 'or' evaluate the right operand only if the left one doesn't decide the result,
+         * so a runtime error of the right operand ends only the path which evaluates it.
+         */
+        Instruction *short_circuit(Syntax::BinaryOperation &node, Instruction *left)
+        {
+            bool decides = node.operation == BinaryOperator::Or;
+            auto decided = constant(Constant::of(decides));
+
+            auto evaluate = function->add_block();
+            auto join = function->add_block();
+
+            if (decides)
+                branch(left, join, evaluate);
+            else
+                branch(left, evaluate, join);
+
+            seal(evaluate);
+            current = evaluate;
+
+            Instruction *right = nullptr;
+
+            try
+            {
+                right = expression(*node.right);
+
+                if (right->type != Type::Bool)
+                    throw Trapped {"undefined operation"};
+
+                jump(join);
+            }
+            catch (Trapped &trapped)
+            {
+                terminate(trapped.message);
+                right = nullptr;
+            }
+
+            seal(join);
+            current = join;
+
+            if (!right)
+                return decided;
+
+            auto result = phi(join, Type::Bool);
+            result->operands = {decided, right};
+
+            return result;
+        }
+
+        void process(Syntax::UnaryOperation &node) override
+        {
+            expression(*node.operand);
+
+            throw Trapped {"undefined operation"};
+        }
+
+        void process(Syntax::ConditionalStatement &node) override
+        {
+            auto condition = this->condition(*node.condition);
+
+            auto then = function->add_block();
+            auto otherwise = node.else_case ? function->add_block() : nullptr;
+            auto join = function->add_block();
+
+            branch(condition, then, otherwise ? otherwise : join);
+            seal(then);
+
+            current = then;
+            visit(*node.then_case);
+
+            if (current)
+                jump(join);
+
+            if (otherwise)
+            {
+                seal(otherwise);
+
+                current = otherwise;
+                visit(*node.else_case);
+
+                if (current)
+                    jump(join);
+            }
+
+            seal(join);
+            current = join->predecessors.empty() ? nullptr : join;
+        }
+
+        void process(Syntax::ConditionalLoop &node) override
+        {
+            auto header = function->add_block();
+
+            jump(header);
+            current = header;
+
+            // header is sealed by finish() if the condition traps
+            auto condition = this->condition(*node.condition);
+
+            auto body = function->add_block();
+            auto exit = function->add_block();
+
+            branch(condition, body, exit);
+            seal(body);
+
+            current = body;
+            visit(*node.body);
+
+            if (current)
+                jump(header);
+
+            seal(header);
+            seal(exit);
+
+            current = exit;
+        }
+
+        void process(Syntax::RangeLoop &node) override
+        {
+            auto begin = range_bound(*node.begin);
+            auto end = range_bound(*node.end);
+            auto step = node.step ? range_bound(*node.step) : constant(Constant::of(1));
+
+            auto zero = constant(Constant::of(0));
+
+            if (step->opcode == Opcode::Constant && step->constant.int_value == 0)
+                throw Trapped {"range step must not be zero"};
+
+            if (step->opcode != Opcode::Constant)
+            {
+                auto failure = function->add_block();
+                auto checked = function->add_block();
+
+                branch(binary(BinaryOperator::EQ, step, zero), failure, checked);
+                seal(failure);
+                seal(checked);
+
+                current = failure;
+                terminate("range step must not be zero");
+
+                current = checked;
+            }
+
+            // the interpreter counts in long long, here the step is added only if it doesn't overflow
+            auto ascending = binary(BinaryOperator::GT, step, zero);
+            auto descending = binary(BinaryOperator::LT, step, zero);
+
+            auto enter = binary(BinaryOperator::Or,
+                                binary(BinaryOperator::And, ascending, binary(BinaryOperator::LT, begin, end)),
+                                binary(BinaryOperator::And, descending, binary(BinaryOperator::GT, begin, end)));
+
+            scopes.emplace_back();
+
+            auto counter = declare(node.counter->name, Type::Int, true);
+            write(counter, current, begin);
+
+            auto body = function->add_block();
+            auto exit = function->add_block();
+
+            branch(enter, body, exit);
+
+            current = body;
+            visit(*node.body);
+
+            if (current)
+            {
+                auto i = read(counter, current);
+                auto next = binary(BinaryOperator::Plus, i, step);
+
+                auto up = binary(BinaryOperator::And, binary(BinaryOperator::GT, next, i), binary(BinaryOperator::LT, next, end));
+                auto down = binary(BinaryOperator::And, binary(BinaryOperator::LT, next, i), binary(BinaryOperator::GT, next, end));
+
+                auto more = binary(BinaryOperator::Or,
+                                   binary(BinaryOperator::And, ascending, up),
+                                   binary(BinaryOperator::And, descending, down));
+
+                write(counter, current, next);
+                branch(more, body, exit);
+            }
+
+            seal(body);
+            seal(exit);
+
+            scopes.pop_back();
+
+            current = exit;
+        }
+
+        void process(Syntax::ForEachLoop &) override
+        {
+            throw LoweringError("iteration over generators is not supported");
+        }
+
+        void process(Syntax::ParallelLoop &) override
+        {
+            throw LoweringError("parallel loops are not supported");
+        }
+
+        void process(Syntax::PrintStatement &node) override
+        {
+            emit(Opcode::Print, Type::Void, {expression(*node.expression)});
+        }
+
+        void process(Syntax::ReadStatement &node) override
+        {
+            auto identifier = std::dynamic_pointer_cast<Syntax::Identifier>(node.expression);
+
+            if (!identifier)
+                throw LoweringError("reading into expression is not supported");
+
+            // constants may be read into, failed read keeps the value
+            auto variable = object(identifier->name);
+
+            write(variable, current, emit(Opcode::Read, variable->type, {read(variable, current)}));
+        }
+
+        void process(Syntax::SendStatement &) override
+        {
+            throw LoweringError("channels are not supported");
+        }
+
+        void process(Syntax::CloseStatement &) override
+        {
+            throw LoweringError("channels are not supported");
+        }
+
+        void process(Syntax::YieldStatement &) override
+        {
+            throw LoweringError("yield is not supported");
+        }
+
+        void process(Syntax::ImportStatement &) override
+        {
+            throw LoweringError("import is not supported");
+        }
+
+        Semantic::Effects analyze(Syntax::Function &callee)
+        {
+            Semantic::EffectAnalysis analysis([this] (const std::string &name) -> std::shared_ptr<Syntax::Function> {
+                auto definition = definitions.find(name);
+                return definition == definitions.end() ? nullptr : definition->second;
+            });
+
+            return analysis.analyze(callee);
+        }
+
+    private:
+        Module module;
+
+        std::map<std::string, std::shared_ptr<Syntax::Function>> definitions;   // top-level functions
+        std::set<std::string> defined;                                          // defined so far by the program
+
+        IR::Function *function = nullptr;
+        Syntax::Function *source = nullptr;                                     // nullptr for the program
+        Block *current = nullptr;                                               // nullptr if unreachable
+        Instruction *value = nullptr;                                           // of the last expression
+
+        std::vector<std::unique_ptr<Variable>> variables;
+        std::vector<std::map<std::string, Variable *>> scopes;
+
+        std::map<Block *, std::map<Variable *, Instruction *>> definitions_in_block;
+        std::set<Block *> sealed;
+        std::map<Block *, std::vector<std::pair<Variable *, Instruction *>>> incomplete;
+    };
+}
+
+
+Module IR::lower(Syntax::Program &program)
+{
+    return Lowering().lower(program);
+}
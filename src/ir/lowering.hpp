@@ -0,0 +1,37 @@
+#ifndef TOMATO_IR_LOWERING_HPP
+#define TOMATO_IR_LOWERING_HPP
+
+
+#include <stdexcept>
+
+#include "ir.hpp"
+#include "syntax/syntax_tree.hpp"
+
+
+namespace Tomato::IR
+{
+    /**
+     * @brief Program uses something the IR doesn't model.
+     */
+    class LoweringError : public std::runtime_error
+    {
+    public:
+        using runtime_error::runtime_error;
+    };
+
+
+    /**
+     * @brief Translate program to SSA form.
+     *
+     * Only programs whose names can be resolved statically are lowered: scalar variables,
+     * top-level functions which don't read or write variables of their callers, no tasks,
+     * channels, generators or imports. Errors the interpreter reports at run time become
+     * Trap instructions with the same message, so the module behaves as the program does.
+     *
+     * @throw LoweringError
+     */
+    Module lower(Syntax::Program &program);
+}
+
+
+#endif //TOMATO_IR_LOWERING_HPP
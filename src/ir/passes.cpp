@@ -0,0 +1,758 @@
+#include "passes.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <set>
+#include <tuple>
+
+#include "analysis.hpp"
+
+
+using namespace Tomato;
+using namespace Tomato::IR;
+
+
+namespace
+{
+    /**
+     * Value of instruction as far as constant propagation knows: not computed yet (Top),
+     * the same constant every time, or any value (Bottom).
+     */
+    struct Lattice
+    {
+        enum class Kind { Top, Constant, Bottom };
+
+        Kind kind = Kind::Top;
+        Constant constant;
+
+        bool operator==(const Lattice &other) const
+        {
+            return kind == other.kind && (kind != Kind::Constant || constant == other.constant);
+        }
+
+        static Lattice bottom()
+        {
+            return {Kind::Bottom, {}};
+        }
+
+        static Lattice of(const Constant &constant)
+        {
+            return {Kind::Constant, constant};
+        }
+
+        Lattice meet(const Lattice &other) const
+        {
+            if (kind == Kind::Top)
+                return other;
+
+            if (other.kind == Kind::Top)
+                return *this;
+
+            return *this == other ? *this : bottom();
+        }
+    };
+
+
+    class ConstantPropagation
+    {
+    public:
+        explicit ConstantPropagation(Function &function) : function(function)
+        {
+            for (auto &block : function.blocks)
+            {
+                for (auto &instruction : block->instructions)
+                {
+                    for (auto operand : instruction->operands)
+                        users[operand].push_back(instruction.get());
+                }
+            }
+        }
+
+        bool run()
+        {
+            reach(function.entry());
+
+            while (!edges.empty() || !changed.empty())
+            {
+                if (!edges.empty())
+                {
+                    auto [from, to] = edges.back();
+                    edges.pop_back();
+
+                    if (executable.count(to))
+                    {
+                        // only phis depend on the new edge
+                        for (auto &instruction : to->instructions)
+                        {
+                            if (instruction->opcode == Opcode::Phi)
+                                evaluate(*instruction);
+                        }
+                    }
+                    else
+                    {
+                        reach(to);
+                    }
+
+                    continue;
+                }
+
+                auto instruction = changed.back();
+                changed.pop_back();
+
+                for (auto user : users[instruction])
+                {
+                    if (executable.count(user->block))
+                        evaluate(*user);
+                }
+            }
+
+            return rewrite();
+        }
+
+    private:
+        void reach(Block *block)
+        {
+            executable.insert(block);
+
+            for (auto &instruction : block->instructions)
+                evaluate(*instruction);
+        }
+
+        void mark(Block *from, Block *to)
+        {
+            if (executable_edges.insert({from, to}).second)
+                edges.emplace_back(from, to);
+        }
+
+        void update(Instruction &instruction, const Lattice &value)
+        {
+            auto &current = values[&instruction];
+
+            if (current == value)
+                return;
+
+            current = value;
+            changed.push_back(&instruction);
+        }
+
+        void evaluate(Instruction &instruction)
+        {
+            switch (instruction.opcode)
+            {
+                case Opcode::Constant:
+                    update(instruction, Lattice::of(instruction.constant));
+                    break;
+
+                case Opcode::Binary:
+                {
+                    auto &left = values[instruction.operands[0]];
+                    auto &right = values[instruction.operands[1]];
+
+                    if (auto decided = decisive(instruction.operation, left, right))
+                        update(instruction, *decided);
+                    else if (left.kind == Lattice::Kind::Bottom || right.kind == Lattice::Kind::Bottom)
+                        update(instruction, Lattice::bottom());
+                    else if (left.kind == Lattice::Kind::Constant && right.kind == Lattice::Kind::Constant)
+                    {
+                        auto result = fold(instruction.operation, left.constant, right.constant);
+                        update(instruction, result ? Lattice::of(*result) : Lattice::bottom());
+                    }
+
+                    break;
+                }
+
+                case Opcode::Phi:
+                {
+                    Lattice result;
+                    auto block = instruction.block;
+
+                    for (size_t i = 0; i < instruction.operands.size(); ++i)
+                    {
+                        if (executable_edges.count({block->predecessors[i], block}))
+                            result = result.meet(values[instruction.operands[i]]);
+                    }
+
+                    update(instruction, result);
+                    break;
+                }
+
+                case Opcode::Jump:
+                    mark(instruction.block, instruction.targets[0]);
+                    break;
+
+                case Opcode::Branch:
+                {
+                    auto &condition = values[instruction.operands[0]];
+
+                    if (condition.kind == Lattice::Kind::Constant)
+                        mark(instruction.block, instruction.targets[condition.constant.bool_value ? 0 : 1]);
+                    else if (condition.kind == Lattice::Kind::Bottom)
+                    {
+                        mark(instruction.block, instruction.targets[0]);
+                        mark(instruction.block, instruction.targets[1]);
+                    }
+
+                    break;
+                }
+
+                case Opcode::Parameter:
+                case Opcode::Undefined:
+                case Opcode::Call:
+                case Opcode::Read:
+                    update(instruction, Lattice::bottom());
+                    break;
+
+                default:
+                    break;
+            }
+        }
+
+        // false and anything, true or anything
+        static std::optional<Lattice> decisive(BinaryOperator operation, const Lattice &left, const Lattice &right)
+        {
+            if (operation != BinaryOperator::And && operation != BinaryOperator::Or)
+                return std::nullopt;
+
+            auto result = Constant::of(operation == BinaryOperator::Or);
+
+            for (auto &operand : {left, right})
+            {
+                if (operand.kind == Lattice::Kind::Constant && operand.constant == result)
+                    return Lattice::of(result);
+            }
+
+            return std::nullopt;
+        }
+
+        bool rewrite()
+        {
+            bool modified = false;
+
+            std::map<Constant, Instruction *> constants;
+            std::map<Instruction *, Instruction *> replacements;
+
+            auto entry = function.entry();
+
+            for (auto &block : function.blocks)
+            {
+                if (!executable.count(block.get()))
+                    continue;
+
+                for (auto &instruction : block->instructions)
+                {
+                    auto &value = values[instruction.get()];
+
+                    if (value.kind != Lattice::Kind::Constant || instruction->opcode == Opcode::Constant)
+                        continue;
+
+                    auto &constant = constants[value.constant];
+
+                    if (!constant)
+                    {
+                        auto created = std::make_unique<Instruction>(Opcode::Constant, value.constant.type);
+                        created->constant = value.constant;
+                        created->block = entry;
+                        constant = created.get();
+                        pending.push_back(std::move(created));
+                    }
+
+                    replacements[instruction.get()] = constant;
+                }
+            }
+
+            // logical operation with an operand which doesn't decide the result is the other operand
+            for (auto &block : function.blocks)
+            {
+                if (!executable.count(block.get()))
+                    continue;
+
+                for (auto &instruction : block->instructions)
+                {
+                    auto operation = instruction->operation;
+
+                    if (instruction->opcode != Opcode::Binary || replacements.count(instruction.get())
+                        || (operation != BinaryOperator::And && operation != BinaryOperator::Or && operation != BinaryOperator::Xor))
+                        continue;
+
+                    for (size_t side = 0; side < 2; ++side)
+                    {
+                        auto &known = values[instruction->operands[side]];
+
+                        if (known.kind == Lattice::Kind::Constant && known.constant.bool_value == (operation == BinaryOperator::And))
+                        {
+                            replacements[instruction.get()] = instruction->operands[1 - side];
+                            break;
+                        }
+                    }
+                }
+            }
+
+            // entry has no predecessors, hence no phis
+            entry->instructions.insert(entry->instructions.begin(),
+                                       std::make_move_iterator(pending.begin()), std::make_move_iterator(pending.end()));
+
+            for (auto &block : function.blocks)
+            {
+                for (auto &instruction : block->instructions)
+                {
+                    for (auto &operand : instruction->operands)
+                    {
+                        for (auto replacement = replacements.find(operand); replacement != replacements.end();
+                             replacement = replacements.find(operand))
+                        {
+                            operand = replacement->second;
+                            modified = true;
+                        }
+                    }
+                }
+            }
+
+            // branches taking one way only become jumps
+            for (auto &block : function.blocks)
+            {
+                auto terminator = block->terminator();
+
+                if (!executable.count(block.get()) || terminator->opcode != Opcode::Branch)
+                    continue;
+
+                auto then = terminator->targets[0], otherwise = terminator->targets[1];
+
+                if (then == otherwise)
+                    continue;
+
+                bool taken[] = {
+                        executable_edges.count({block.get(), then}) > 0,
+                        executable_edges.count({block.get(), otherwise}) > 0
+                };
+
+                if (taken[0] == taken[1])
+                    continue;
+
+                terminator->opcode = Opcode::Jump;
+                terminator->operands.clear();
+                terminator->targets = {taken[0] ? then : otherwise};
+
+                function.remove_edge(block.get(), taken[0] ? otherwise : then);
+                modified = true;
+            }
+
+            return function.remove_unreachable() || modified;
+        }
+
+    private:
+        Function &function;
+
+        std::map<Instruction *, std::vector<Instruction *>> users;
+        std::map<Instruction *, Lattice> values;
+
+        std::set<Block *> executable;
+        std::set<std::pair<Block *, Block *>> executable_edges;
+
+        std::vector<std::pair<Block *, Block *>> edges;         // worklist of edges found executable
+        std::vector<Instruction *> changed;                     // worklist of values lowered in lattice
+
+        std::vector<std::unique_ptr<Instruction>> pending;
+    };
+
+
+    bool commutative(BinaryOperator operation)
+    {
+        switch (operation)
+        {
+            case BinaryOperator::Plus:
+            case BinaryOperator::Mul:
+            case BinaryOperator::EQ:
+            case BinaryOperator::NE:
+            case BinaryOperator::And:
+            case BinaryOperator::Or:
+            case BinaryOperator::Xor:
+                return true;
+
+            default:
+                return false;
+        }
+    }
+
+
+    /**
+     * Block with a single successor, the loop header, and no other predecessor of the header outside of the loop.
+     */
+    Block *preheader(const Loop &loop)
+    {
+        Block *outside = nullptr;
+
+        for (auto predecessor : loop.header->predecessors)
+        {
+            if (loop.blocks.count(predecessor))
+                continue;
+
+            if (outside && outside != predecessor)
+                return nullptr;
+
+            outside = predecessor;
+        }
+
+        return outside && outside->successors().size() == 1 ? outside : nullptr;
+    }
+
+    /**
+     * Redirect edges entering the loop to a new block jumping to the header.
+     */
+    void create_preheader(Function &function, const Loop &loop)
+    {
+        auto header = loop.header;
+        auto block = function.add_block();
+
+        // keep blocks in order of the source, preheader right before its loop
+        auto position = std::find_if(function.blocks.begin(), function.blocks.end(), [&] (const std::unique_ptr<Block> &b) {
+            return b.get() == header;
+        });
+
+        std::rotate(position, function.blocks.end() - 1, function.blocks.end());
+
+        std::vector<Block *> inside;
+
+        for (auto predecessor : header->predecessors)
+        {
+            if (loop.blocks.count(predecessor))
+                inside.push_back(predecessor);
+            else
+                block->predecessors.push_back(predecessor);
+        }
+
+        for (auto &instruction : header->instructions)
+        {
+            if (instruction->opcode != Opcode::Phi)
+                break;
+
+            std::vector<Instruction *> entering, looping;
+
+            for (size_t i = 0; i < header->predecessors.size(); ++i)
+                (loop.blocks.count(header->predecessors[i]) ? looping : entering).push_back(instruction->operands[i]);
+
+            auto value = entering.front();
+
+            if (std::count(entering.begin(), entering.end(), value) != static_cast<long>(entering.size()))
+            {
+                auto phi = std::make_unique<Instruction>(Opcode::Phi, instruction->type);
+                phi->operands = entering;
+                value = block->insert(std::move(phi));
+            }
+
+            instruction->operands = {value};
+            instruction->operands.insert(instruction->operands.end(), looping.begin(), looping.end());
+        }
+
+        for (auto predecessor : block->predecessors)
+        {
+            auto &targets = predecessor->terminator()->targets;
+            std::replace(targets.begin(), targets.end(), header, block);
+        }
+
+        header->predecessors = {block};
+        header->predecessors.insert(header->predecessors.end(), inside.begin(), inside.end());
+
+        auto jump = std::make_unique<Instruction>(Opcode::Jump, Type::Void);
+        jump->targets = {header};
+        block->insert(std::move(jump));
+    }
+}
+
+
+bool IR::propagate_constants(Function &function)
+{
+    return ConstantPropagation(function).run();
+}
+
+
+bool IR::eliminate_dead_code(Function &function)
+{
+    bool changed = function.remove_unreachable();
+
+    // phi of a single value, e.g. after an edge was removed
+    for (bool trivial = true; trivial;)
+    {
+        trivial = false;
+
+        for (auto &block : function.blocks)
+        {
+            auto &instructions = block->instructions;
+
+            for (size_t i = 0; i < instructions.size() && instructions[i]->opcode == Opcode::Phi;)
+            {
+                auto phi = instructions[i].get();
+                auto &operands = phi->operands;
+
+                auto other = std::find_if(operands.begin(), operands.end(), [&] (Instruction *operand) {
+                    return operand != phi;
+                });
+
+                bool same = other != operands.end() && std::all_of(operands.begin(), operands.end(), [&] (Instruction *operand) {
+                    return operand == phi || operand == *other;
+                });
+
+                if (!same)
+                {
+                    ++i;
+                    continue;
+                }
+
+                function.replace_uses(phi, *other);
+                instructions.erase(instructions.begin() + i);
+                trivial = changed = true;
+            }
+        }
+    }
+
+    std::set<Instruction *> live;
+    std::vector<Instruction *> pending;
+
+    for (auto &block : function.blocks)
+    {
+        for (auto &instruction : block->instructions)
+        {
+            if (instruction->side_effects() || instruction->may_trap())
+            {
+                live.insert(instruction.get());
+                pending.push_back(instruction.get());
+            }
+        }
+    }
+
+    while (!pending.empty())
+    {
+        auto instruction = pending.back();
+        pending.pop_back();
+
+        for (auto operand : instruction->operands)
+        {
+            if (live.insert(operand).second)
+                pending.push_back(operand);
+        }
+    }
+
+    for (auto &block : function.blocks)
+    {
+        auto &instructions = block->instructions;
+        auto size = instructions.size();
+
+        instructions.erase(std::remove_if(instructions.begin(), instructions.end(), [&] (const std::unique_ptr<Instruction> &instruction) {
+            return !live.count(instruction.get());
+        }), instructions.end());
+
+        changed = changed || instructions.size() != size;
+    }
+
+    // branch to the same block both ways
+    for (auto &block : function.blocks)
+    {
+        auto terminator = block->terminator();
+
+        if (terminator->opcode != Opcode::Branch || terminator->targets[0] != terminator->targets[1])
+            continue;
+
+        terminator->opcode = Opcode::Jump;
+        terminator->operands.clear();
+        terminator->targets.pop_back();
+
+        function.remove_edge(block.get(), terminator->targets[0]);
+        changed = true;
+    }
+
+    // block is appended to its only predecessor which jumps nowhere else
+    for (size_t i = 1; i < function.blocks.size();)
+    {
+        auto block = function.blocks[i].get();
+
+        if (block->predecessors.size() != 1 || block->predecessors.front() == block
+            || block->predecessors.front()->terminator()->opcode != Opcode::Jump)
+        {
+            ++i;
+            continue;
+        }
+
+        auto predecessor = block->predecessors.front();
+        auto &instructions = block->instructions;
+
+        while (!instructions.empty() && instructions.front()->opcode == Opcode::Phi)
+        {
+            function.replace_uses(instructions.front().get(), instructions.front()->operands.front());
+            instructions.erase(instructions.begin());
+        }
+
+        predecessor->instructions.pop_back();
+
+        for (auto &instruction : instructions)
+        {
+            instruction->block = predecessor;
+            predecessor->instructions.push_back(std::move(instruction));
+        }
+
+        for (auto successor : predecessor->successors())
+            std::replace(successor->predecessors.begin(), successor->predecessors.end(), block, predecessor);
+
+        function.blocks.erase(function.blocks.begin() + i);
+        changed = true;
+    }
+
+    return changed;
+}
+
+
+bool IR::eliminate_common_subexpressions(Function &function)
+{
+    using Key = std::tuple<Opcode, Type, BinaryOperator, Constant, std::vector<Instruction *>>;
+
+    DominatorTree dominators(function);
+
+    std::map<Key, Instruction *> available;
+    std::map<Instruction *, Instruction *> replacements;
+
+    std::function<void(Block *)> walk = [&] (Block *block) {
+        std::vector<Key> added;
+
+        for (auto &instruction : block->instructions)
+        {
+            if (instruction->opcode != Opcode::Constant && instruction->opcode != Opcode::Binary)
+                continue;
+
+            auto operands = instruction->operands;
+
+            for (auto &operand : operands)
+            {
+                auto replacement = replacements.find(operand);
+
+                if (replacement != replacements.end())
+                    operand = replacement->second;
+            }
+
+            if (instruction->opcode == Opcode::Binary && commutative(instruction->operation))
+                std::sort(operands.begin(), operands.end());
+
+            Key key {instruction->opcode, instruction->type, instruction->operation, instruction->constant, operands};
+
+            auto [equal, inserted] = available.emplace(key, instruction.get());
+
+            if (inserted)
+                added.push_back(key);
+            else
+                replacements[instruction.get()] = equal->second;
+        }
+
+        for (auto child : dominators.children(block))
+            walk(child);
+
+        for (auto &key : added)
+            available.erase(key);
+    };
+
+    walk(function.entry());
+
+    if (replacements.empty())
+        return false;
+
+    for (auto &block : function.blocks)
+    {
+        auto &instructions = block->instructions;
+
+        instructions.erase(std::remove_if(instructions.begin(), instructions.end(), [&] (const std::unique_ptr<Instruction> &instruction) {
+            return replacements.count(instruction.get()) > 0;
+        }), instructions.end());
+
+        for (auto &instruction : instructions)
+        {
+            for (auto &operand : instruction->operands)
+            {
+                auto replacement = replacements.find(operand);
+
+                if (replacement != replacements.end())
+                    operand = replacement->second;
+            }
+        }
+    }
+
+    return true;
+}
+
+
+bool IR::hoist_loop_invariants(Function &function)
+{
+    bool changed = false;
+
+    // preheaders change the dominator tree, so loops are found again after each of them
+    for (bool created = true; created;)
+    {
+        created = false;
+
+        DominatorTree dominators(function);
+
+        for (auto &loop : find_loops(function, dominators))
+        {
+            if (!preheader(loop) && loop.header != function.entry())
+            {
+                create_preheader(function, loop);
+                created = changed = true;
+                break;
+            }
+        }
+    }
+
+    DominatorTree dominators(function);
+
+    for (auto &loop : find_loops(function, dominators))
+    {
+        auto target = preheader(loop);
+
+        if (!target)
+            continue;
+
+        for (auto block : dominators.order())
+        {
+            if (!loop.blocks.count(block))
+                continue;
+
+            auto &instructions = block->instructions;
+
+            for (size_t i = 0; i < instructions.size();)
+            {
+                auto &instruction = *instructions[i];
+
+                bool pure = instruction.opcode == Opcode::Constant || instruction.opcode == Opcode::Binary;
+
+                bool invariant = pure && !instruction.may_trap()
+                                 && std::none_of(instruction.operands.begin(), instruction.operands.end(), [&] (Instruction *operand) {
+                                        return loop.blocks.count(operand->block) > 0;
+                                    });
+
+                if (!invariant)
+                {
+                    ++i;
+                    continue;
+                }
+
+                auto moved = std::move(instructions[i]);
+                instructions.erase(instructions.begin() + i);
+                target->insert(std::move(moved));
+                changed = true;
+            }
+        }
+    }
+
+    return changed;
+}
+
+
+void IR::optimize(Module &module)
+{
+    for (auto &function : module.functions)
+    {
+        propagate_constants(*function);
+        eliminate_dead_code(*function);
+        eliminate_common_subexpressions(*function);
+        hoist_loop_invariants(*function);
+
+        // hoisted instructions may be equal to ones in front of the loop
+        eliminate_common_subexpressions(*function);
+        eliminate_dead_code(*function);
+    }
+}
@@ -0,0 +1,47 @@
+#ifndef TOMATO_IR_PASSES_HPP
+#define TOMATO_IR_PASSES_HPP
+
+
+#include "ir.hpp"
+
+
+namespace Tomato::IR
+{
+    /**
+     * @brief Sparse conditional constant propagation (Wegman and Zadeck).
+     *
+     * Values known to be constant are replaced by constants, branches on them become jumps
+     * and blocks which can't be executed are removed.
+     * @return Whether function changed.
+     */
+    bool propagate_constants(Function &function);
+
+    /**
+     * @brief Remove instructions whose values are unused and which have no side effects,
+     * unreachable blocks, and jumps to blocks having no other predecessor.
+     * @return Whether function changed.
+     */
+    bool eliminate_dead_code(Function &function);
+
+    /**
+     * @brief Replace instruction by an equal one dominating it, walking the dominator tree.
+     * @return Whether function changed.
+     */
+    bool eliminate_common_subexpressions(Function &function);
+
+    /**
+     * @brief Move instructions computing the same value in every iteration in front of the loop.
+     *
+     * Only instructions which can't trap are moved, since they are executed even if the loop isn't.
+     * @return Whether function changed.
+     */
+    bool hoist_loop_invariants(Function &function);
+
+    /**
+     * @brief All of the above, in order, on every function of module.
+     */
+    void optimize(Module &module);
+}
+
+
+#endif //TOMATO_IR_PASSES_HPP
@@ -0,0 +1,259 @@
+#include "verifier.hpp"
+
+#include <algorithm>
+#include <set>
+
+#include "analysis.hpp"
+
+
+using namespace Tomato;
+using namespace Tomato::IR;
+
+
+namespace
+{
+    class Verifier
+    {
+    public:
+        Verifier(const Module &module, const Function &function)
+                : module(module), function(function), dominators(function) {}
+
+        void verify()
+        {
+            if (function.blocks.empty())
+                fail("function has no blocks");
+
+            if (!function.entry()->predecessors.empty())
+                fail("entry block has predecessors");
+
+            std::map<const Block *, std::multiset<const Block *>> edges;
+
+            for (auto &block : function.blocks)
+            {
+                blocks.insert(block.get());
+
+                for (auto &instruction : block->instructions)
+                    position[instruction.get()] = {block.get(), position.size()};
+            }
+
+            for (auto &block : function.blocks)
+            {
+                this->block = block.get();
+                instruction = nullptr;
+
+                if (!dominators.reachable(block.get()))
+                    fail("block is unreachable");
+
+                if (!block->terminator())
+                    fail("block doesn't end with terminator");
+
+                for (auto successor : block->successors())
+                {
+                    if (!blocks.count(successor))
+                        fail("jump to block of another function");
+
+                    edges[successor].insert(block.get());
+                }
+
+                bool phis = true;
+
+                for (auto &instruction : block->instructions)
+                {
+                    this->instruction = instruction.get();
+
+                    if (instruction->block != block.get())
+                        fail("instruction doesn't know its block");
+
+                    if (instruction->terminator() && instruction != block->instructions.back())
+                        fail("terminator in the middle of block");
+
+                    if (instruction->opcode == Opcode::Phi && !phis)
+                        fail("phi after other instruction");
+
+                    phis = phis && instruction->opcode == Opcode::Phi;
+
+                    check(*instruction);
+                }
+            }
+
+            for (auto &block : function.blocks)
+            {
+                this->block = block.get();
+                instruction = nullptr;
+
+                std::multiset<const Block *> predecessors(block->predecessors.begin(), block->predecessors.end());
+
+                if (predecessors != edges[block.get()])
+                    fail("predecessors don't match jumps to block");
+            }
+        }
+
+    private:
+        void check(const Instruction &instruction)
+        {
+            auto &operands = instruction.operands;
+
+            for (size_t i = 0; i < operands.size(); ++i)
+            {
+                auto operand = operands[i];
+
+                if (!position.count(operand))
+                    fail("operand is not an instruction of the function");
+
+                if (operand->type == Type::Void)
+                    fail("operand has no value");
+
+                // value of phi operand is taken at the end of predecessor
+                if (instruction.opcode == Opcode::Phi)
+                {
+                    if (i < block->predecessors.size() && !dominators.dominates(operand->block, block->predecessors[i]))
+                        fail("phi operand doesn't dominate predecessor");
+                }
+                else if (operand->block == block ? position[operand].second >= position[&instruction].second
+                                                 : !dominators.dominates(operand->block, block))
+                {
+                    fail("operand doesn't dominate its use");
+                }
+            }
+
+            auto count = [&] (size_t operands, size_t targets = 0) {
+                if (instruction.operands.size() != operands)
+                    fail("wrong number of operands");
+
+                if (instruction.targets.size() != targets)
+                    fail("wrong number of targets");
+            };
+
+            switch (instruction.opcode)
+            {
+                case Opcode::Parameter:
+                    count(0);
+
+                    if (instruction.index >= function.parameters.size() || function.parameters[instruction.index] != instruction.type)
+                        fail("parameter doesn't match function");
+
+                    break;
+
+                case Opcode::Constant:
+                    count(0);
+
+                    if (instruction.constant.type != instruction.type || instruction.type == Type::Void)
+                        fail("constant of wrong type");
+
+                    break;
+
+                case Opcode::Undefined:
+                    count(0);
+                    break;
+
+                case Opcode::Binary:
+                    count(2);
+
+                    if (instruction.type == Type::Void
+                        || binary_type(instruction.operation, operands[0]->type, operands[1]->type) != instruction.type)
+                        fail("operation undefined for operand types");
+
+                    break;
+
+                case Opcode::Phi:
+                    count(block->predecessors.size());
+
+                    for (auto operand : operands)
+                    {
+                        if (operand->type != instruction.type)
+                            fail("phi operand of wrong type");
+                    }
+
+                    break;
+
+                case Opcode::Call:
+                {
+                    auto callee = instruction.callee;
+                    count(callee ? callee->parameters.size() : 0);
+
+                    if (!callee || module.function(callee->name) != callee)
+                        fail("callee is not a function of the module");
+
+                    for (size_t i = 0; i < operands.size(); ++i)
+                    {
+                        if (operands[i]->type != callee->parameters[i])
+                            fail("argument of wrong type");
+                    }
+
+                    if (instruction.type != callee->return_type)
+                        fail("call of wrong type");
+
+                    break;
+                }
+
+                case Opcode::Print:
+                    count(1);
+                    break;
+
+                case Opcode::Read:
+                    count(1);
+
+                    if (operands[0]->type != instruction.type)
+                        fail("read of wrong type");
+
+                    break;
+
+                case Opcode::Jump:
+                    count(0, 1);
+                    break;
+
+                case Opcode::Branch:
+                    count(1, 2);
+
+                    if (operands[0]->type != Type::Bool)
+                        fail("branch condition is not bool");
+
+                    break;
+
+                case Opcode::Return:
+                    count(function.return_type == Type::Void ? 0 : 1);
+
+                    if (!operands.empty() && operands[0]->type != function.return_type)
+                        fail("return of wrong type");
+
+                    break;
+
+                case Opcode::Trap:
+                    count(0);
+                    break;
+            }
+        }
+
+        [[noreturn]] void fail(const std::string &problem) const
+        {
+            std::string where = "function " + function.name;
+
+            if (block)
+                where += ", block b" + std::to_string(block->id);
+
+            if (instruction)
+                where += ", " + std::to_string(position.at(instruction).second - position.at(block->instructions.front().get()).second) + ". instruction";
+
+            throw VerificationError(where + ": " + problem);
+        }
+
+    private:
+        const Module &module;
+        const Function &function;
+
+        DominatorTree dominators;
+
+        std::set<const Block *> blocks;
+        std::map<const Instruction *, std::pair<const Block *, size_t>> position;   // block and number in function
+
+        const Block *block = nullptr;
+        const Instruction *instruction = nullptr;
+    };
+}
+
+
+void IR::verify(const Module &module)
+{
+    for (auto &function : module.functions)
+        Verifier(module, *function).verify();
+}
@@ -0,0 +1,30 @@
+#ifndef TOMATO_IR_VERIFIER_HPP
+#define TOMATO_IR_VERIFIER_HPP
+
+
+#include <stdexcept>
+
+#include "ir.hpp"
+
+
+namespace Tomato::IR
+{
+    class VerificationError : public std::runtime_error
+    {
+    public:
+        using runtime_error::runtime_error;
+    };
+
+
+    /**
+     * @brief Check that module is well-formed SSA: blocks end with a single terminator, phis
+     * come first and have an operand per predecessor, predecessors match terminator targets,
+     * every block is reachable, definitions dominate uses and operand types match.
+     *
+     * @throw VerificationError Describes the first problem found.
+     */
+    void verify(const Module &module);
+}
+
+
+#endif //TOMATO_IR_VERIFIER_HPP
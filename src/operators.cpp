@@ -78,6 +78,47 @@ BinaryOperator Tomato::GetBinaryOperator(const std::string &lexeme)
 }
 
 
+std::string Tomato::GetLexeme(UnaryOperator operator_)
+{
+    switch (operator_)
+    {
+        case UnaryOperator::Plus:   return "+";
+        case UnaryOperator::Minus:  return "-";
+        case UnaryOperator::Unpack: return "*";
+        case UnaryOperator::Not:    return "not";
+    }
+
+    return "?";
+}
+
+
+std::string Tomato::GetLexeme(BinaryOperator operator_)
+{
+    switch (operator_)
+    {
+        case BinaryOperator::Plus:  return "+";
+        case BinaryOperator::Minus: return "-";
+        case BinaryOperator::Mul:   return "*";
+        case BinaryOperator::Div:   return "/";
+        case BinaryOperator::Mod:   return "%";
+        case BinaryOperator::Exp:   return "^";
+
+        case BinaryOperator::LT:    return "<";
+        case BinaryOperator::LE:    return "<=";
+        case BinaryOperator::EQ:    return "==";
+        case BinaryOperator::NE:    return "!=";
+        case BinaryOperator::GE:    return ">=";
+        case BinaryOperator::GT:    return ">";
+
+        case BinaryOperator::And:   return "and";
+        case BinaryOperator::Or:    return "or";
+        case BinaryOperator::Xor:   return "xor";
+    }
+
+    return "?";
+}
+
+
 int Tomato::GetPrecedence(UnaryOperator operator_)
 {
     switch (operator_)
@@ -3,6 +3,8 @@
 
 
 #include <map>
+#include <string>
+#include <stdexcept>
 
 
 namespace Tomato
@@ -29,6 +31,9 @@ namespace Tomato
     UnaryOperator GetUnaryOperator(const std::string &lexeme);
     BinaryOperator GetBinaryOperator(const std::string &lexeme);
 
+    std::string GetLexeme(UnaryOperator operator_);
+    std::string GetLexeme(BinaryOperator operator_);
+
     int GetPrecedence(UnaryOperator operator_);
     int GetPrecedence(BinaryOperator operator_);
 
@@ -0,0 +1,508 @@
+#include "inliner.hpp"
+
+#include <set>
+#include <functional>
+
+
+using namespace Tomato;
+using namespace Tomato::Optimizer;
+
+
+namespace
+{
+    /**
+     * Walks the whole tree and collects what the inliner needs to know about it.
+     */
+    class Census : private Syntax::Visitor
+    {
+    public:
+        void count(Syntax::ASTNode &node)
+        {
+            visit(node);
+        }
+
+        size_t nodes = 0;
+        size_t returns = 0;
+        size_t functions = 0;
+        bool yields = false;
+        bool imports = false;                           // import not at top level of the counted tree
+        bool deferred = false;                          // some function body isn't parsed
+
+        std::map<std::string, size_t> definitions;      // function names, number of definitions
+        std::set<std::string> declared;                 // variable, parameter and loop counter names
+        std::set<std::string> calls;
+
+    private:
+        void process(Syntax::Program &node) override
+        {
+            ++nodes;
+
+            for (auto &statement : node.statements)
+            {
+                // top-level import runs module in the global scope, where function definitions are
+                if (!std::dynamic_pointer_cast<Syntax::ImportStatement>(statement))
+                    visit(*statement);
+            }
+        }
+
+        void process(Syntax::ValueDeclaration &node) override
+        {
+            ++nodes;
+            declared.insert(node.value->name);
+
+            if (node.init)
+                visit(*node.init);
+        }
+
+        void process(Syntax::Assignment &node) override
+        {
+            ++nodes;
+            visit(*node.destination);
+            visit(*node.source);
+        }
+
+        void process(Syntax::Function &node) override
+        {
+            ++nodes;
+            ++functions;
+            ++definitions[node.identifier->name];
+
+            for (auto &argument : node.arguments)
+                declared.insert(argument.param->name);
+
+            if (node.body)
+                visit(*node.body);
+            else
+                deferred = true;
+        }
+
+        void process(Syntax::ReturnStatement &node) override
+        {
+            ++nodes;
+            ++returns;
+            visit(*node.expression);
+        }
+
+        void process(Syntax::Call &node) override
+        {
+            ++nodes;
+            calls.insert(node.function->name);
+
+            for (auto &argument : node.arguments)
+                visit(*argument);
+        }
+
+        void process(Syntax::InlinedCall &node) override
+        {
+            visit(*node.call);
+        }
+
+        void process(Syntax::Spawn &node) override
+        {
+            ++nodes;
+            visit(*node.call);
+        }
+
+        void process(Syntax::Join &node) override
+        {
+            ++nodes;
+            visit(*node.task);
+        }
+
+        void process(Syntax::MakeChannel &node) override
+        {
+            ++nodes;
+            visit(*node.capacity);
+        }
+
+        void process(Syntax::Receive &node) override
+        {
+            ++nodes;
+            visit(*node.channel);
+        }
+
+        void process(Syntax::Identifier &) override
+        {
+            ++nodes;
+        }
+
+        void process(Syntax::Literal &) override
+        {
+            ++nodes;
+        }
+
+        void process(Syntax::BinaryOperation &node) override
+        {
+            ++nodes;
+            visit(*node.left);
+            visit(*node.right);
+        }
+
+        void process(Syntax::UnaryOperation &node) override
+        {
+            ++nodes;
+            visit(*node.operand);
+        }
+
+        void process(Syntax::ConditionalStatement &node) override
+        {
+            ++nodes;
+            visit(*node.condition);
+            visit(*node.then_case);
+
+            if (node.else_case)
+                visit(*node.else_case);
+        }
+
+        void process(Syntax::ConditionalLoop &node) override
+        {
+            ++nodes;
+            visit(*node.condition);
+            visit(*node.body);
+        }
+
+        void process(Syntax::RangeLoop &node) override
+        {
+            ++nodes;
+            declared.insert(node.counter->name);
+            visit(*node.begin);
+            visit(*node.end);
+
+            if (node.step)
+                visit(*node.step);
+
+            visit(*node.body);
+        }
+
+        void process(Syntax::ForEachLoop &node) override
+        {
+            ++nodes;
+            declared.insert(node.variable->name);
+            visit(*node.iterable);
+            visit(*node.body);
+        }
+
+        void process(Syntax::ParallelLoop &node) override
+        {
+            visit(*node.loop);
+        }
+
+        void process(Syntax::PrintStatement &node) override
+        {
+            ++nodes;
+            visit(*node.expression);
+        }
+
+        void process(Syntax::ReadStatement &node) override
+        {
+            ++nodes;
+            visit(*node.expression);
+        }
+
+        void process(Syntax::SendStatement &node) override
+        {
+            ++nodes;
+            visit(*node.channel);
+            visit(*node.value);
+        }
+
+        void process(Syntax::CloseStatement &node) override
+        {
+            ++nodes;
+            visit(*node.channel);
+        }
+
+        void process(Syntax::YieldStatement &node) override
+        {
+            ++nodes;
+            yields = true;
+            visit(*node.expression);
+        }
+
+        void process(Syntax::ImportStatement &) override
+        {
+            ++nodes;
+            imports = true;
+        }
+
+        void process(Syntax::StatementBlock &node) override
+        {
+            for (auto &statement : node.statements)
+                visit(*statement);
+        }
+    };
+}
+
+
+Inliner::Inliner(size_t limit) : limit(limit) {}
+
+
+size_t Inliner::optimize(Syntax::Program &program)
+{
+    Census census;
+    census.count(program);
+
+    // Deferred body may declare any name, nested import may define any function
+    if (census.deferred || census.imports)
+        return 0;
+
+    std::map<std::string, std::set<std::string>> calls;
+
+    for (auto &statement : program.statements)
+    {
+        auto function = std::dynamic_pointer_cast<Syntax::Function>(statement);
+
+        if (!function)
+            continue;
+
+        Census body;
+        body.count(*function->body);
+
+        calls[function->identifier->name] = body.calls;
+
+        auto &name = function->identifier->name;
+        auto &statements = function->body->statements;
+
+        if (census.definitions[name] != 1 || census.declared.count(name) || function->generator || function->memo)
+            continue;
+
+        if (body.functions > 0 || body.yields || body.imports || body.nodes > limit)
+            continue;
+
+        // single return as the last statement, unless function returns nothing
+        bool returns_last = !statements.empty() && std::dynamic_pointer_cast<Syntax::ReturnStatement>(statements.back());
+
+        if (function->return_type ? body.returns != 1 || !returns_last : body.returns != 0)
+            continue;
+
+        candidates[name] = function;
+    }
+
+    // Function calling itself, even through other functions, is not inlined
+    for (auto candidate = candidates.begin(); candidate != candidates.end();)
+    {
+        std::set<std::string> reached;
+
+        std::function<void(const std::string &)> reach = [&] (const std::string &name) {
+            auto callees = calls.find(name);
+
+            if (callees == calls.end())
+                return;
+
+            for (auto &callee : callees->second)
+            {
+                if (reached.insert(callee).second)
+                    reach(callee);
+            }
+        };
+
+        reach(candidate->first);
+
+        if (reached.count(candidate->first))
+            candidate = candidates.erase(candidate);
+        else
+            ++candidate;
+    }
+
+    inlined = 0;
+    visit(program);
+
+    return inlined;
+}
+
+
+template<typename Node>
+void Inliner::rewrite(std::shared_ptr<Node> &node)
+{
+    visit(*node);
+
+    auto call = std::dynamic_pointer_cast<Syntax::Call>(node);
+
+    if (!call)
+        return;
+
+    auto function = defined.find(call->function->name);
+
+    if (function == defined.end())
+        return;
+
+    if (auto expanded = expand(call, function->second))
+    {
+        node = expanded;
+        ++inlined;
+    }
+}
+
+
+std::shared_ptr<Syntax::InlinedCall> Inliner::expand(
+        const std::shared_ptr<Syntax::Call> &call,
+        const std::shared_ptr<Syntax::Function> &function) const
+{
+    // wrong number of arguments is reported by the call
+    if (call->arguments.size() != function->arguments.size())
+        return nullptr;
+
+    auto statements = function->body->statements;
+    std::shared_ptr<Syntax::Expression> result;
+
+    if (function->return_type)
+    {
+        result = std::static_pointer_cast<Syntax::ReturnStatement>(statements.back())->expression;
+        statements.pop_back();
+    }
+
+    std::shared_ptr<Syntax::StatementBlock> body;
+
+    if (!statements.empty())
+        body = std::make_shared<Syntax::StatementBlock>(statements);
+
+    return std::make_shared<Syntax::InlinedCall>(call, function, body, result);
+}
+
+
+void Inliner::process(Syntax::Program &node)
+{
+    for (auto &statement : node.statements)
+    {
+        rewrite(statement);
+
+        // Calls written after the definition can't run before it
+        auto function = std::dynamic_pointer_cast<Syntax::Function>(statement);
+
+        if (function && candidates.count(function->identifier->name))
+            defined[function->identifier->name] = function;
+    }
+}
+
+void Inliner::process(Syntax::ValueDeclaration &node)
+{
+    if (node.init)
+        rewrite(node.init);
+}
+
+void Inliner::process(Syntax::Assignment &node)
+{
+    rewrite(node.source);
+}
+
+void Inliner::process(Syntax::Function &node)
+{
+    visit(*node.body);
+}
+
+void Inliner::process(Syntax::ReturnStatement &node)
+{
+    rewrite(node.expression);
+}
+
+void Inliner::process(Syntax::Call &node)
+{
+    for (auto &argument : node.arguments)
+        rewrite(argument);
+}
+
+void Inliner::process(Syntax::InlinedCall &) {}
+
+// Spawned call stays a call, only its arguments are rewritten
+void Inliner::process(Syntax::Spawn &node)
+{
+    visit(*node.call);
+}
+
+void Inliner::process(Syntax::Join &node)
+{
+    rewrite(node.task);
+}
+
+void Inliner::process(Syntax::MakeChannel &node)
+{
+    rewrite(node.capacity);
+}
+
+void Inliner::process(Syntax::Receive &node)
+{
+    rewrite(node.channel);
+}
+
+void Inliner::process(Syntax::Identifier &) {}
+
+void Inliner::process(Syntax::Literal &) {}
+
+void Inliner::process(Syntax::BinaryOperation &node)
+{
+    rewrite(node.left);
+    rewrite(node.right);
+}
+
+void Inliner::process(Syntax::UnaryOperation &node)
+{
+    rewrite(node.operand);
+}
+
+void Inliner::process(Syntax::ConditionalStatement &node)
+{
+    rewrite(node.condition);
+    visit(*node.then_case);
+
+    if (node.else_case)
+        visit(*node.else_case);
+}
+
+void Inliner::process(Syntax::ConditionalLoop &node)
+{
+    rewrite(node.condition);
+    visit(*node.body);
+}
+
+void Inliner::process(Syntax::RangeLoop &node)
+{
+    rewrite(node.begin);
+    rewrite(node.end);
+
+    if (node.step)
+        rewrite(node.step);
+
+    visit(*node.body);
+}
+
+void Inliner::process(Syntax::ForEachLoop &node)
+{
+    rewrite(node.iterable);
+    visit(*node.body);
+}
+
+void Inliner::process(Syntax::ParallelLoop &node)
+{
+    visit(*node.loop);
+}
+
+void Inliner::process(Syntax::PrintStatement &node)
+{
+    rewrite(node.expression);
+}
+
+void Inliner::process(Syntax::ReadStatement &) {}
+
+void Inliner::process(Syntax::SendStatement &node)
+{
+    rewrite(node.channel);
+    rewrite(node.value);
+}
+
+void Inliner::process(Syntax::CloseStatement &node)
+{
+    rewrite(node.channel);
+}
+
+void Inliner::process(Syntax::YieldStatement &node)
+{
+    rewrite(node.expression);
+}
+
+void Inliner::process(Syntax::ImportStatement &) {}
+
+void Inliner::process(Syntax::StatementBlock &node)
+{
+    for (auto &statement : node.statements)
+        rewrite(statement);
+}
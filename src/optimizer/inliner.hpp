@@ -0,0 +1,93 @@
+#ifndef TOMATO_INLINER_HPP
+#define TOMATO_INLINER_HPP
+
+
+#include <map>
+#include <memory>
+#include <string>
+
+#include "syntax/visitor.hpp"
+#include "syntax/syntax_tree.hpp"
+
+
+namespace Tomato::Optimizer
+{
+    /**
+     * @brief Replaces calls of small non-recursive functions by their bodies.
+     *
+     * Names are resolved at run time, so a call is inlined only if it can't refer to anything
+     * but the inlined function: the function is defined once, at top level, the name is never
+     * declared as a variable, and the call is written after the definition. Inlined function
+     * may return only by its last statement, see Syntax::InlinedCall.
+     */
+    class Inliner : private Syntax::Visitor
+    {
+    public:
+        /**
+         * @param limit Maximum number of syntax tree nodes in body of inlined function.
+         */
+        explicit Inliner(size_t limit = DefaultLimit);
+
+        /**
+         * @brief Rewrite program in place. Programs with deferred bodies are left as they are.
+         * @return Number of calls replaced.
+         */
+        size_t optimize(Syntax::Program &program);
+
+        static const size_t DefaultLimit = 32;
+
+    private:
+        void process(Syntax::Program               &node) override;
+        void process(Syntax::ValueDeclaration      &node) override;
+        void process(Syntax::Assignment            &node) override;
+        void process(Syntax::Function              &node) override;
+        void process(Syntax::ReturnStatement       &node) override;
+        void process(Syntax::Call                  &node) override;
+        void process(Syntax::InlinedCall           &node) override;
+        void process(Syntax::Spawn                 &node) override;
+        void process(Syntax::Join                  &node) override;
+        void process(Syntax::MakeChannel           &node) override;
+        void process(Syntax::Receive               &node) override;
+        void process(Syntax::Identifier            &node) override;
+        void process(Syntax::Literal               &node) override;
+        void process(Syntax::BinaryOperation       &node) override;
+        void process(Syntax::UnaryOperation        &node) override;
+        void process(Syntax::ConditionalStatement  &node) override;
+        void process(Syntax::ConditionalLoop       &node) override;
+        void process(Syntax::RangeLoop             &node) override;
+        void process(Syntax::ForEachLoop           &node) override;
+        void process(Syntax::ParallelLoop          &node) override;
+        void process(Syntax::PrintStatement        &node) override;
+        void process(Syntax::ReadStatement         &node) override;
+        void process(Syntax::SendStatement         &node) override;
+        void process(Syntax::CloseStatement        &node) override;
+        void process(Syntax::YieldStatement        &node) override;
+        void process(Syntax::ImportStatement       &node) override;
+        void process(Syntax::StatementBlock        &node) override;
+
+        /**
+         * @brief Rewrite children of the node, then the node itself if it is an inlinable call.
+         */
+        template<typename Node>
+        void rewrite(std::shared_ptr<Node> &node);
+
+        /**
+         * @brief Call replaced by function body, nullptr if the function can't be inlined.
+         */
+        std::shared_ptr<Syntax::InlinedCall> expand(
+                const std::shared_ptr<Syntax::Call> &call,
+                const std::shared_ptr<Syntax::Function> &function
+        ) const;
+
+    private:
+        size_t limit;
+
+        std::map<std::string, std::shared_ptr<Syntax::Function>> candidates;   // inlinable after definition
+        std::map<std::string, std::shared_ptr<Syntax::Function>> defined;      // candidates defined so far
+
+        size_t inlined = 0;
+    };
+}
+
+
+#endif //TOMATO_INLINER_HPP
@@ -0,0 +1,306 @@
+#include "effects.hpp"
+
+
+using namespace Tomato;
+using namespace Tomato::Semantic;
+
+
+EffectAnalysis::EffectAnalysis(FunctionResolver resolver) : resolver(std::move(resolver)) {}
+
+
+Effects EffectAnalysis::analyze(Syntax::StatementBlock &block, const std::set<std::string> &locals)
+{
+    auto saved_scopes = std::move(scopes);
+    auto saved_effects = std::move(effects);
+
+    scopes = {Scope {locals, {}}};
+    effects = Effects();
+
+    visit(block);
+
+    auto result = std::move(effects);
+
+    scopes = std::move(saved_scopes);
+    effects = std::move(saved_effects);
+
+    return result;
+}
+
+
+Effects EffectAnalysis::analyze(const Syntax::Function &function)
+{
+    std::set<std::string> params;
+
+    for (auto &argument : function.arguments)
+        params.insert(argument.param->name);
+
+    in_progress.insert(&function);
+    auto result = analyze(*function.definition(), params);
+    in_progress.erase(&function);
+
+    result.returns = false;
+
+    return result;
+}
+
+
+void EffectAnalysis::declare(const std::string &name)
+{
+    scopes.back().names.insert(name);
+}
+
+
+void EffectAnalysis::write(const std::string &name)
+{
+    if (!declared(name))
+        effects.writes.insert(name);
+}
+
+
+void EffectAnalysis::read(const std::string &name)
+{
+    if (!declared(name))
+        effects.reads.insert(name);
+}
+
+
+bool EffectAnalysis::declared(const std::string &name) const
+{
+    for (auto scope = scopes.rbegin(); scope != scopes.rend(); ++scope)
+    {
+        if (scope->names.find(name) != scope->names.end())
+            return true;
+    }
+
+    return false;
+}
+
+
+std::shared_ptr<Syntax::Function> EffectAnalysis::function(const std::string &name) const
+{
+    for (auto scope = scopes.rbegin(); scope != scopes.rend(); ++scope)
+    {
+        auto function = scope->functions.find(name);
+
+        if (function != scope->functions.end())
+            return function->second;
+
+        // local variable shadows outer function
+        if (scope->names.find(name) != scope->names.end())
+            return nullptr;
+    }
+
+    return resolver ? resolver(name) : nullptr;
+}
+
+
+void EffectAnalysis::process(Syntax::Program &node)
+{
+    for (auto &statement : node.statements)
+        visit(*statement);
+}
+
+void EffectAnalysis::process(Syntax::StatementBlock &node)
+{
+    scopes.emplace_back();
+
+    for (auto &statement : node.statements)
+        visit(*statement);
+
+    scopes.pop_back();
+}
+
+void EffectAnalysis::process(Syntax::ValueDeclaration &node)
+{
+    if (node.init)
+        visit(*node.init);
+
+    declare(node.value->name);
+}
+
+void EffectAnalysis::process(Syntax::Assignment &node)
+{
+    visit(*node.source);
+
+    if (auto identifier = std::dynamic_pointer_cast<Syntax::Identifier>(node.destination))
+        write(identifier->name);
+    else
+        visit(*node.destination);
+}
+
+void EffectAnalysis::process(Syntax::Function &node)
+{
+    declare(node.identifier->name);
+    scopes.back().functions[node.identifier->name] = std::make_shared<Syntax::Function>(node);
+}
+
+void EffectAnalysis::process(Syntax::ReturnStatement &node)
+{
+    visit(*node.expression);
+    effects.returns = true;
+}
+
+void EffectAnalysis::process(Syntax::Call &node)
+{
+    for (auto &argument : node.arguments)
+        visit(*argument);
+
+    read(node.function->name);
+
+    auto callee = function(node.function->name);
+
+    if (!callee || in_progress.find(callee.get()) != in_progress.end())
+        return;
+
+    // Analyze callee separately, its writes to non-local names are resolved here
+    EffectAnalysis analysis(resolver);
+    analysis.in_progress = in_progress;
+
+    auto callee_effects = analysis.analyze(*callee);
+
+    effects.io = effects.io || callee_effects.io;
+    effects.communicates = effects.communicates || callee_effects.communicates;
+
+    for (auto &name : callee_effects.writes)
+        write(name);
+
+    for (auto &name : callee_effects.reads)
+        read(name);
+}
+
+// Inlined body has the same effects as the call
+void EffectAnalysis::process(Syntax::InlinedCall &node)
+{
+    visit(*node.call);
+}
+
+void EffectAnalysis::process(Syntax::Spawn &node)
+{
+    visit(*node.call);
+    effects.communicates = true;
+}
+
+void EffectAnalysis::process(Syntax::Join &node)
+{
+    visit(*node.task);
+    effects.communicates = true;
+}
+
+void EffectAnalysis::process(Syntax::MakeChannel &node)
+{
+    visit(*node.capacity);
+    effects.communicates = true;
+}
+
+void EffectAnalysis::process(Syntax::Receive &node)
+{
+    visit(*node.channel);
+    effects.communicates = true;
+}
+
+void EffectAnalysis::process(Syntax::Identifier &node)
+{
+    read(node.name);
+}
+
+void EffectAnalysis::process(Syntax::Literal &) {}
+
+void EffectAnalysis::process(Syntax::BinaryOperation &node)
+{
+    visit(*node.left);
+    visit(*node.right);
+}
+
+void EffectAnalysis::process(Syntax::UnaryOperation &node)
+{
+    visit(*node.operand);
+}
+
+void EffectAnalysis::process(Syntax::ConditionalStatement &node)
+{
+    visit(*node.condition);
+    visit(*node.then_case);
+
+    if (node.else_case)
+        visit(*node.else_case);
+}
+
+void EffectAnalysis::process(Syntax::ConditionalLoop &node)
+{
+    visit(*node.condition);
+    visit(*node.body);
+}
+
+void EffectAnalysis::process(Syntax::RangeLoop &node)
+{
+    visit(*node.begin);
+    visit(*node.end);
+
+    if (node.step)
+        visit(*node.step);
+
+    scopes.emplace_back();
+    declare(node.counter->name);
+    visit(*node.body);
+    scopes.pop_back();
+}
+
+void EffectAnalysis::process(Syntax::ForEachLoop &node)
+{
+    visit(*node.iterable);
+
+    scopes.emplace_back();
+    declare(node.variable->name);
+    visit(*node.body);
+    scopes.pop_back();
+}
+
+void EffectAnalysis::process(Syntax::ParallelLoop &node)
+{
+    visit(*node.loop);
+
+    for (auto &reduction : node.reductions)
+        write(reduction.variable->name);
+}
+
+void EffectAnalysis::process(Syntax::PrintStatement &node)
+{
+    visit(*node.expression);
+    effects.io = true;
+}
+
+void EffectAnalysis::process(Syntax::ReadStatement &node)
+{
+    effects.io = true;
+
+    if (auto identifier = std::dynamic_pointer_cast<Syntax::Identifier>(node.expression))
+        write(identifier->name);
+    else
+        visit(*node.expression);
+}
+
+// Channels synchronize by themselves, passing objects through them is not a write to shared variable
+void EffectAnalysis::process(Syntax::SendStatement &node)
+{
+    visit(*node.channel);
+    visit(*node.value);
+    effects.communicates = true;
+}
+
+void EffectAnalysis::process(Syntax::CloseStatement &node)
+{
+    visit(*node.channel);
+    effects.communicates = true;
+}
+
+void EffectAnalysis::process(Syntax::YieldStatement &node)
+{
+    visit(*node.expression);
+    effects.communicates = true;
+}
+
+// Importing reads module file and runs its top-level statements, which may do anything
+void EffectAnalysis::process(Syntax::ImportStatement &)
+{
+    effects.io = true;
+}
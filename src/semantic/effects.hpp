@@ -0,0 +1,106 @@
+#ifndef TOMATO_EFFECTS_HPP
+#define TOMATO_EFFECTS_HPP
+
+
+#include <set>
+#include <map>
+#include <string>
+#include <vector>
+#include <functional>
+
+#include "syntax/visitor.hpp"
+#include "syntax/syntax_tree.hpp"
+
+
+namespace Tomato::Semantic
+{
+    /**
+     * @brief Side effects of a piece of code observable from its enclosing scope.
+     */
+    struct Effects
+    {
+        bool io = false;                    ///< Code prints or reads
+        bool returns = false;               ///< Code contains return outside of nested functions
+        bool communicates = false;          ///< Code spawns or joins tasks, uses channels or yields
+        std::set<std::string> writes;       ///< Names assigned, but not declared by the code itself
+        std::set<std::string> reads;        ///< Names of objects and functions used, but not declared by the code itself
+    };
+
+
+    /**
+     * @brief Static analysis of side effects.
+     *
+     * Calls are followed into callee bodies. Since callee sees names of its caller,
+     * writes of callee to names it didn't declare are resolved at the call site.
+     */
+    class EffectAnalysis : private Syntax::Visitor
+    {
+    public:
+        using FunctionResolver = std::function<std::shared_ptr<Syntax::Function>(const std::string &)>;
+
+        /**
+         * @param resolver Finds function visible by given name outside of analyzed code, may return nullptr.
+         */
+        explicit EffectAnalysis(FunctionResolver resolver);
+
+        /**
+         * @param locals Names declared in the scope of the block, e.g. loop counter.
+         */
+        Effects analyze(Syntax::StatementBlock &block, const std::set<std::string> &locals = {});
+
+        Effects analyze(const Syntax::Function &function);
+
+    private:
+        void process(Syntax::Program               &node) override;
+        void process(Syntax::ValueDeclaration      &node) override;
+        void process(Syntax::Assignment            &node) override;
+        void process(Syntax::Function              &node) override;
+        void process(Syntax::ReturnStatement       &node) override;
+        void process(Syntax::Call                  &node) override;
+        void process(Syntax::InlinedCall           &node) override;
+        void process(Syntax::Spawn                 &node) override;
+        void process(Syntax::Join                  &node) override;
+        void process(Syntax::MakeChannel           &node) override;
+        void process(Syntax::Receive               &node) override;
+        void process(Syntax::Identifier            &node) override;
+        void process(Syntax::Literal               &node) override;
+        void process(Syntax::BinaryOperation       &node) override;
+        void process(Syntax::UnaryOperation        &node) override;
+        void process(Syntax::ConditionalStatement  &node) override;
+        void process(Syntax::ConditionalLoop       &node) override;
+        void process(Syntax::RangeLoop             &node) override;
+        void process(Syntax::ForEachLoop           &node) override;
+        void process(Syntax::ParallelLoop          &node) override;
+        void process(Syntax::PrintStatement        &node) override;
+        void process(Syntax::ReadStatement         &node) override;
+        void process(Syntax::SendStatement         &node) override;
+        void process(Syntax::CloseStatement        &node) override;
+        void process(Syntax::YieldStatement        &node) override;
+        void process(Syntax::ImportStatement       &node) override;
+        void process(Syntax::StatementBlock        &node) override;
+
+        void declare(const std::string &name);
+        void write(const std::string &name);
+        void read(const std::string &name);
+        bool declared(const std::string &name) const;
+
+        std::shared_ptr<Syntax::Function> function(const std::string &name) const;
+
+    private:
+        struct Scope
+        {
+            std::set<std::string> names;
+            std::map<std::string, std::shared_ptr<Syntax::Function>> functions;
+        };
+
+        FunctionResolver resolver;
+
+        std::vector<Scope> scopes;
+        Effects effects;
+
+        std::set<const Syntax::Function *> in_progress;
+    };
+}
+
+
+#endif //TOMATO_EFFECTS_HPP
@@ -4,9 +4,6 @@
 using namespace Tomato::Semantic;
 
 
-Symbol SymbolTable::NextSymbol = 0;
-
-
 SymbolTable::SymbolTable()
 {
     push_scope();
@@ -38,22 +35,43 @@ Symbol SymbolTable::define(const std::string &name)
         throw SemanticError("name '" + name + "' is already defined at this scope");
     }
 
-    symbols.back()[name] = NextSymbol++;
+    symbols.back()[name] = next_symbol++;
 
-    return NextSymbol - 1;
+    return next_symbol - 1;
+}
+
+
+Symbol SymbolTable::define_global(const std::string &name)
+{
+    if (symbols.front().find(name) != symbols.front().end())
+    {
+        throw SemanticError("name '" + name + "' is already defined at this scope");
+    }
+
+    symbols.front()[name] = next_symbol++;
+
+    return next_symbol - 1;
 }
 
 
 Symbol SymbolTable::lookup(const std::string &name)
+{
+    if (auto symbol = find(name))
+        return *symbol;
+
+    throw SemanticError("undefined reference to '" + name + "'");
+}
+
+
+std::optional<Symbol> SymbolTable::find(const std::string &name) const
 {
     for (auto scope = symbols.rbegin(); scope != symbols.rend(); ++scope)
     {
-        try
-        {
-            return scope->at(name);
-        }
-        catch (std::out_of_range &) {}
+        auto symbol = scope->find(name);
+
+        if (symbol != scope->end())
+            return symbol->second;
     }
 
-    throw SemanticError("undefined reference to '" + name + "'");
+    return std::nullopt;
 }
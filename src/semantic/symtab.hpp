@@ -6,6 +6,8 @@
 #include <vector>
 #include <map>
 #include <memory>
+#include <optional>
+#include <stdexcept>
 
 
 namespace Tomato::Semantic
@@ -20,6 +22,12 @@ namespace Tomato::Semantic
     };
 
 
+    /**
+     * @brief Scoped name to symbol mapping.
+     *
+     * Symbols are unique within a table only, every interpreter instance
+     * owns its table, so instances running on different threads don't share state.
+     */
     class SymbolTable
     {
     public:
@@ -28,6 +36,16 @@ namespace Tomato::Semantic
         Symbol define(const std::string &name);
         Symbol lookup(const std::string &name);
 
+        /**
+         * @brief Define name at the outermost scope, it stays visible after all inner scopes are popped.
+         */
+        Symbol define_global(const std::string &name);
+
+        /**
+         * @return Symbol of the innermost definition, std::nullopt for undefined name.
+         */
+        std::optional<Symbol> find(const std::string &name) const;
+
         using Scope = std::map<std::string, Symbol>;
 
         void push_scope();
@@ -38,7 +56,7 @@ namespace Tomato::Semantic
     private:
         std::vector<Scope> symbols;
 
-        static Symbol NextSymbol;
+        Symbol next_symbol = 0;
     };
 }
 
@@ -2,6 +2,8 @@
 
 #include <iostream>
 
+#include "scan.hpp"
+
 
 using namespace Tomato::Syntax;
 
@@ -34,10 +36,22 @@ std::string Tomato::Syntax::to_string(Terminal terminal)
         case Terminal::Do:          return "do";
         case Terminal::For:         return "for";
         case Terminal::In:          return "in";
+        case Terminal::Step:        return "step";
+        case Terminal::Parallel:    return "parallel";
+        case Terminal::Reduce:      return "reduce";
+        case Terminal::Memo:        return "memo";
         case Terminal::Func:        return "func";
         case Terminal::Return:      return "return";
+        case Terminal::Spawn:       return "spawn";
+        case Terminal::Join:        return "join";
+        case Terminal::Channel:     return "channel";
+        case Terminal::Send:        return "send";
+        case Terminal::Recv:        return "recv";
+        case Terminal::Close:       return "close";
+        case Terminal::Yield:       return "yield";
 
         case Terminal::Dot:         return "dot";
+        case Terminal::Range:       return "range";
         case Terminal::Coma:        return "coma";
 
         case Terminal::LParen:          return "lparen";
@@ -113,6 +127,18 @@ void Lexer::set_text(const std::string &text)
 }
 
 
+std::string Lexer::slice(size_t begin, size_t end) const
+{
+    return text.substr(begin, end - begin);
+}
+
+
+void Lexer::append(const std::string &text)
+{
+    this->text += text;
+}
+
+
 bool Lexer::eof()
 {
     skip_whitespace();
@@ -122,10 +148,7 @@ bool Lexer::eof()
 
 void Lexer::skip_whitespace()
 {
-    while (std::isspace(current()))
-    {
-        skip();
-    }
+    offset = Scan::whitespace_end(text.data(), offset + len, text.length()) - len;
 }
 
 
@@ -138,6 +161,15 @@ char Lexer::current()
 }
 
 
+char Lexer::next()
+{
+    if (offset + len + 1 >= text.length())
+        return '\0';
+    else
+        return text[offset + len + 1];
+}
+
+
 void Lexer::skip()
 {
     offset += 1;
@@ -169,6 +201,7 @@ void Lexer::reject()
 Token Lexer::token(Terminal terminal)
 {
     auto lexeme = text.substr(offset, len);
+    auto start = offset;
 
     offset += len;
     len = 0;
@@ -177,10 +210,10 @@ Token Lexer::token(Terminal terminal)
 
     if (keywords.find(lexeme) != keywords.end())
     {
-        return Token {keywords.at(lexeme), lexeme};
+        return Token {keywords.at(lexeme), lexeme, start};
     }
 
-    return Token {terminal, lexeme};
+    return Token {terminal, lexeme, start};
 }
 
 
@@ -241,6 +274,13 @@ Token Lexer::get_next()
 
             case '.':
                 accept();
+
+                if (current() == '.')
+                {
+                    accept();
+                    return token(Terminal::Range);
+                }
+
                 return token(Terminal::Dot);
 
             case ',':
@@ -277,10 +317,9 @@ Token Lexer::number()
         reject();
     }
 
-    while (std::isdigit(current()))
-        accept();
+    len = Scan::digits_end(text.data(), offset + len, text.length()) - offset;
 
-    if (current() == '.')
+    if (current() == '.' && next() != '.') // 1..5 is a range, not a float
     {
         accept();
 
@@ -289,8 +328,7 @@ Token Lexer::number()
             reject();
         }
 
-        while (isdigit(current()))
-            accept();
+        len = Scan::digits_end(text.data(), offset + len, text.length()) - offset;
 
         return token(Terminal::FloatLiteral);
     }
@@ -307,8 +345,7 @@ Token Lexer::identifier()
         reject();
     }
 
-    while (std::isalnum(current()))
-        accept();
+    len = Scan::alnum_end(text.data(), offset + len, text.length()) - offset;
 
     return token(Terminal::Identifier);
 }
@@ -10,7 +10,7 @@ namespace Tomato::Syntax
 {
     enum class Terminal
     {
-        Invalid, EndOfFile, Operator, Assignment, Arrow, Identifier, Dot, Coma,
+        Invalid, EndOfFile, Operator, Assignment, Arrow, Identifier, Dot, Range, Coma,
 
         IntegerLiteral, FloatLiteral, BooleanLiteral, CharacterLiteral, StringLiteral,
 
@@ -21,6 +21,9 @@ namespace Tomato::Syntax
         Import, Var, Let, If, Then, Else, End, While, Do, For, In, Func, Return,
 
         Print, Read,
+
+        // Contextual keywords, lexed as identifiers, the parser tells where they are keywords:
+        Step, Parallel, Reduce, Memo, Spawn, Join, Channel, Send, Recv, Close, Yield,
     };
 
 
@@ -31,6 +34,7 @@ namespace Tomato::Syntax
     {
         Terminal terminal;
         std::string lexeme;
+        size_t offset = 0;  ///< Position of the first character in text
     };
 
 
@@ -48,11 +52,22 @@ namespace Tomato::Syntax
 
         void set_text(const std::string &text);
 
+        /**
+         * @brief Continue text, tokens already read stay valid.
+         */
+        void append(const std::string &text);
+
         Token get_next();
         bool eof();
 
+        /**
+         * @return Text between given offsets.
+         */
+        std::string slice(size_t begin, size_t end) const;
+
     private:
         char current();
+        char next();
         void skip();
         void accept();
         void expect(char character);
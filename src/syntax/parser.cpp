@@ -1,28 +1,166 @@
 #include "parser.hpp"
 
+#include <algorithm>
+#include <cctype>
+#include <map>
 #include <stack>
+#include <string_view>
 #include <iostream>
 
 
 using namespace Tomato::Syntax;
 
 
+namespace
+{
+    // Words which became keywords with language extensions, they are still valid names
+    const std::map<std::string, Terminal> ContextualKeywords = {
+            {"parallel", Terminal::Parallel},
+            {"memo",     Terminal::Memo},
+            {"spawn",    Terminal::Spawn},
+            {"join",     Terminal::Join},
+            {"channel",  Terminal::Channel},
+            {"send",     Terminal::Send},
+            {"recv",     Terminal::Recv},
+            {"close",    Terminal::Close},
+            {"yield",    Terminal::Yield},
+    };
+}
+
+
 void Parser::set_text(const std::string &text)
 {
     lexer.set_text(text);
+    lookahead.reset();
+    function_yields.clear();
+    nesting = 0;
     accept(); // init current token
 }
 
 
+void Parser::set_input(Input input)
+{
+    this->input = std::move(input);
+}
+
+
 bool Parser::eof() const
 {
     return current.terminal == Terminal::EndOfFile;
 }
 
 
+size_t Parser::offset() const
+{
+    return current.offset;
+}
+
+
 void Parser::accept()
 {
-    current = lexer.get_next();
+    if (lookahead)
+    {
+        current = std::move(*lookahead);
+        lookahead.reset();
+    }
+    else
+    {
+        current = lexer.get_next();
+    }
+
+    if (nesting > 0)
+        refill(current);
+}
+
+
+const Token &Parser::peek()
+{
+    if (!lookahead)
+    {
+        lookahead = lexer.get_next();
+
+        if (nesting > 0)
+            refill(*lookahead);
+    }
+
+    return *lookahead;
+}
+
+
+void Parser::contextual(bool statement)
+{
+    if (current.terminal != Terminal::Identifier)
+        return;
+
+    auto keyword = ContextualKeywords.find(current.lexeme);
+
+    if (keyword == ContextualKeywords.end())
+        return;
+
+    auto &next = peek();
+    bool fits;
+
+    switch (keyword->second)
+    {
+        case Terminal::Parallel:
+            fits = statement && next.terminal == Terminal::For;
+            break;
+
+        case Terminal::Memo:
+            fits = statement && next.terminal == Terminal::Func;
+            break;
+
+        case Terminal::Channel:
+            fits = next.terminal == Terminal::LParen;
+            break;
+
+        case Terminal::Send:
+        case Terminal::Close:
+        case Terminal::Yield:
+            if (!statement)
+                return;
+            [[fallthrough]];
+
+        default:
+            // name after another name, a literal or 'not' can't continue an expression, so the word is the keyword;
+            // before '(', '=' or an operator it is a name, e.g. 'send(c, x)' calls function named send
+            fits = next.terminal == Terminal::Identifier
+                   || next.terminal == Terminal::IntegerLiteral || next.terminal == Terminal::FloatLiteral
+                   || next.terminal == Terminal::BooleanLiteral || next.terminal == Terminal::CharacterLiteral
+                   || next.terminal == Terminal::StringLiteral
+                   || (next.terminal == Terminal::Operator && next.lexeme == "not");
+            break;
+    }
+
+    // keyword is followed by the rest of its construct on the same line, while a name ending
+    // a statement may be followed by the next statement on the next line
+    if (fits && lexer.slice(current.offset, next.offset).find('\n') == std::string::npos)
+        current.terminal = keyword->second;
+}
+
+
+void Parser::refill(Token &token)
+{
+    std::string line;
+
+    while (token.terminal == Terminal::EndOfFile && input && input(line))
+    {
+        lexer.append("\n" + line);
+        token = lexer.get_next();
+    }
+}
+
+
+void Parser::open()
+{
+    ++nesting;
+    refill(current);
+}
+
+
+void Parser::close()
+{
+    --nesting;
 }
 
 
@@ -47,6 +185,102 @@ std::shared_ptr<ASTNode> Parser::parse()
 }
 
 
+void Parser::parse_program(Program &program)
+{
+    while (!eof())
+    {
+        program.statements.push_back(statement());
+    }
+}
+
+
+std::vector<size_t> Parser::top_level_functions(const std::string &text)
+{
+    std::vector<size_t> offsets;
+    size_t depth = 0;
+    size_t i = 0;
+
+    std::string_view previous;
+    size_t previous_begin = 0;
+
+    auto skip_literal = [&] (char quote) {
+        for (++i; i < text.size() && text[i] != quote; ++i)
+        {
+            if (text[i] == '\\')
+                ++i;
+        }
+
+        ++i;
+    };
+
+    while (i < text.size())
+    {
+        auto c = static_cast<unsigned char>(text[i]);
+
+        if (c == '"' || c == '\'')
+        {
+            skip_literal(c);
+        }
+        else if (std::isdigit(c))
+        {
+            // number never continues into a word, same as in lexer
+            while (i < text.size() && std::isdigit(static_cast<unsigned char>(text[i])))
+                ++i;
+        }
+        else if (std::isalpha(c))
+        {
+            size_t begin = i;
+
+            while (i < text.size() && std::isalnum(static_cast<unsigned char>(text[i])))
+                ++i;
+
+            auto word = std::string_view(text).substr(begin, i - begin);
+
+            // 'memo func' is split before the annotation
+            if (word == "func" && depth == 0)
+                offsets.push_back(previous == "memo" ? previous_begin : begin);
+
+            previous = word;
+            previous_begin = begin;
+
+            if (word == "if" || word == "while" || word == "for" || word == "func")
+                ++depth;
+            else if (word == "end" && depth > 0)
+                --depth;
+        }
+        else
+        {
+            ++i;
+        }
+    }
+
+    return offsets;
+}
+
+
+void Parser::defer_function_bodies(bool defer)
+{
+    defer_bodies = defer;
+}
+
+
+std::shared_ptr<StatementBlock> Parser::function_body(const std::string &text)
+{
+    set_text(text);
+
+    function_yields.push_back(false);
+
+    auto block = statement_block();
+
+    expect(Terminal::End);
+
+    if (!eof())
+        reject("end of function");
+
+    return block;
+}
+
+
 std::shared_ptr<Expression> Parser::expression()
 {
     return expression(0);
@@ -90,6 +324,8 @@ std::shared_ptr<Expression> Parser::expression(int precedence)
 
 std::shared_ptr<Expression> Parser::term()
 {
+    contextual(false);
+
     switch (current.terminal)
     {
         case Terminal::Operator:
@@ -108,7 +344,9 @@ std::shared_ptr<Expression> Parser::term()
         case Terminal::LParen:
         {
             accept();
+            open();
             auto expr = expression();
+            close();
             expect(Terminal::RParen);
 
             return expr;
@@ -124,6 +362,27 @@ std::shared_ptr<Expression> Parser::term()
                 return id;
         }
 
+        case Terminal::Spawn:
+        {
+            accept();
+            return std::make_shared<Spawn>(call(identifier()));
+        }
+
+        case Terminal::Join:
+        {
+            accept();
+            return std::make_shared<Join>(term());
+        }
+
+        case Terminal::Channel:
+            return make_channel();
+
+        case Terminal::Recv:
+        {
+            accept();
+            return std::make_shared<Receive>(term());
+        }
+
         case Terminal::IntegerLiteral:
         case Terminal::FloatLiteral:
         case Terminal::BooleanLiteral:
@@ -176,6 +435,8 @@ std::shared_ptr<Literal> Parser::literal()
 
 std::shared_ptr<Statement> Parser::statement()
 {
+    contextual(true);
+
     switch (current.terminal)
     {
         case Terminal::Identifier:
@@ -186,6 +447,10 @@ std::shared_ptr<Statement> Parser::statement()
         case Terminal::StringLiteral:
         case Terminal::Operator:
         case Terminal::LParen:
+        case Terminal::Spawn:
+        case Terminal::Join:
+        case Terminal::Channel:
+        case Terminal::Recv:
         {
             auto expr = expression();
 
@@ -211,9 +476,25 @@ std::shared_ptr<Statement> Parser::statement()
         case Terminal::While:
             return while_statement();
 
+        case Terminal::For:
+            return for_statement();
+
+        case Terminal::Parallel:
+            return parallel_statement();
+
         case Terminal::Func:
             return function();
 
+        case Terminal::Memo:
+        {
+            accept();
+
+            auto memoized = function();
+            memoized->memo = true;
+
+            return memoized;
+        }
+
         case Terminal::Print:
             return print_statement();
 
@@ -223,6 +504,18 @@ std::shared_ptr<Statement> Parser::statement()
         case Terminal::Return:
             return return_statement();
 
+        case Terminal::Send:
+            return send_statement();
+
+        case Terminal::Close:
+            return close_statement();
+
+        case Terminal::Yield:
+            return yield_statement();
+
+        case Terminal::Import:
+            return import_statement();
+
         default:
             reject("statement");
     }
@@ -326,11 +619,154 @@ std::shared_ptr<ConditionalLoop> Parser::while_statement()
     return std::make_shared<ConditionalLoop>(condition, body);
 }
 
+std::shared_ptr<Statement> Parser::for_statement()
+{
+    expect(Terminal::For);
+
+    auto variable = identifier();
+
+    expect(Terminal::In);
+
+    auto iterable = expression();
+
+    if (current.terminal == Terminal::Range)
+        return range_loop(variable, iterable, nullptr);
+
+    expect(Terminal::Do);
+
+    auto body = statement_block();
+
+    expect(Terminal::End);
+
+    return std::make_shared<ForEachLoop>(variable, iterable, body);
+}
+
+std::shared_ptr<RangeLoop> Parser::range_loop(
+        std::shared_ptr<Identifier> counter,
+        std::shared_ptr<Expression> begin,
+        std::vector<ParallelLoop::Reduction> *reductions)
+{
+    expect(Terminal::Range);
+
+    auto end = expression();
+
+    std::shared_ptr<Expression> step;
+
+    // nothing else may follow the end of range, so these words are always keywords here
+    if (current.terminal == Terminal::Identifier && current.lexeme == to_string(Terminal::Step))
+    {
+        accept();
+        step = expression();
+    }
+
+    if (reductions && current.terminal == Terminal::Identifier && current.lexeme == to_string(Terminal::Reduce))
+    {
+        do
+        {
+            accept();
+
+            static const std::map<std::string, ParallelLoop::Reduction::Type> types = {
+                    {"+",   ParallelLoop::Reduction::Type::Sum},
+                    {"*",   ParallelLoop::Reduction::Type::Product},
+                    {"min", ParallelLoop::Reduction::Type::Min},
+                    {"max", ParallelLoop::Reduction::Type::Max},
+                    {"and", ParallelLoop::Reduction::Type::And},
+                    {"or",  ParallelLoop::Reduction::Type::Or},
+            };
+
+            auto type = types.find(current.lexeme);
+
+            if ((current.terminal != Terminal::Operator && current.terminal != Terminal::Identifier)
+                || type == types.end())
+            {
+                reject("reduction operator");
+            }
+
+            accept();
+
+            reductions->push_back({type->second, identifier()});
+        }
+        while (current.terminal == Terminal::Coma);
+    }
+
+    expect(Terminal::Do);
+
+    auto body = statement_block();
+
+    expect(Terminal::End);
+
+    return std::make_shared<RangeLoop>(counter, begin, end, step, body);
+}
+
+std::shared_ptr<ParallelLoop> Parser::parallel_statement()
+{
+    expect(Terminal::Parallel);
+    expect(Terminal::For);
+
+    auto counter = identifier();
+
+    expect(Terminal::In);
+
+    auto begin = expression();
+
+    std::vector<ParallelLoop::Reduction> reductions;
+
+    auto loop = range_loop(counter, begin, &reductions);
+
+    return std::make_shared<ParallelLoop>(loop, reductions);
+}
+
+std::shared_ptr<SendStatement> Parser::send_statement()
+{
+    expect(Terminal::Send);
+
+    auto channel = expression();
+
+    expect(Terminal::Coma);
+
+    return std::make_shared<SendStatement>(channel, expression());
+}
+
+std::shared_ptr<YieldStatement> Parser::yield_statement()
+{
+    if (function_yields.empty())
+        throw SyntaxError("yield outside of function");
+
+    expect(Terminal::Yield);
+
+    function_yields.back() = true;
+
+    return std::make_shared<YieldStatement>(expression());
+}
+
+std::shared_ptr<CloseStatement> Parser::close_statement()
+{
+    expect(Terminal::Close);
+
+    return std::make_shared<CloseStatement>(expression());
+}
+
+std::shared_ptr<ImportStatement> Parser::import_statement()
+{
+    expect(Terminal::Import);
+
+    auto module = identifier();
+
+    while (current.terminal == Terminal::Dot)
+    {
+        accept();
+        module->name += "." + identifier()->name;
+    }
+
+    return std::make_shared<ImportStatement>(module);
+}
+
 std::shared_ptr<Function> Parser::function()
 {
     expect(Terminal::Func);
     auto name = identifier();
     expect(Terminal::LParen);
+    open();
 
     std::vector<Function::Argument> args;
 
@@ -345,6 +781,7 @@ std::shared_ptr<Function> Parser::function()
             expect(Terminal::Coma);
     }
 
+    close();
     expect(Terminal::RParen);
 
     std::shared_ptr<Identifier> ret_type;
@@ -355,17 +792,90 @@ std::shared_ptr<Function> Parser::function()
         ret_type = identifier();
     }
 
+    if (defer_bodies)
+    {
+        bool generator;
+        auto deferred = deferred_body(generator);
+
+        expect(Terminal::End);
+
+        auto function = std::make_shared<Function>(name, args, ret_type, nullptr);
+
+        function->deferred = deferred;
+        function->generator = generator;
+
+        return function;
+    }
+
+    function_yields.push_back(false);
+
     auto body = statement_block();
 
     expect(Terminal::End);
 
-    return std::make_shared<Function>(name, args, ret_type, body);
+    auto function = std::make_shared<Function>(name, args, ret_type, body);
+
+    function->generator = function_yields.back();
+    function_yields.pop_back();
+
+    return function;
+}
+
+std::shared_ptr<Function::DeferredBody> Parser::deferred_body(bool &generator)
+{
+    auto begin = current.offset;
+
+    // Every block is closed by its own 'end', only openers are tracked
+    std::vector<Terminal> blocks;
+
+    generator = false;
+
+    while (true)
+    {
+        contextual(true);
+
+        switch (current.terminal)
+        {
+            case Terminal::If:
+            case Terminal::While:
+            case Terminal::For:
+            case Terminal::Func:
+                blocks.push_back(current.terminal);
+                break;
+
+            case Terminal::End:
+                // closing 'end' is kept, so errors of full parse read the same as without deferring
+                if (blocks.empty())
+                    return std::make_shared<Function::DeferredBody>(
+                            lexer.slice(begin, current.offset + current.lexeme.size()));
+
+                blocks.pop_back();
+                break;
+
+            case Terminal::Yield:
+                // yield of nested function doesn't make this one a generator
+                if (std::find(blocks.begin(), blocks.end(), Terminal::Func) == blocks.end())
+                    generator = true;
+                break;
+
+            case Terminal::EndOfFile:
+            case Terminal::Invalid:
+                reject(to_string(Terminal::End));
+
+            default:
+                break;
+        }
+
+        accept();
+    }
 }
 
 std::shared_ptr<StatementBlock> Parser::statement_block()
 {
     auto block = std::make_shared<StatementBlock>();
 
+    open(); // block can't end before its closing keyword
+
     while (true)
     {
         switch (current.terminal)
@@ -378,8 +888,10 @@ std::shared_ptr<StatementBlock> Parser::statement_block()
             case Terminal::Operator:
             case Terminal::Identifier:
             case Terminal::LParen:
+            case Terminal::Import:
             case Terminal::If:
             case Terminal::While:
+            case Terminal::For:
             case Terminal::Func:
             case Terminal::Return:
             case Terminal::Print:
@@ -390,6 +902,7 @@ std::shared_ptr<StatementBlock> Parser::statement_block()
                 break;
 
             default:
+                close();
                 return block;
         }
     }
@@ -407,6 +920,7 @@ std::shared_ptr<Call> Parser::call(std::shared_ptr<Identifier> function)
     std::vector<std::shared_ptr<Expression>> args;
 
     expect(Terminal::LParen);
+    open();
 
     while (current.terminal != Terminal::RParen)
     {
@@ -416,7 +930,26 @@ std::shared_ptr<Call> Parser::call(std::shared_ptr<Identifier> function)
             expect(Terminal::Coma);
     }
 
+    close();
     expect(Terminal::RParen);
 
     return std::make_shared<Call>(function, args);
 }
+
+std::shared_ptr<MakeChannel> Parser::make_channel()
+{
+    expect(Terminal::Channel);
+    expect(Terminal::LParen);
+    open();
+
+    auto type = identifier();
+
+    expect(Terminal::Coma);
+
+    auto capacity = expression();
+
+    close();
+    expect(Terminal::RParen);
+
+    return std::make_shared<MakeChannel>(type, capacity);
+}
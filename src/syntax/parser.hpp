@@ -2,6 +2,9 @@
 #define TOMATO_SYNTAX_PARSER_H
 
 
+#include <functional>
+#include <optional>
+
 #include "lexer.hpp"
 #include "syntax_tree.hpp"
 
@@ -19,14 +22,63 @@ namespace Tomato::Syntax
      * @brief Tomato language syntax parser.
      *
      * Handwritten recursive descent LL(1) parser.
+     *
+     * Keywords added after the first version of the language ('parallel', 'spawn', 'yield', ...)
+     * are keywords only where their construct may start and the next token on the same line fits it,
+     * e.g. 'send' followed by a name or literal. Elsewhere they are names, so older scripts using them
+     * still parse.
      */
     class Parser
     {
     public:
+        /**
+         * @brief Source of further lines, returns false when there are no more.
+         */
+        using Input = std::function<bool(std::string &line)>;
+
         void set_text(const std::string &text);
+
+        /**
+         * @brief Read more lines when text ends inside a block or parentheses, instead of failing.
+         *
+         * Parsing resumes from where the text ended, so a statement typed line by line
+         * is lexed and parsed once. At the top level, end of text still ends the statement.
+         */
+        void set_input(Input input);
         std::shared_ptr<ASTNode> parse();
         bool eof() const;
 
+        /**
+         * @return Offset of current token in text.
+         */
+        size_t offset() const;
+
+        /**
+         * @brief Parse statements until the end of text, appending them to program.
+         * @throw SyntaxError Statements parsed before the error are kept in program.
+         */
+        void parse_program(Program &program);
+
+        /**
+         * @brief Quick scan for top-level function definitions, e.g. to parse parts of text independently.
+         *
+         * Only words opening and closing blocks are looked at, text is not validated,
+         * so parts must still be parsed to find out whether the split is right.
+         * @return Offsets of 'func' keywords outside of any block.
+         */
+        static std::vector<size_t> top_level_functions(const std::string &text);
+
+        /**
+         * @brief Only check block structure of function bodies, keep their text to be parsed on first use.
+         */
+        void defer_function_bodies(bool defer);
+
+        /**
+         * @brief Parse text of deferred function body, including its closing 'end'.
+         * @throw SyntaxError
+         */
+        std::shared_ptr<StatementBlock> function_body(const std::string &text);
+
     private:
         std::shared_ptr<Expression> expression();
         std::shared_ptr<Expression> expression(int precedence);
@@ -44,10 +96,28 @@ namespace Tomato::Syntax
         std::shared_ptr<ReadStatement> read_statement();
         std::shared_ptr<ConditionalStatement> if_statement();
         std::shared_ptr<ConditionalLoop> while_statement();
+        std::shared_ptr<Statement> for_statement();
+        std::shared_ptr<ParallelLoop> parallel_statement();
+        std::shared_ptr<SendStatement> send_statement();
+        std::shared_ptr<CloseStatement> close_statement();
+        std::shared_ptr<YieldStatement> yield_statement();
+        std::shared_ptr<ImportStatement> import_statement();
         std::shared_ptr<Function> function();
+        std::shared_ptr<Function::DeferredBody> deferred_body(bool &generator);
         std::shared_ptr<ReturnStatement> return_statement();
 
         std::shared_ptr<Call> call(std::shared_ptr<Identifier> function);
+        std::shared_ptr<MakeChannel> make_channel();
+
+        /**
+         * @brief Rest of range loop after 'for counter in begin'.
+         * @param reductions Reduce clause is allowed and its items are stored here, if not null.
+         */
+        std::shared_ptr<RangeLoop> range_loop(
+                std::shared_ptr<Identifier> counter,
+                std::shared_ptr<Expression> begin,
+                std::vector<ParallelLoop::Reduction> *reductions
+        );
 
     private:
         /**
@@ -55,12 +125,23 @@ namespace Tomato::Syntax
          */
         void accept();
 
+        /**
+         * @return Token after the current one, it is not accepted.
+         */
+        const Token &peek();
+
+        /**
+         * @brief Turn current identifier into contextual keyword, if it is one and the next token fits it.
+         * @param statement Statement starts here, otherwise only keywords starting expressions are recognized.
+         */
+        void contextual(bool statement);
+
         /**
          * @brief Reject current token, cause syntax error.
          * @param expected Part of error description, what terminals/nonterminals were expected.
          * @throw SyntaxError
          */
-        void reject(const std::string &expected);
+        [[noreturn]] void reject(const std::string &expected);
 
         /**
          * @brief Accept token if it matches, else reject.
@@ -69,9 +150,28 @@ namespace Tomato::Syntax
          */
         void expect(Terminal expected);
 
+        /**
+         * @brief Get more input while token is the end of text.
+         */
+        void refill(Token &token);
+
+        /**
+         * @brief Enter construct that must be closed, end of text in it is not the end of statement.
+         */
+        void open();
+        void close();
+
     private:
         Lexer lexer;
         Token current;
+        std::optional<Token> lookahead; // token after the current one, if it was peeked
+
+        std::vector<bool> function_yields; // whether functions being parsed contain yield, innermost last
+
+        bool defer_bodies = false;
+
+        Input input;
+        int nesting = 0;    // number of open blocks and parentheses
     };
 }
 
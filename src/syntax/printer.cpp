@@ -13,37 +13,51 @@ void Printer::print(ASTNode &tree)
 }
 
 
-void Printer::process(StatementBlock &node)
+void Printer::statements(const std::vector<std::shared_ptr<Statement>> &statements)
 {
-    for (auto &statement : node.statements)
+    for (auto &statement : statements)
     {
+        stream << std::string(depth * 4, ' ');
         visit(*statement);
         stream << std::endl;
     }
 }
 
+void Printer::block(StatementBlock &node)
+{
+    ++depth;
+    statements(node.statements);
+    --depth;
+}
+
+
+void Printer::process(StatementBlock &node)
+{
+    statements(node.statements);
+}
+
 void Printer::process(Identifier &node)
 {
-    stream << "<ID: " << node.name << ">";
+    stream << node.name;
 }
 
 void Printer::process(Literal &node)
 {
-    stream << "<L: " << node.lexeme << ">";
+    stream << node.lexeme;
 }
 
 void Printer::process(BinaryOperation &node)
 {
     stream << "(";
     visit(*node.left);
-    stream << " <OP> ";
+    stream << " " << GetLexeme(node.operation) << " ";
     visit(*node.right);
     stream << ")";
 }
 
 void Printer::process(UnaryOperation &node)
 {
-    stream << "(<OP> ";
+    stream << "(" << GetLexeme(node.operation) << (node.operation == UnaryOperator::Not ? " " : "");
     visit(*node.operand);
     stream << ")";
 }
@@ -54,10 +68,15 @@ void Printer::process(ConditionalStatement &node)
     stream << "if ";
     visit(*node.condition);
     stream << " then\n";
-    visit(*node.then_case);
-    stream << "else\n";
-    visit(*node.else_case);
-    stream << "end ";
+    block(*node.then_case);
+
+    if (node.else_case)
+    {
+        stream << std::string(depth * 4, ' ') << "else\n";
+        block(*node.else_case);
+    }
+
+    stream << std::string(depth * 4, ' ') << "end";
 }
 
 void Printer::process(ConditionalLoop &node)
@@ -65,8 +84,54 @@ void Printer::process(ConditionalLoop &node)
     stream << "while ";
     visit(*node.condition);
     stream << " do\n";
-    visit(*node.body);
-    stream << "end";
+    block(*node.body);
+    stream << std::string(depth * 4, ' ') << "end";
+}
+
+void Printer::process(RangeLoop &node)
+{
+    stream << "for " << node.counter->name << " in ";
+    visit(*node.begin);
+    stream << "..";
+    visit(*node.end);
+
+    if (node.step)
+    {
+        stream << " step ";
+        visit(*node.step);
+    }
+
+    stream << " do\n";
+    block(*node.body);
+    stream << std::string(depth * 4, ' ') << "end";
+}
+
+void Printer::process(ParallelLoop &node)
+{
+    static const char *const names[] = {"+", "*", "min", "max", "and", "or"};
+
+    auto &loop = *node.loop;
+
+    stream << "parallel for " << loop.counter->name << " in ";
+    visit(*loop.begin);
+    stream << "..";
+    visit(*loop.end);
+
+    if (loop.step)
+    {
+        stream << " step ";
+        visit(*loop.step);
+    }
+
+    for (size_t i = 0; i < node.reductions.size(); ++i)
+    {
+        stream << (i == 0 ? " reduce " : ", ");
+        stream << names[static_cast<int>(node.reductions[i].type)] << " " << node.reductions[i].variable->name;
+    }
+
+    stream << " do\n";
+    block(*loop.body);
+    stream << std::string(depth * 4, ' ') << "end";
 }
 
 void Printer::process(PrintStatement &node)
@@ -81,15 +146,150 @@ void Printer::process(ReadStatement &node)
     visit(*node.expression);
 }
 
+void Printer::process(Spawn &node)
+{
+    stream << "spawn ";
+    visit(*node.call);
+}
+
+void Printer::process(Join &node)
+{
+    stream << "join ";
+    visit(*node.task);
+}
+
+void Printer::process(ForEachLoop &node)
+{
+    stream << "for " << node.variable->name << " in ";
+    visit(*node.iterable);
+    stream << " do\n";
+    block(*node.body);
+    stream << std::string(depth * 4, ' ') << "end";
+}
+
+void Printer::process(MakeChannel &node)
+{
+    stream << "channel(" << node.type->name << ", ";
+    visit(*node.capacity);
+    stream << ")";
+}
+
+void Printer::process(Receive &node)
+{
+    stream << "recv ";
+    visit(*node.channel);
+}
+
+void Printer::process(SendStatement &node)
+{
+    stream << "send ";
+    visit(*node.channel);
+    stream << ", ";
+    visit(*node.value);
+}
+
+void Printer::process(CloseStatement &node)
+{
+    stream << "close ";
+    visit(*node.channel);
+}
+
+void Printer::process(YieldStatement &node)
+{
+    stream << "yield ";
+    visit(*node.expression);
+}
+
+void Printer::process(ImportStatement &node)
+{
+    stream << "import " << node.module->name;
+}
+
+
+void Printer::process(Assignment &node)
+{
+    visit(*node.destination);
+    stream << " = ";
+    visit(*node.source);
+}
+
+void Printer::process(Function &node)
+{
+    stream << (node.memo ? "memo func " : "func ") << node.identifier->name << "(";
+
+    for (size_t i = 0; i < node.arguments.size(); ++i)
+        stream << (i == 0 ? "" : ", ") << node.arguments[i].param->name << " " << node.arguments[i].type->name;
+
+    stream << ")";
+
+    if (node.return_type)
+        stream << " -> " << node.return_type->name;
+
+    stream << "\n";
+
+    // printing doesn't force parsing of a deferred body
+    if (node.body)
+        block(*node.body);
+    else if (node.deferred->parsed)
+        block(*node.deferred->block);
+    else
+        stream << std::string((depth + 1) * 4, ' ') << "..." << std::endl;
+
+    stream << std::string(depth * 4, ' ') << "end";
+}
+
+void Printer::process(ReturnStatement &node)
+{
+    stream << "return ";
+    visit(*node.expression);
+}
+
+void Printer::process(Call &node)
+{
+    stream << node.function->name << "(";
+
+    for (size_t i = 0; i < node.arguments.size(); ++i)
+    {
+        stream << (i == 0 ? "" : ", ");
+        visit(*node.arguments[i]);
+    }
+
+    stream << ")";
+}
+
+void Printer::process(InlinedCall &node)
+{
+    visit(*node.call);
+    stream << " [inlined:";
+
+    if (node.body)
+    {
+        for (auto &statement : node.body->statements)
+        {
+            stream << " ";
+            visit(*statement);
+            stream << ";";
+        }
+    }
+
+    if (node.result)
+    {
+        stream << " return ";
+        visit(*node.result);
+    }
+
+    stream << "]";
+}
+
 
 void Printer::process(Program &node)
 {
-    stream << "PROGRAM\n";
+    statements(node.statements);
 }
 
 void Printer::process(ValueDeclaration &node)
 {
-    stream << "var " << node.value->name;
+    stream << (node.constant ? "let " : "var ") << node.value->name;
 
     if (node.type)
         stream << " " << node.type->name;
@@ -99,6 +299,4 @@ void Printer::process(ValueDeclaration &node)
         stream << " = ";
         visit(*node.init);
     }
-
-    stream << std::endl;
 }
@@ -3,6 +3,8 @@
 
 
 #include <ostream>
+#include <memory>
+#include <vector>
 
 #include "visitor.hpp"
 #include "syntax_tree.hpp"
@@ -10,6 +12,12 @@
 
 namespace Tomato::Syntax
 {
+    /**
+     * @brief Writes syntax tree back as source text, one statement per line.
+     *
+     * Parentheses show the structure of expressions, inlined calls are written as
+     * the call followed by the body executed instead, in square brackets.
+     */
     class Printer : private Visitor
     {
     public:
@@ -19,21 +27,42 @@ namespace Tomato::Syntax
 
     private:
         void process(StatementBlock &node) override;
+        void process(Assignment &node) override;
+        void process(Function &node) override;
+        void process(ReturnStatement &node) override;
+        void process(Call &node) override;
+        void process(InlinedCall &node) override;
         void process(Identifier &node) override;
         void process(Literal &node) override;
         void process(BinaryOperation &node) override;
         void process(UnaryOperation &node) override;
         void process(ConditionalStatement &node) override;
         void process(ConditionalLoop &node) override;
+        void process(RangeLoop &node) override;
+        void process(ParallelLoop &node) override;
         void process(PrintStatement &node) override;
         void process(ReadStatement &node) override;
+        void process(Spawn &node) override;
+        void process(Join &node) override;
+        void process(ForEachLoop &node) override;
+        void process(MakeChannel &node) override;
+        void process(Receive &node) override;
+        void process(SendStatement &node) override;
+        void process(CloseStatement &node) override;
+        void process(YieldStatement &node) override;
+        void process(ImportStatement &node) override;
 
         void process(struct Program &node) override;
 
         void process(struct ValueDeclaration &node) override;
 
+        void statements(const std::vector<std::shared_ptr<Statement>> &statements);
+        void block(StatementBlock &node);
+
     private:
         std::ostream &stream;
+
+        size_t depth = 0;
     };
 }
 
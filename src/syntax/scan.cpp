@@ -0,0 +1,228 @@
+#include "scan.hpp"
+
+#include <atomic>
+#include <cstdint>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define TOMATO_SCAN_X86
+#endif
+
+
+using namespace Tomato::Syntax;
+
+
+namespace
+{
+    bool is_whitespace(unsigned char c)
+    {
+        return c == ' ' || static_cast<unsigned char>(c - '\t') <= '\r' - '\t';
+    }
+
+    bool is_digit(unsigned char c)
+    {
+        return static_cast<unsigned char>(c - '0') <= 9;
+    }
+
+    bool is_alnum(unsigned char c)
+    {
+        return is_digit(c) || static_cast<unsigned char>((c | 0x20) - 'a') <= 'z' - 'a';
+    }
+
+
+    template <bool (*Belongs)(unsigned char)>
+    size_t scalar_end(const char *text, size_t begin, size_t end)
+    {
+        while (begin < end && Belongs(static_cast<unsigned char>(text[begin])))
+            ++begin;
+
+        return begin;
+    }
+
+
+#ifdef TOMATO_SCAN_X86
+
+    /*
+     * Vector scans classify a block of bytes into a bit mask and stop at the
+     * first zero bit. Unsigned range checks use wrapping subtraction and min,
+     * as SSE2 and AVX2 lack unsigned byte comparison. AVX2 code is compiled
+     * for that target only and is never called unless the CPU supports it.
+     */
+
+    __m128i sse2_in_range(__m128i v, char low, char high)
+    {
+        auto shifted = _mm_sub_epi8(v, _mm_set1_epi8(low));
+        return _mm_cmpeq_epi8(_mm_min_epu8(shifted, _mm_set1_epi8(static_cast<char>(high - low))), shifted);
+    }
+
+    uint32_t sse2_whitespace(const char *p)
+    {
+        auto v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        auto space = _mm_cmpeq_epi8(v, _mm_set1_epi8(' '));
+        return static_cast<uint32_t>(_mm_movemask_epi8(_mm_or_si128(space, sse2_in_range(v, '\t', '\r'))));
+    }
+
+    uint32_t sse2_digits(const char *p)
+    {
+        auto v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        return static_cast<uint32_t>(_mm_movemask_epi8(sse2_in_range(v, '0', '9')));
+    }
+
+    uint32_t sse2_alnum(const char *p)
+    {
+        auto v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        auto letter = sse2_in_range(_mm_or_si128(v, _mm_set1_epi8(0x20)), 'a', 'z');
+        return static_cast<uint32_t>(_mm_movemask_epi8(_mm_or_si128(letter, sse2_in_range(v, '0', '9'))));
+    }
+
+    template <uint32_t (*Classify)(const char *), bool (*Belongs)(unsigned char)>
+    size_t sse2_end(const char *text, size_t begin, size_t end)
+    {
+        for (; begin + 16 <= end; begin += 16)
+        {
+            auto mask = Classify(text + begin);
+
+            if (mask != 0xffff)
+                return begin + __builtin_ctz(~mask);
+        }
+
+        return scalar_end<Belongs>(text, begin, end);
+    }
+
+
+    __attribute__((target("avx2"))) __m256i avx2_in_range(__m256i v, char low, char high)
+    {
+        auto shifted = _mm256_sub_epi8(v, _mm256_set1_epi8(low));
+        return _mm256_cmpeq_epi8(_mm256_min_epu8(shifted, _mm256_set1_epi8(static_cast<char>(high - low))), shifted);
+    }
+
+    __attribute__((target("avx2"))) uint32_t avx2_whitespace(const char *p)
+    {
+        auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+        auto space = _mm256_cmpeq_epi8(v, _mm256_set1_epi8(' '));
+        return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_or_si256(space, avx2_in_range(v, '\t', '\r'))));
+    }
+
+    __attribute__((target("avx2"))) uint32_t avx2_digits(const char *p)
+    {
+        auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+        return static_cast<uint32_t>(_mm256_movemask_epi8(avx2_in_range(v, '0', '9')));
+    }
+
+    __attribute__((target("avx2"))) uint32_t avx2_alnum(const char *p)
+    {
+        auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+        auto letter = avx2_in_range(_mm256_or_si256(v, _mm256_set1_epi8(0x20)), 'a', 'z');
+        return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_or_si256(letter, avx2_in_range(v, '0', '9'))));
+    }
+
+    template <uint32_t (*Classify)(const char *), bool (*Belongs)(unsigned char)>
+    __attribute__((target("avx2"))) size_t avx2_end(const char *text, size_t begin, size_t end)
+    {
+        for (; begin + 32 <= end; begin += 32)
+        {
+            auto mask = Classify(text + begin);
+
+            if (mask != 0xffffffff)
+                return begin + __builtin_ctz(~mask);
+        }
+
+        return scalar_end<Belongs>(text, begin, end);
+    }
+
+#endif
+
+
+    using ScanFunction = size_t (*)(const char *, size_t, size_t);
+
+    struct Implementation
+    {
+        Scan::Isa isa;
+        ScanFunction whitespace_end;
+        ScanFunction alnum_end;
+        ScanFunction digits_end;
+    };
+
+    const Implementation Implementations[] = {
+            {Scan::Isa::Scalar, scalar_end<is_whitespace>, scalar_end<is_alnum>, scalar_end<is_digit>},
+#ifdef TOMATO_SCAN_X86
+            {
+                    Scan::Isa::SSE2,
+                    sse2_end<sse2_whitespace, is_whitespace>,
+                    sse2_end<sse2_alnum, is_alnum>,
+                    sse2_end<sse2_digits, is_digit>
+            },
+            {
+                    Scan::Isa::AVX2,
+                    avx2_end<avx2_whitespace, is_whitespace>,
+                    avx2_end<avx2_alnum, is_alnum>,
+                    avx2_end<avx2_digits, is_digit>
+            },
+#endif
+    };
+
+
+    const Implementation &implementation(Scan::Isa isa)
+    {
+        for (auto &candidate : Implementations)
+        {
+            if (candidate.isa == isa)
+                return candidate;
+        }
+
+        return Implementations[0];
+    }
+
+    std::atomic<const Implementation *> &current()
+    {
+        static std::atomic<const Implementation *> current {&implementation(Scan::detect())};
+
+        return current;
+    }
+}
+
+
+Scan::Isa Scan::detect()
+{
+#ifdef TOMATO_SCAN_X86
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2"))
+        return Isa::AVX2;
+
+    if (__builtin_cpu_supports("sse2"))
+        return Isa::SSE2;
+#endif
+
+    return Isa::Scalar;
+}
+
+
+void Scan::select(Isa isa)
+{
+    current() = &implementation(isa);
+}
+
+
+Scan::Isa Scan::selected()
+{
+    return current().load(std::memory_order_relaxed)->isa;
+}
+
+
+size_t Scan::whitespace_end(const char *text, size_t begin, size_t end)
+{
+    return current().load(std::memory_order_relaxed)->whitespace_end(text, begin, end);
+}
+
+
+size_t Scan::alnum_end(const char *text, size_t begin, size_t end)
+{
+    return current().load(std::memory_order_relaxed)->alnum_end(text, begin, end);
+}
+
+
+size_t Scan::digits_end(const char *text, size_t begin, size_t end)
+{
+    return current().load(std::memory_order_relaxed)->digits_end(text, begin, end);
+}
@@ -0,0 +1,38 @@
+#ifndef TOMATO_SYNTAX_SCAN_HPP
+#define TOMATO_SYNTAX_SCAN_HPP
+
+
+#include <cstddef>
+
+
+namespace Tomato::Syntax::Scan
+{
+    /**
+     * @brief Instruction set used by character class scans.
+     */
+    enum class Isa { Scalar, SSE2, AVX2 };
+
+    /**
+     * @return The widest instruction set supported by the running CPU.
+     */
+    Isa detect();
+
+    /**
+     * @brief Use given instruction set, it must not be wider than detect(). Default is detect().
+     */
+    void select(Isa isa);
+
+    Isa selected();
+
+    /*
+     * Scans return offset of the first character in [begin, end) not belonging
+     * to the class, or end. Classes are those of <cctype> in "C" locale.
+     */
+
+    size_t whitespace_end(const char *text, size_t begin, size_t end);  ///< isspace
+    size_t alnum_end(const char *text, size_t begin, size_t end);       ///< isalnum
+    size_t digits_end(const char *text, size_t begin, size_t end);      ///< isdigit
+}
+
+
+#endif //TOMATO_SYNTAX_SCAN_HPP
@@ -0,0 +1,607 @@
+#include "serializer.hpp"
+
+
+using namespace Tomato;
+using namespace Tomato::Syntax;
+
+
+namespace
+{
+    enum class Tag : uint8_t
+    {
+        Null,
+        Program, StatementBlock,
+        ValueDeclaration, Assignment, Function, ReturnStatement, Call,
+        Identifier, Literal, BinaryOperation, UnaryOperation,
+        ConditionalStatement, ConditionalLoop, RangeLoop,
+        PrintStatement, ReadStatement,
+        ParallelLoop, Spawn, Join,
+        ForEachLoop, MakeChannel, Receive, SendStatement, CloseStatement,
+        YieldStatement, ImportStatement,
+    };
+
+    const int MaxDepth = 10000;
+}
+
+
+Serializer::Serializer(std::string &buffer) : buffer(buffer) {}
+
+
+void Serializer::serialize(ASTNode &tree)
+{
+    visit(tree);
+}
+
+
+void Serializer::write(const std::shared_ptr<ASTNode> &node)
+{
+    if (node)
+        visit(*node);
+    else
+        write(static_cast<uint8_t>(Tag::Null));
+}
+
+void Serializer::write(const std::string &string)
+{
+    write(static_cast<uint32_t>(string.size()));
+    buffer += string;
+}
+
+void Serializer::write(uint32_t value)
+{
+    for (int i = 0; i < 4; ++i)
+        buffer += static_cast<char>((value >> (8 * i)) & 0xFF);
+}
+
+void Serializer::write(uint8_t value)
+{
+    buffer += static_cast<char>(value);
+}
+
+
+void Serializer::process(Program &node)
+{
+    write(static_cast<uint8_t>(Tag::Program));
+    write(static_cast<uint32_t>(node.statements.size()));
+
+    for (auto &statement : node.statements)
+        write(statement);
+}
+
+void Serializer::process(StatementBlock &node)
+{
+    write(static_cast<uint8_t>(Tag::StatementBlock));
+    write(static_cast<uint32_t>(node.statements.size()));
+
+    for (auto &statement : node.statements)
+        write(statement);
+}
+
+void Serializer::process(ValueDeclaration &node)
+{
+    write(static_cast<uint8_t>(Tag::ValueDeclaration));
+    write(node.value);
+    write(node.type);
+    write(node.init);
+    write(static_cast<uint8_t>(node.constant));
+}
+
+void Serializer::process(Assignment &node)
+{
+    write(static_cast<uint8_t>(Tag::Assignment));
+    write(node.destination);
+    write(node.source);
+}
+
+void Serializer::process(Function &node)
+{
+    write(static_cast<uint8_t>(Tag::Function));
+    write(node.identifier);
+    write(static_cast<uint32_t>(node.arguments.size()));
+
+    for (auto &argument : node.arguments)
+    {
+        write(argument.param);
+        write(argument.type);
+    }
+
+    write(node.return_type);
+    write(node.body);
+    write(static_cast<uint8_t>(node.generator));
+    write(static_cast<uint8_t>(node.memo));
+
+    // deferred body stays deferred in the cache
+    if (!node.body)
+        write(node.deferred->source);
+}
+
+void Serializer::process(ReturnStatement &node)
+{
+    write(static_cast<uint8_t>(Tag::ReturnStatement));
+    write(node.expression);
+}
+
+void Serializer::process(Call &node)
+{
+    write(static_cast<uint8_t>(Tag::Call));
+    write(node.function);
+    write(static_cast<uint32_t>(node.arguments.size()));
+
+    for (auto &argument : node.arguments)
+        write(argument);
+}
+
+// Inlining is redone after loading, so the tree is stored as written
+void Serializer::process(InlinedCall &node)
+{
+    visit(*node.call);
+}
+
+void Serializer::process(Spawn &node)
+{
+    write(static_cast<uint8_t>(Tag::Spawn));
+    write(node.call);
+}
+
+void Serializer::process(Join &node)
+{
+    write(static_cast<uint8_t>(Tag::Join));
+    write(node.task);
+}
+
+void Serializer::process(MakeChannel &node)
+{
+    write(static_cast<uint8_t>(Tag::MakeChannel));
+    write(node.type);
+    write(node.capacity);
+}
+
+void Serializer::process(Receive &node)
+{
+    write(static_cast<uint8_t>(Tag::Receive));
+    write(node.channel);
+}
+
+void Serializer::process(Identifier &node)
+{
+    write(static_cast<uint8_t>(Tag::Identifier));
+    write(node.name);
+}
+
+void Serializer::process(Literal &node)
+{
+    write(static_cast<uint8_t>(Tag::Literal));
+    write(static_cast<uint8_t>(node.type));
+    write(node.lexeme);
+}
+
+void Serializer::process(BinaryOperation &node)
+{
+    write(static_cast<uint8_t>(Tag::BinaryOperation));
+    write(node.left);
+    write(static_cast<uint8_t>(node.operation));
+    write(node.right);
+}
+
+void Serializer::process(UnaryOperation &node)
+{
+    write(static_cast<uint8_t>(Tag::UnaryOperation));
+    write(static_cast<uint8_t>(node.operation));
+    write(node.operand);
+}
+
+void Serializer::process(ConditionalStatement &node)
+{
+    write(static_cast<uint8_t>(Tag::ConditionalStatement));
+    write(node.condition);
+    write(node.then_case);
+    write(node.else_case);
+}
+
+void Serializer::process(ConditionalLoop &node)
+{
+    write(static_cast<uint8_t>(Tag::ConditionalLoop));
+    write(node.condition);
+    write(node.body);
+}
+
+void Serializer::process(RangeLoop &node)
+{
+    write(static_cast<uint8_t>(Tag::RangeLoop));
+    write(node.counter);
+    write(node.begin);
+    write(node.end);
+    write(node.step);
+    write(node.body);
+}
+
+void Serializer::process(ForEachLoop &node)
+{
+    write(static_cast<uint8_t>(Tag::ForEachLoop));
+    write(node.variable);
+    write(node.iterable);
+    write(node.body);
+}
+
+void Serializer::process(ParallelLoop &node)
+{
+    write(static_cast<uint8_t>(Tag::ParallelLoop));
+    write(node.loop);
+    write(static_cast<uint32_t>(node.reductions.size()));
+
+    for (auto &reduction : node.reductions)
+    {
+        write(static_cast<uint8_t>(reduction.type));
+        write(reduction.variable);
+    }
+}
+
+void Serializer::process(PrintStatement &node)
+{
+    write(static_cast<uint8_t>(Tag::PrintStatement));
+    write(node.expression);
+}
+
+void Serializer::process(ReadStatement &node)
+{
+    write(static_cast<uint8_t>(Tag::ReadStatement));
+    write(node.expression);
+}
+
+void Serializer::process(SendStatement &node)
+{
+    write(static_cast<uint8_t>(Tag::SendStatement));
+    write(node.channel);
+    write(node.value);
+}
+
+void Serializer::process(CloseStatement &node)
+{
+    write(static_cast<uint8_t>(Tag::CloseStatement));
+    write(node.channel);
+}
+
+void Serializer::process(YieldStatement &node)
+{
+    write(static_cast<uint8_t>(Tag::YieldStatement));
+    write(node.expression);
+}
+
+void Serializer::process(ImportStatement &node)
+{
+    write(static_cast<uint8_t>(Tag::ImportStatement));
+    write(node.module);
+}
+
+
+
+Deserializer::Deserializer(const char *data, size_t size) : data(data), size(size) {}
+
+
+std::shared_ptr<Program> Deserializer::program()
+{
+    auto program = node<Program>();
+
+    if (offset != size)
+        throw SerializationError("trailing data after program");
+
+    return program;
+}
+
+
+uint8_t Deserializer::u8()
+{
+    if (offset + 1 > size)
+        throw SerializationError("unexpected end of data");
+
+    return static_cast<uint8_t>(data[offset++]);
+}
+
+uint32_t Deserializer::u32()
+{
+    uint32_t value = 0;
+
+    for (int i = 0; i < 4; ++i)
+        value |= static_cast<uint32_t>(u8()) << (8 * i);
+
+    return value;
+}
+
+std::string Deserializer::string()
+{
+    auto length = u32();
+
+    if (length > size - offset)
+        throw SerializationError("unexpected end of data");
+
+    std::string value(data + offset, length);
+    offset += length;
+
+    return value;
+}
+
+
+template <typename T>
+std::shared_ptr<T> Deserializer::node(bool optional)
+{
+    auto any = node();
+
+    if (!any)
+    {
+        if (optional)
+            return nullptr;
+
+        throw SerializationError("missing node");
+    }
+
+    auto typed = std::dynamic_pointer_cast<T>(any);
+
+    if (!typed)
+        throw SerializationError("unexpected node type");
+
+    return typed;
+}
+
+
+std::shared_ptr<ASTNode> Deserializer::node()
+{
+    if (++depth > MaxDepth)
+        throw SerializationError("syntax tree is too deep");
+
+    std::shared_ptr<ASTNode> result;
+
+    switch (static_cast<Tag>(u8()))
+    {
+        case Tag::Null:
+            break;
+
+        case Tag::Program:
+        {
+            auto program = std::make_shared<Program>();
+            auto count = u32();
+
+            for (uint32_t i = 0; i < count; ++i)
+                program->statements.push_back(node<Statement>());
+
+            result = program;
+            break;
+        }
+
+        case Tag::StatementBlock:
+        {
+            auto block = std::make_shared<StatementBlock>();
+            auto count = u32();
+
+            for (uint32_t i = 0; i < count; ++i)
+                block->statements.push_back(node<Statement>());
+
+            result = block;
+            break;
+        }
+
+        case Tag::ValueDeclaration:
+        {
+            auto value = node<Identifier>();
+            auto type = node<Identifier>(true);
+            auto init = node<Expression>(true);
+            bool constant = u8() != 0;
+
+            result = std::make_shared<ValueDeclaration>(value, type, init, constant);
+            break;
+        }
+
+        case Tag::Assignment:
+        {
+            auto destination = node<Expression>();
+            auto source = node<Expression>();
+
+            result = std::make_shared<Assignment>(destination, source);
+            break;
+        }
+
+        case Tag::Function:
+        {
+            auto identifier = node<Identifier>();
+            auto count = u32();
+
+            std::vector<Function::Argument> arguments;
+
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                auto param = node<Identifier>();
+                auto type = node<Identifier>();
+                arguments.push_back({param, type});
+            }
+
+            auto return_type = node<Identifier>(true);
+            auto body = node<StatementBlock>(true);
+
+            auto function = std::make_shared<Function>(identifier, arguments, return_type, body);
+            function->generator = u8() != 0;
+            function->memo = u8() != 0;
+
+            if (!body)
+                function->deferred = std::make_shared<Function::DeferredBody>(string());
+
+            result = function;
+            break;
+        }
+
+        case Tag::ReturnStatement:
+            result = std::make_shared<ReturnStatement>(node<Expression>());
+            break;
+
+        case Tag::Call:
+        {
+            auto function = node<Identifier>();
+            auto count = u32();
+
+            std::vector<std::shared_ptr<Expression>> arguments;
+
+            for (uint32_t i = 0; i < count; ++i)
+                arguments.push_back(node<Expression>());
+
+            result = std::make_shared<Call>(function, arguments);
+            break;
+        }
+
+        case Tag::Identifier:
+            result = std::make_shared<Identifier>(string());
+            break;
+
+        case Tag::Literal:
+        {
+            auto type = u8();
+
+            if (type > static_cast<uint8_t>(Literal::Type::String))
+                throw SerializationError("invalid literal type");
+
+            result = std::make_shared<Literal>(static_cast<Literal::Type>(type), string());
+            break;
+        }
+
+        case Tag::BinaryOperation:
+        {
+            auto left = node<Expression>();
+            auto operation = u8();
+
+            if (operation > static_cast<uint8_t>(BinaryOperator::Xor))
+                throw SerializationError("invalid binary operator");
+
+            auto right = node<Expression>();
+
+            result = std::make_shared<BinaryOperation>(left, static_cast<BinaryOperator>(operation), right);
+            break;
+        }
+
+        case Tag::UnaryOperation:
+        {
+            auto operation = u8();
+
+            if (operation > static_cast<uint8_t>(UnaryOperator::Unpack))
+                throw SerializationError("invalid unary operator");
+
+            result = std::make_shared<UnaryOperation>(static_cast<UnaryOperator>(operation), node<Expression>());
+            break;
+        }
+
+        case Tag::ConditionalStatement:
+        {
+            auto condition = node<Expression>();
+            auto then_case = node<StatementBlock>();
+            auto else_case = node<StatementBlock>(true);
+
+            result = std::make_shared<ConditionalStatement>(condition, then_case, else_case);
+            break;
+        }
+
+        case Tag::ConditionalLoop:
+        {
+            auto condition = node<Expression>();
+            auto body = node<StatementBlock>();
+
+            result = std::make_shared<ConditionalLoop>(condition, body);
+            break;
+        }
+
+        case Tag::RangeLoop:
+        {
+            auto counter = node<Identifier>();
+            auto begin = node<Expression>();
+            auto end = node<Expression>();
+            auto step = node<Expression>(true);
+            auto body = node<StatementBlock>();
+
+            result = std::make_shared<RangeLoop>(counter, begin, end, step, body);
+            break;
+        }
+
+        case Tag::ParallelLoop:
+        {
+            auto loop = node<RangeLoop>();
+            auto count = u32();
+
+            std::vector<ParallelLoop::Reduction> reductions;
+
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                auto type = u8();
+
+                if (type > static_cast<uint8_t>(ParallelLoop::Reduction::Type::Or))
+                    throw SerializationError("invalid reduction");
+
+                reductions.push_back({static_cast<ParallelLoop::Reduction::Type>(type), node<Identifier>()});
+            }
+
+            result = std::make_shared<ParallelLoop>(loop, reductions);
+            break;
+        }
+
+        case Tag::Spawn:
+            result = std::make_shared<Spawn>(node<Call>());
+            break;
+
+        case Tag::Join:
+            result = std::make_shared<Join>(node<Expression>());
+            break;
+
+        case Tag::ForEachLoop:
+        {
+            auto variable = node<Identifier>();
+            auto iterable = node<Expression>();
+            auto body = node<StatementBlock>();
+
+            result = std::make_shared<ForEachLoop>(variable, iterable, body);
+            break;
+        }
+
+        case Tag::MakeChannel:
+        {
+            auto type = node<Identifier>();
+            auto capacity = node<Expression>();
+
+            result = std::make_shared<MakeChannel>(type, capacity);
+            break;
+        }
+
+        case Tag::Receive:
+            result = std::make_shared<Receive>(node<Expression>());
+            break;
+
+        case Tag::SendStatement:
+        {
+            auto channel = node<Expression>();
+            auto value = node<Expression>();
+
+            result = std::make_shared<SendStatement>(channel, value);
+            break;
+        }
+
+        case Tag::CloseStatement:
+            result = std::make_shared<CloseStatement>(node<Expression>());
+            break;
+
+        case Tag::YieldStatement:
+            result = std::make_shared<YieldStatement>(node<Expression>());
+            break;
+
+        case Tag::ImportStatement:
+            result = std::make_shared<ImportStatement>(node<Identifier>());
+            break;
+
+        case Tag::PrintStatement:
+            result = std::make_shared<PrintStatement>(node<Expression>());
+            break;
+
+        case Tag::ReadStatement:
+            result = std::make_shared<ReadStatement>(node<Expression>());
+            break;
+
+        default:
+            throw SerializationError("invalid node tag");
+    }
+
+    --depth;
+
+    return result;
+}
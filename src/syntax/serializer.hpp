@@ -0,0 +1,105 @@
+#ifndef TOMATO_SERIALIZER_HPP
+#define TOMATO_SERIALIZER_HPP
+
+
+#include <string>
+#include <cstdint>
+#include <stdexcept>
+
+#include "visitor.hpp"
+#include "syntax_tree.hpp"
+
+
+namespace Tomato::Syntax
+{
+    class SerializationError : public std::runtime_error
+    {
+    public:
+        using runtime_error::runtime_error;
+    };
+
+
+    /**
+     * @brief Writes syntax tree in compact binary form.
+     *
+     * Every node is written as a one byte tag followed by its fields,
+     * missing optional children are written as a Null tag.
+     */
+    class Serializer : private Visitor
+    {
+    public:
+        explicit Serializer(std::string &buffer);
+
+        void serialize(ASTNode &tree);
+
+    private:
+        void process(Program               &node) override;
+        void process(ValueDeclaration      &node) override;
+        void process(Assignment            &node) override;
+        void process(Function              &node) override;
+        void process(ReturnStatement       &node) override;
+        void process(Call                  &node) override;
+        void process(InlinedCall           &node) override;
+        void process(Spawn                 &node) override;
+        void process(Join                  &node) override;
+        void process(MakeChannel           &node) override;
+        void process(Receive               &node) override;
+        void process(Identifier            &node) override;
+        void process(Literal               &node) override;
+        void process(BinaryOperation       &node) override;
+        void process(UnaryOperation        &node) override;
+        void process(ConditionalStatement  &node) override;
+        void process(ConditionalLoop       &node) override;
+        void process(RangeLoop             &node) override;
+        void process(ForEachLoop           &node) override;
+        void process(ParallelLoop          &node) override;
+        void process(PrintStatement        &node) override;
+        void process(ReadStatement         &node) override;
+        void process(SendStatement         &node) override;
+        void process(CloseStatement        &node) override;
+        void process(YieldStatement        &node) override;
+        void process(ImportStatement       &node) override;
+        void process(StatementBlock        &node) override;
+
+        void write(const std::shared_ptr<ASTNode> &node);
+        void write(const std::string &string);
+        void write(uint32_t value);
+        void write(uint8_t value);
+
+    private:
+        std::string &buffer;
+    };
+
+
+    /**
+     * @brief Reads syntax tree written by Serializer.
+     *
+     * Every read is bounds checked, malformed input causes SerializationError.
+     */
+    class Deserializer
+    {
+    public:
+        Deserializer(const char *data, size_t size);
+
+        std::shared_ptr<Program> program();
+
+    private:
+        std::shared_ptr<ASTNode> node();
+
+        template <typename T>
+        std::shared_ptr<T> node(bool optional = false);
+
+        std::string string();
+        uint32_t u32();
+        uint8_t u8();
+
+    private:
+        const char *data;
+        size_t size;
+        size_t offset = 0;
+        int depth = 0;
+    };
+}
+
+
+#endif //TOMATO_SERIALIZER_HPP
@@ -1,5 +1,7 @@
 #include "syntax_tree.hpp"
 
+#include "parser.hpp"
+
 
 using namespace Tomato::Syntax;
 
@@ -57,6 +59,28 @@ ConditionalLoop::ConditionalLoop(
         : condition(condition), body(body) {}
 
 
+RangeLoop::RangeLoop(
+        std::shared_ptr<Identifier> counter,
+        std::shared_ptr<Expression> begin,
+        std::shared_ptr<Expression> end,
+        std::shared_ptr<Expression> step,
+        std::shared_ptr<StatementBlock> body)
+        : counter(counter), begin(begin), end(end), step(step), body(body) {}
+
+
+ForEachLoop::ForEachLoop(
+        std::shared_ptr<Identifier> variable,
+        std::shared_ptr<Expression> iterable,
+        std::shared_ptr<StatementBlock> body)
+        : variable(variable), iterable(iterable), body(body) {}
+
+
+ParallelLoop::ParallelLoop(
+        std::shared_ptr<RangeLoop> loop,
+        const std::vector<ParallelLoop::Reduction> &reductions)
+        : loop(loop), reductions(reductions) {}
+
+
 Assignment::Assignment(
         std::shared_ptr<Expression> destination,
         std::shared_ptr<Expression> source)
@@ -75,9 +99,64 @@ Function::Function(
         std::shared_ptr<StatementBlock> body)
         : identifier(identifier), arguments(arguments), return_type(return_type), body(body) {}
 
+Function::DeferredBody::DeferredBody(std::string source) : source(std::move(source)) {}
+
+const std::shared_ptr<StatementBlock> &Function::definition() const
+{
+    if (!deferred || deferred->parsed.load(std::memory_order_acquire))
+        return deferred ? deferred->block : body;
+
+    std::lock_guard<std::mutex> lock(deferred->mutex);
+
+    if (!deferred->parsed.load(std::memory_order_relaxed))
+    {
+        try
+        {
+            deferred->block = Parser().function_body(deferred->source);
+        }
+        catch (SyntaxError &error)
+        {
+            throw SyntaxError("in function '" + identifier->name + "': " + error.what());
+        }
+
+        deferred->parsed.store(true, std::memory_order_release);
+    }
+
+    return deferred->block;
+}
+
 ReturnStatement::ReturnStatement(std::shared_ptr<Expression> expression) : expression(expression) {}
 
 Call::Call(
         std::shared_ptr<Identifier> function,
         const std::vector<std::shared_ptr<Expression>> &arguments)
         : function(function), arguments(arguments) {}
+
+InlinedCall::InlinedCall(
+        std::shared_ptr<Call> call,
+        std::shared_ptr<Function> function,
+        std::shared_ptr<StatementBlock> body,
+        std::shared_ptr<Expression> result)
+        : call(call), function(function), body(body), result(result) {}
+
+Spawn::Spawn(std::shared_ptr<Call> call) : call(call) {}
+
+Join::Join(std::shared_ptr<Expression> task) : task(task) {}
+
+MakeChannel::MakeChannel(
+        std::shared_ptr<Identifier> type,
+        std::shared_ptr<Expression> capacity)
+        : type(type), capacity(capacity) {}
+
+Receive::Receive(std::shared_ptr<Expression> channel) : channel(channel) {}
+
+SendStatement::SendStatement(
+        std::shared_ptr<Expression> channel,
+        std::shared_ptr<Expression> value)
+        : channel(channel), value(value) {}
+
+CloseStatement::CloseStatement(std::shared_ptr<Expression> channel) : channel(channel) {}
+
+YieldStatement::YieldStatement(std::shared_ptr<Expression> expression) : expression(expression) {}
+
+ImportStatement::ImportStatement(std::shared_ptr<Identifier> module) : module(module) {}
@@ -2,8 +2,10 @@
 #define TOMATO_SYNTAX_TREE_HPP
 
 
+#include <atomic>
 #include <string>
 #include <memory>
+#include <mutex>
 #include <vector>
 
 #include "visitor.hpp"
@@ -172,6 +174,61 @@ namespace Tomato::Syntax
         ACCEPT_VISITOR
     };
 
+    struct RangeLoop : Statement
+    {
+        RangeLoop(
+                std::shared_ptr<Identifier> counter,
+                std::shared_ptr<Expression> begin,
+                std::shared_ptr<Expression> end,
+                std::shared_ptr<Expression> step,
+                std::shared_ptr<StatementBlock> body
+        );
+
+        std::shared_ptr<Identifier> counter;
+        std::shared_ptr<Expression> begin;
+        std::shared_ptr<Expression> end;
+        std::shared_ptr<Expression> step;
+        std::shared_ptr<StatementBlock> body;
+
+        ACCEPT_VISITOR
+    };
+
+    struct ForEachLoop : Statement
+    {
+        ForEachLoop(
+                std::shared_ptr<Identifier> variable,
+                std::shared_ptr<Expression> iterable,
+                std::shared_ptr<StatementBlock> body
+        );
+
+        std::shared_ptr<Identifier> variable;
+        std::shared_ptr<Expression> iterable;
+        std::shared_ptr<StatementBlock> body;
+
+        ACCEPT_VISITOR
+    };
+
+    struct ParallelLoop : Statement
+    {
+        struct Reduction
+        {
+            enum class Type { Sum, Product, Min, Max, And, Or };
+
+            Type type;
+            std::shared_ptr<Identifier> variable;
+        };
+
+        ParallelLoop(
+                std::shared_ptr<RangeLoop> loop,
+                const std::vector<Reduction> &reductions
+        );
+
+        std::shared_ptr<RangeLoop> loop;
+        std::vector<Reduction> reductions;
+
+        ACCEPT_VISITOR
+    };
+
     struct PrintStatement : Statement
     {
         explicit PrintStatement(
@@ -216,10 +273,35 @@ namespace Tomato::Syntax
                 std::shared_ptr<StatementBlock> body
         );
 
+        /**
+         * @brief Source text of a body skipped by pre-parse up to its 'end', shared by copies of the function.
+         */
+        struct DeferredBody
+        {
+            explicit DeferredBody(std::string source);
+
+            const std::string source;
+
+            std::mutex mutex;
+            std::atomic<bool> parsed {false};
+            std::shared_ptr<StatementBlock> block;
+        };
+
+        /**
+         * @brief Function body, deferred body is parsed on the first request. Thread-safe.
+         * @throw SyntaxError Deferred body is malformed, reported on every request.
+         */
+        const std::shared_ptr<StatementBlock> & definition() const;
+
         std::shared_ptr<Identifier> identifier;
         std::vector<Argument> arguments;
         std::shared_ptr<Identifier> return_type;
-        std::shared_ptr<StatementBlock> body;
+        std::shared_ptr<StatementBlock> body;       ///< nullptr if body is deferred
+
+        std::shared_ptr<DeferredBody> deferred;
+
+        bool generator = false; ///< Body contains yield, call creates a generator instead of running it
+        bool memo = false;      ///< Results are cached by argument values, function must be pure
 
         ACCEPT_VISITOR
     };
@@ -245,6 +327,109 @@ namespace Tomato::Syntax
 
         ACCEPT_VISITOR
     };
+
+    /**
+     * @brief Call of a small function replaced by the function's body, see Optimizer::Inliner.
+     *
+     * Parameters are still bound and checked as for a call, but the callee isn't looked up
+     * and return doesn't unwind the interpreter.
+     */
+    struct InlinedCall : Expression
+    {
+        InlinedCall(
+                std::shared_ptr<Call> call,
+                std::shared_ptr<Function> function,
+                std::shared_ptr<StatementBlock> body,
+                std::shared_ptr<Expression> result
+        );
+
+        std::shared_ptr<Call> call;             ///< Original call, its arguments are evaluated as usual
+        std::shared_ptr<Function> function;     ///< Callee, declares parameters and return type
+        std::shared_ptr<StatementBlock> body;   ///< Statements before return, nullptr if there are none
+        std::shared_ptr<Expression> result;     ///< Returned expression, nullptr if function returns nothing
+
+        ACCEPT_VISITOR
+    };
+
+    struct Spawn : Expression
+    {
+        explicit Spawn(std::shared_ptr<Call> call);
+
+        std::shared_ptr<Call> call;
+
+        ACCEPT_VISITOR
+    };
+
+    struct Join : Expression
+    {
+        explicit Join(std::shared_ptr<Expression> task);
+
+        std::shared_ptr<Expression> task;
+
+        ACCEPT_VISITOR
+    };
+
+    struct MakeChannel : Expression
+    {
+        MakeChannel(
+                std::shared_ptr<Identifier> type,
+                std::shared_ptr<Expression> capacity
+        );
+
+        std::shared_ptr<Identifier> type;
+        std::shared_ptr<Expression> capacity;
+
+        ACCEPT_VISITOR
+    };
+
+    struct Receive : Expression
+    {
+        explicit Receive(std::shared_ptr<Expression> channel);
+
+        std::shared_ptr<Expression> channel;
+
+        ACCEPT_VISITOR
+    };
+
+    struct SendStatement : Statement
+    {
+        SendStatement(
+                std::shared_ptr<Expression> channel,
+                std::shared_ptr<Expression> value
+        );
+
+        std::shared_ptr<Expression> channel;
+        std::shared_ptr<Expression> value;
+
+        ACCEPT_VISITOR
+    };
+
+    struct YieldStatement : Statement
+    {
+        explicit YieldStatement(std::shared_ptr<Expression> expression);
+
+        std::shared_ptr<Expression> expression;
+
+        ACCEPT_VISITOR
+    };
+
+    struct CloseStatement : Statement
+    {
+        explicit CloseStatement(std::shared_ptr<Expression> channel);
+
+        std::shared_ptr<Expression> channel;
+
+        ACCEPT_VISITOR
+    };
+
+    struct ImportStatement : Statement
+    {
+        explicit ImportStatement(std::shared_ptr<Identifier> module);
+
+        std::shared_ptr<Identifier> module; ///< Dotted module name, e.g. 'geometry.shapes'
+
+        ACCEPT_VISITOR
+    };
 }
 
 
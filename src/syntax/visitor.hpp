@@ -16,6 +16,11 @@ namespace Tomato::Syntax
         virtual void process(struct Function              &node) = 0;
         virtual void process(struct ReturnStatement       &node) = 0;
         virtual void process(struct Call                  &node) = 0;
+        virtual void process(struct InlinedCall           &node) = 0;
+        virtual void process(struct Spawn                 &node) = 0;
+        virtual void process(struct Join                  &node) = 0;
+        virtual void process(struct MakeChannel           &node) = 0;
+        virtual void process(struct Receive               &node) = 0;
 
         virtual void process(struct Identifier            &node) = 0;
         virtual void process(struct Literal               &node) = 0;
@@ -24,9 +29,16 @@ namespace Tomato::Syntax
 
         virtual void process(struct ConditionalStatement  &node) = 0;
         virtual void process(struct ConditionalLoop       &node) = 0;
+        virtual void process(struct RangeLoop             &node) = 0;
+        virtual void process(struct ForEachLoop           &node) = 0;
+        virtual void process(struct ParallelLoop          &node) = 0;
 
         virtual void process(struct PrintStatement        &node) = 0;
         virtual void process(struct ReadStatement         &node) = 0;
+        virtual void process(struct SendStatement         &node) = 0;
+        virtual void process(struct CloseStatement        &node) = 0;
+        virtual void process(struct YieldStatement        &node) = 0;
+        virtual void process(struct ImportStatement       &node) = 0;
 
         virtual void process(struct StatementBlock        &node) = 0;
     };
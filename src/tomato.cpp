@@ -1,33 +1,302 @@
 #include <iostream>
 #include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <future>
+#include <filesystem>
+
+#include <unistd.h>
+
 #include "interpreter/interpreter.hpp"
+#include "syntax/parser.hpp"
+#include "ir/emit_c.hpp"
+#include "ir/lowering.hpp"
+#include "ir/passes.hpp"
 
 
-int main(int argc, char **argv)
+static void usage()
+{
+    std::cout << "Usage:\n\n"
+              << "    tomato [options] [file...]\n\n"
+              << "If file is provided it will be interpreted, otherwise interpreter will start interactive session,\n"
+              << "or execute program streamed to standard input if it is not a terminal.\n"
+              << "Several files are interpreted independently as a batch, their input is empty and\n"
+              << "their output is printed in order of arguments.\n\n"
+              << "Options:\n\n"
+              << "    --jobs N      interpret up to N files of a batch in parallel\n"
+              << "    --no-cache    don't use on-disk cache of compiled programs\n"
+              << "    --lazy        parse function bodies on their first call\n"
+              << "    --memo        cache results of all pure functions, not only of 'memo' ones\n"
+              << "    --stats       print execution statistics to standard error\n"
+              << "    --no-inline   don't inline calls of small functions\n"
+              << "    --closures    run closures compiled from the syntax tree instead of visiting it\n"
+              << "    --print-tree  print program as it is executed, after inlining, instead of running it\n"
+              << "    --dump-ir     print optimized intermediate representation of program instead of running it\n"
+              << "    --emit-c      print program translated to C instead of running it\n";
+}
+
+
+struct Options
+{
+    bool use_cache = true;
+    bool lazy = false;
+    bool memo = false;
+    bool stats = false;
+    bool inline_functions = true;
+    bool closures = false;
+    bool print_tree = false;
+    bool dump_ir = false;
+    bool emit_c = false;
+};
+
+
+static void configure(Tomato::Interpreter &interpreter, const Options &options)
+{
+    if (options.use_cache)
+        interpreter.enable_cache(Tomato::CompilationCache::default_directory());
+
+    interpreter.defer_function_bodies(options.lazy);
+    interpreter.memoize_pure_functions(options.memo);
+    interpreter.inline_functions(options.inline_functions);
+
+    // the engine may also be chosen by environment
+    if (options.closures)
+        interpreter.compile_closures(true);
+}
+
+
+static void report(const Tomato::Interpreter &interpreter, const Options &options)
+{
+    if (!options.stats)
+        return;
+
+    // single write, so reports of batch files don't interleave
+    std::ostringstream stats;
+    interpreter.print_stats(stats);
+    std::clog << stats.str() << std::flush;
+}
+
+
+static bool interpret(const std::string &path, std::istream &input, std::ostream &output, const Options &options)
 {
-    if (argc == 1)
+    std::ifstream file(path);
+
+    if (!file.is_open())
     {
-        Tomato::Interpreter interpreter(std::cin, std::cout);
-        interpreter.run();
+        std::clog << "Can't open file '" << path << '\'' << std::endl;
+        return false;
     }
-    else if (argc == 2)
+
+    Tomato::Interpreter interpreter(input, output);
+    configure(interpreter, options);
+
+    // modules next to the script are found first
+    auto directory = std::filesystem::path(path).parent_path();
+    interpreter.add_module_path(directory.empty() ? "." : directory.string());
+
+    interpreter.interpret(file);
+    report(interpreter, options);
+
+    return true;
+}
+
+
+static void print_tree(std::istream &source, const Options &options)
+{
+    try
+    {
+        Tomato::CompiledProgram::compile(source, nullptr, options.lazy, options.inline_functions)->print(std::cout);
+    }
+    catch (Tomato::Syntax::SyntaxError &error)
+    {
+        std::clog << "syntax error: " << error.what() << std::endl;
+    }
+}
+
+
+static void translate(std::istream &source, const Options &options)
+{
+    try
+    {
+        std::stringstream text;
+        text << source.rdbuf();
+
+        Tomato::Syntax::Parser parser;
+        parser.set_text(text.str());
+
+        Tomato::Syntax::Program program;
+        parser.parse_program(program);
+
+        auto module = Tomato::IR::lower(program);
+
+        Tomato::IR::optimize(module);
+
+        if (options.emit_c)
+            Tomato::IR::emit_c(module, std::cout);
+        else
+            Tomato::IR::dump(module, std::cout);
+    }
+    catch (Tomato::Syntax::SyntaxError &error)
+    {
+        std::clog << "syntax error: " << error.what() << std::endl;
+    }
+    catch (Tomato::IR::LoweringError &error)
+    {
+        std::clog << "can't lower program: " << error.what() << std::endl;
+    }
+}
+
+
+static void batch(const std::vector<std::string> &files, unsigned jobs, const Options &options)
+{
+    std::vector<std::promise<std::string>> outputs(files.size());
+    std::atomic<size_t> next {0};
+
+    auto worker = [&] {
+        for (size_t i = next++; i < files.size(); i = next++)
+        {
+            std::istringstream input;
+            std::ostringstream output;
+
+            interpret(files[i], input, output, options);
+
+            outputs[i].set_value(output.str());
+        }
+    };
+
+    std::vector<std::thread> threads;
+
+    for (unsigned i = 0; i < std::min<size_t>(jobs, files.size()); ++i)
+        threads.emplace_back(worker);
+
+    for (auto &output : outputs)
+        std::cout << output.get_future().get() << std::flush;
+
+    for (auto &thread : threads)
+        thread.join();
+}
+
+
+int main(int argc, char **argv)
+{
+    std::vector<std::string> files;
+    Options options;
+    unsigned jobs = 1;
+
+    for (int i = 1; i < argc; ++i)
     {
-        std::ifstream file(argv[1]);
+        std::string arg = argv[i];
 
-        if (!file.is_open())
+        if (arg == "--no-cache")
+        {
+            options.use_cache = false;
+        }
+        else if (arg == "--lazy")
+        {
+            options.lazy = true;
+        }
+        else if (arg == "--memo")
+        {
+            options.memo = true;
+        }
+        else if (arg == "--stats")
         {
-            std::clog << "Can't open file '" << argv[1] << '\'' << std::endl;
+            options.stats = true;
+        }
+        else if (arg == "--no-inline")
+        {
+            options.inline_functions = false;
+        }
+        else if (arg == "--closures")
+        {
+            options.closures = true;
+        }
+        else if (arg == "--print-tree")
+        {
+            options.print_tree = true;
+        }
+        else if (arg == "--dump-ir")
+        {
+            options.dump_ir = true;
+        }
+        else if (arg == "--emit-c")
+        {
+            options.emit_c = true;
+        }
+        else if (arg == "--jobs" && i + 1 < argc)
+        {
+            try
+            {
+                jobs = static_cast<unsigned>(std::max(1, std::stoi(argv[++i])));
+            }
+            catch (std::exception &)
+            {
+                usage();
+                return 0;
+            }
+        }
+        else if (arg.size() > 1 && arg[0] == '-')
+        {
+            usage();
             return 0;
         }
+        else
+        {
+            files.push_back(arg);
+        }
+    }
+
+    if (options.print_tree || options.dump_ir || options.emit_c)
+    {
+        auto print = [&] (std::istream &source) {
+            if (options.dump_ir || options.emit_c)
+                translate(source, options);
+            else
+                print_tree(source, options);
+        };
+
+        if (files.empty())
+            print(std::cin);
+
+        for (auto &path : files)
+        {
+            std::ifstream file(path);
+
+            if (file.is_open())
+                print(file);
+            else
+                std::clog << "Can't open file '" << path << '\'' << std::endl;
+        }
+    }
+    else if (files.empty() && !isatty(STDIN_FILENO))
+    {
+        // program and its input share stdin, no readline, so C++ streams may do their own buffering
+        std::ios::sync_with_stdio(false);
 
         Tomato::Interpreter interpreter(std::cin, std::cout);
-        interpreter.interpret(file);
+        configure(interpreter, options);
+
+        interpreter.interpret_stream(std::cin);
+        report(interpreter, options);
+    }
+    else if (files.empty())
+    {
+        Tomato::Interpreter interpreter(std::cin, std::cout);
+        configure(interpreter, options);
+
+        interpreter.run();
+        report(interpreter, options);
+    }
+    else if (files.size() == 1)
+    {
+        interpret(files[0], std::cin, std::cout, options);
     }
     else
     {
-        std::cout << "Usage:\n\n"
-                  << "    tomato [file]\n\n"
-                  << "If file is provided it will be interpreted, otherwise interpreter will start interactive session";
+        batch(files, jobs, options);
     }
 
     return 0;
@@ -0,0 +1,159 @@
+#include <gtest/gtest.h>
+#include <interpreter/interpreter.hpp>
+#include <ir/emit_c.hpp>
+#include <ir/lowering.hpp>
+#include <ir/passes.hpp>
+#include <syntax/parser.hpp>
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+
+#include <unistd.h>
+
+
+using namespace std::string_literals;
+using namespace Tomato;
+
+
+static std::string Interpret(const std::string &source, const std::string &input)
+{
+    std::stringstream file(source), istream(input), ostream;
+
+    Interpreter interpreter(istream, ostream);
+    interpreter.interpret(file);
+
+    return ostream.str();
+}
+
+
+/**
+ * Translate source to C, build it with the C compiler of the build and run it.
+ */
+static std::string Compile(const std::string &source, const std::string &input)
+{
+    Syntax::Parser parser;
+    parser.set_text(source);
+
+    Syntax::Program program;
+    parser.parse_program(program);
+
+    auto module = IR::lower(program);
+    IR::optimize(module);
+
+    auto directory = std::filesystem::temp_directory_path() / ("tomato_emit_c_" + std::to_string(::getpid()));
+    std::filesystem::create_directories(directory);
+
+    std::ofstream(directory / "program.c") << [&] {
+        std::stringstream code;
+        IR::emit_c(module, code);
+        return code.str();
+    }();
+
+    std::ofstream(directory / "input") << input;
+
+    auto path = [&] (const char *name) { return "'" + (directory / name).string() + "'"; };
+
+    std::string build = TOMATO_C_COMPILER " -std=c99 -O2 -o "s + path("program") + " " + path("program.c") + " -lm";
+    std::string run = path("program") + " < " + path("input") + " > " + path("output");
+
+    if (std::system(build.c_str()) != 0 || std::system(run.c_str()) != 0)
+        return "failed to build or run " + path("program.c");
+
+    std::ifstream output(directory / "output");
+    std::string text(std::istreambuf_iterator<char>(output), {});
+
+    std::filesystem::remove_all(directory);
+
+    return text;
+}
+
+
+TEST(EmitCTest, Programs)
+{
+    // input of programs which read it
+    std::map<std::string, std::string> inputs = {
+            {"equation.tm", "1 -3 2\n"},
+            {"fact.tm", "10\n"},
+            {"fib.tm", "1 2 10 25 0\n"},
+    };
+
+    std::vector<std::pair<std::string, std::string>> programs;
+
+    for (auto directory : {"examples", "perf/corpus"})
+    {
+        for (auto &entry : std::filesystem::directory_iterator(TOMATO_SOURCE_DIR "/"s + directory))
+        {
+            if (entry.path().extension() != ".tm")
+                continue;
+
+            std::ifstream file(entry.path()), input(std::filesystem::path(entry.path()).replace_extension(".in"));
+            std::string source(std::istreambuf_iterator<char>(file), {});
+
+            programs.emplace_back(source, input ? std::string(std::istreambuf_iterator<char>(input), {})
+                                                : inputs[entry.path().filename().string()]);
+        }
+    }
+
+    for (auto &[source, input] : programs)
+        ASSERT_EQ(Compile(source, input), Interpret(source, input)) << source;
+}
+
+
+TEST(EmitCTest, Semantics)
+{
+    std::vector<std::pair<std::string, std::string>> programs = {
+            // int arithmetic wraps, int division gives float, power is the interpreter's one
+            {"var big = 2147483647\nprint big + 1\nprint big * big\nprint 7 / 2\nprint 1 / 3\nprint 0 - 7 % 3\n"
+             "var e int\nread e\nprint 3 ^ e\nprint 2 ^ 31\nprint 5 ^ (0 - 1)\nprint 2.0 ^ 0.5\nprint e ^ 1.5\n", "20\n"},
+
+            // floats are printed with 6 significant digits
+            {"var x float\nread x\nprint x\nprint x * 1000000\nprint x / 0\nprint 0 - x / 0\nprint 1 < x\nprint x + 1 == 1.1\n", "0.1\n"},
+
+            // chars wrap around, bools are printed as words
+            {"var c char\nread c\nprint c + 1\nprint 1 + c\nprint c - 33\nprint true xor false\nprint 1 >= 1.0\n", "~\n"},
+
+            // loops, ranges with negative and unknown step, calls
+            {"func gcd(a int, b int) -> int\n"
+             "    while b != 0 do\n"
+             "        var t = b\n"
+             "        b = a % b\n"
+             "        a = t\n"
+             "    end\n"
+             "    return a\n"
+             "end\n"
+             "var s int\nread s\n"
+             "for i in 2147483640..2147483647 step s do print i end\n"
+             "for i in 10..0 step 0 - 3 do print gcd(i, 12) end\n", "3\n"},
+
+            // 'and' and 'or' evaluate the right operand only when it decides
+            {"func t(x int) -> bool\n    print x\n    return true\nend\n"
+             "func f(x int) -> bool\n    print x\n    return false\nend\n"
+             "var a bool\nread a\n"
+             "print a and t(1)\nprint a or f(2)\nprint f(3) or a and t(4)\n"
+             "var i = 0\nwhile i < 3 and (a or t(i)) do i = i + 1 end\n"
+             "print (a and 1) or true\n", "0"},
+
+            // failed read keeps the value and all following reads fail
+            {"var i = 5\nvar f = 1.5\nvar b = true\nvar c = 'x'\n"
+             "read i\nread f\nread b\nread c\nprint i\nprint f\nprint b\nprint c\n"
+             "read i\nread c\nprint i\nprint c\n", "42 2.5e1 0 q 99999999999 z"},
+
+            {"var a = 1\nvar b = 2.0\nread a\nread b\nprint a\nprint b\n", "- 7"},
+            {"var b = true\nread b\nprint b\nread b\nprint b\n", "7 1"},
+            {"var b = false\nvar x = 3.0\nread x\nprint x\nread b\nprint b\n", "1e99 1"},
+
+            // runtime errors stop the program
+            {"print 1\nvar x = 1\nx = 2.0\nprint 2\n", ""},
+            {"func f(n int) -> int\n    if n > 0 then return n end\nend\nprint f(1)\nprint f(0)\n", ""},
+            {"var s int\nread s\nfor i in 0..10 step s do print i end\n", "0"},
+    };
+
+    for (auto &[source, input] : programs)
+        ASSERT_EQ(Compile(source, input), Interpret(source, input)) << source;
+
+    // remainder by zero is reported after the output before it, constant zero is never folded into C
+    ASSERT_EQ(Compile("print 1\nprint 7 % 0\nprint 2\n", ""), "1\nsemantic error: division by zero\n"s);
+    ASSERT_EQ(Compile("var d int\nread d\nprint 9 % d\nprint 7 % (d - 1)\n", "1"), "0\nsemantic error: division by zero\n"s);
+    ASSERT_EQ(Compile("var d int\nread d\nprint (0 - 2147483647 - 1) % d\n", "-1"), "0\n"s);
+}
@@ -1,20 +1,750 @@
 #include <gtest/gtest.h>
 #include <interpreter/interpreter.hpp>
+#include <syntax/parser.hpp>
+#include <syntax/serializer.hpp>
+
+#include <thread>
+#include <fstream>
+#include <filesystem>
 
 
 using namespace std::string_literals;
 using namespace Tomato;
 
 
+static std::string Execute(const CompiledProgram &program, const std::string &input = "")
+{
+    std::stringstream istream(input), ostream;
+
+    Interpreter interpreter(istream, ostream);
+    interpreter.execute(program);
+
+    return ostream.str();
+}
+
+
 TEST(InterpreterTest, GeneralTest)
 {
-    /*std::stringstream buffer;
+    auto program = CompiledProgram::compile("print 2 + 2 * 2\n"s);
+
+    ASSERT_EQ(Execute(*program), "6\n"s);
+}
+
+
+TEST(InterpreterTest, CompileOnceRunMany)
+{
+    auto program = CompiledProgram::compile(
+            "func factorial(n int) -> int\n"
+            "    if n > 1 then return n * factorial(n - 1) else return 1 end\n"
+            "end\n"
+            "var n int\n"
+            "read n\n"
+            "print factorial(n)\n"s);
+
+    ASSERT_EQ(Execute(*program, "5"), "120\n"s);
+    ASSERT_EQ(Execute(*program, "6"), "720\n"s);
+    ASSERT_EQ(Execute(*program, "1"), "1\n"s);
+}
+
+
+TEST(InterpreterTest, Errors)
+{
+    ASSERT_THROW(CompiledProgram::compile("print 2 +"s), Syntax::SyntaxError);
+
+    auto program = CompiledProgram::compile("print x"s);
+    ASSERT_THROW(Execute(*program), Semantic::SemanticError);
+
+    std::stringstream istream, ostream, file("print 1\nprint y\nprint 2\n");
+    Interpreter interpreter(istream, ostream);
+    interpreter.interpret(file);
+
+    ASSERT_EQ(ostream.str(), "1\nsemantic error: undefined reference to 'y'\n"s);
+}
+
+
+TEST(InterpreterTest, ParallelInstances)
+{
+    auto program = CompiledProgram::compile(
+            "func fib(n int) -> int\n"
+            "    if n < 2 then return n else return fib(n - 1) + fib(n - 2) end\n"
+            "end\n"
+            "var n int\n"
+            "read n\n"
+            "var i = 0\n"
+            "while i < 20 do\n"
+            "    let x = fib(n)\n"
+            "    i = i + 1\n"
+            "end\n"
+            "print fib(n)\n"s);
+
+    const int count = 8;
+    const int expected[count] = {0, 1, 1, 2, 3, 5, 8, 13};
+
+    std::vector<std::string> outputs(count);
+    std::vector<std::thread> threads;
+
+    for (int i = 0; i < count; ++i)
+    {
+        threads.emplace_back([&, i] {
+            outputs[i] = Execute(*program, std::to_string(i));
+        });
+    }
+
+    for (auto &thread : threads)
+        thread.join();
+
+    for (int i = 0; i < count; ++i)
+        ASSERT_EQ(outputs[i], std::to_string(expected[i]) + "\n");
+}
+
+
+TEST(InterpreterTest, RangeLoop)
+{
+    auto program = CompiledProgram::compile(
+            "var total = 0\n"
+            "for i in 0..5 do total = total + i end\n"
+            "print total\n"
+            "for i in 10..1 step 0 - 4 do print i end\n"
+            "for i in 3..3 do print i end\n"
+            "for i in 0..10 step 5 do for j in i..i+2 do print j end end\n"s);
+
+    ASSERT_EQ(Execute(*program), "10\n10\n6\n2\n0\n1\n5\n6\n"s);
+
+    ASSERT_THROW(Execute(*CompiledProgram::compile("for i in 0..3 do i = 1 end"s)), Semantic::SemanticError);
+    ASSERT_THROW(Execute(*CompiledProgram::compile("for i in 0..3 step 0 do end"s)), Semantic::SemanticError);
+    ASSERT_THROW(Execute(*CompiledProgram::compile("for i in 0..3.5 do end"s)), Semantic::SemanticError);
+    ASSERT_THROW(Execute(*CompiledProgram::compile("for i in 0..3 do end\nprint i"s)), Semantic::SemanticError);
+}
+
+
+TEST(InterpreterTest, ParallelLoop)
+{
+    auto program = CompiledProgram::compile(
+            "func square(n int) -> int return n * n end\n"
+            "var sum = 0\n"
+            "var total = 0.0\n"
+            "var low = 1000\n"
+            "var high = 0\n"
+            "var positive = true\n"
+            "parallel for i in 0..1000 reduce + sum, + total, min low, max high, and positive do\n"
+            "    sum = sum + square(i)\n"
+            "    total = total + 0.1\n"
+            "    if i < low then low = i end\n"
+            "    if i > high then high = i end\n"
+            "    positive = positive and i >= 0\n"
+            "end\n"
+            "print sum\n"
+            "print low\n"
+            "print high\n"
+            "print positive\n"
+            "print total\n"
+            "parallel for i in 0..0 reduce * sum do sum = 0 end\n"
+            "print sum\n"s);
+
+    auto expected = Execute(*program);
+
+    ASSERT_EQ(expected.substr(0, expected.find("true\n") + 5), "332833500\n0\n999\ntrue\n"s);
+
+    // Merge order doesn't depend on scheduling, so even float sums are reproducible
+    for (int i = 0; i < 10; ++i)
+        ASSERT_EQ(Execute(*program), expected);
+
+    ASSERT_THROW(Execute(*CompiledProgram::compile("var x = 0\nparallel for i in 0..3 do x = i end"s)), Semantic::SemanticError);
+    ASSERT_THROW(Execute(*CompiledProgram::compile("parallel for i in 0..3 do print i end"s)), Semantic::SemanticError);
+    ASSERT_THROW(Execute(*CompiledProgram::compile("let c = 0\nparallel for i in 0..3 reduce + c do end"s)), Semantic::SemanticError);
+    ASSERT_THROW(Execute(*CompiledProgram::compile("var b = 0\nparallel for i in 0..3 reduce or b do end"s)), Semantic::SemanticError);
+    ASSERT_THROW(Execute(*CompiledProgram::compile(
+            "var x = 0\n"
+            "func f() x = 1 end\n"
+            "parallel for i in 0..3 do f() end"s)), Semantic::SemanticError);
+}
+
+
+TEST(InterpreterTest, SpawnJoin)
+{
+    auto program = CompiledProgram::compile(
+            "func fib(n int) -> int\n"
+            "    if n < 2 then return n end\n"
+            "    let left = spawn fib(n - 1)\n"
+            "    let right = fib(n - 2)\n"
+            "    return join left + right\n"
+            "end\n"
+            "print fib(15)\n"
+            "var base = 10\n"
+            "func add(x int) -> int return x + base end\n"
+            "let handle = spawn add(5)\n"
+            "base = 100\n"
+            "print join handle\n"
+            "print join handle\n"s);
+
+    // Task sees values at the moment of spawn
+    ASSERT_EQ(Execute(*program), "610\n15\n15\n"s);
+
+    ASSERT_EQ(Execute(*CompiledProgram::compile("func f() print 1 end\nlet t = spawn f()\nlet r = join t"s)), "1\n"s);
+    ASSERT_THROW(Execute(*CompiledProgram::compile("var x = 0\nfunc f() x = 1 end\nlet t = spawn f()"s)), Semantic::SemanticError);
+    ASSERT_THROW(Execute(*CompiledProgram::compile("print join 5"s)), Semantic::SemanticError);
+    ASSERT_THROW(Execute(*CompiledProgram::compile("func f() -> int return 1.5 end\nprint join spawn f()"s)), Semantic::SemanticError);
+}
+
+
+TEST(InterpreterTest, Channels)
+{
+    auto program = CompiledProgram::compile(
+            "func produce(output channel, n int)\n"
+            "    for i in 0..n do send output, i end\n"
+            "    close output\n"
+            "end\n"
+            "func square(input channel, output channel)\n"
+            "    for x in input do send output, x * x end\n"
+            "    close output\n"
+            "end\n"
+            "func show(input channel)\n"
+            "    for x in input do print x end\n"
+            "end\n"
+            "let numbers = channel(int, 1)\n"
+            "let squares = channel(int, 2)\n"
+            "let printer = spawn show(squares)\n"
+            "let transform = spawn square(numbers, squares)\n"
+            "let producer = spawn produce(numbers, 5)\n"
+            "let done = join printer\n"
+            "let c = channel(char, 4)\n"
+            "send c, 'a'\n"
+            "send c, 'b'\n"
+            "close c\n"
+            "print recv c\n"
+            "for x in c do print x end\n"s);
+
+    // Channels keep order, so a pipeline with one stage per thread is deterministic
+    for (int i = 0; i < 5; ++i)
+        ASSERT_EQ(Execute(*program), "0\n1\n4\n9\n16\na\nb\n"s);
+
+    ASSERT_THROW(Execute(*CompiledProgram::compile("let c = channel(int, 1)\nsend c, 1.5"s)), Semantic::SemanticError);
+    ASSERT_THROW(Execute(*CompiledProgram::compile("let c = channel(int, 1)\nclose c\nsend c, 1"s)), Semantic::SemanticError);
+    ASSERT_THROW(Execute(*CompiledProgram::compile("let c = channel(int, 1)\nclose c\nprint recv c"s)), Semantic::SemanticError);
+    ASSERT_THROW(Execute(*CompiledProgram::compile("let c = channel(int, 0)"s)), Semantic::SemanticError);
+    ASSERT_THROW(Execute(*CompiledProgram::compile("for x in 5 do end"s)), Semantic::SemanticError);
+}
+
+
+TEST(InterpreterTest, Generators)
+{
+    auto program = CompiledProgram::compile(
+            "func numbers(n int)\n"
+            "    var i = 0\n"
+            "    while i < n do\n"
+            "        yield i\n"
+            "        i = i + 1\n"
+            "    end\n"
+            "end\n"
+            "func odd(source generator) -> generator\n"
+            "    for x in source do\n"
+            "        if x % 2 == 1 then yield x end\n"
+            "    end\n"
+            "end\n"
+            "for x in odd(numbers(8)) do print x end\n"
+            "let g = numbers(2)\n"
+            "for x in g do print x end\n"
+            "for x in g do print x end\n"
+            "var total = 0\n"
+            "for x in numbers(100000) do total = total + x % 3 end\n"
+            "print total\n"s);
+
+    ASSERT_EQ(Execute(*program), "1\n3\n5\n7\n0\n1\n99999\n"s);
+
+    // generator made by a task is iterated after the task and its context are gone
+    ASSERT_EQ(Execute(*CompiledProgram::compile(
+            "func scale() -> int return 10 end\n"
+            "func make(n int) for i in 0..n do yield i * scale() + k end end\n"
+            "let k = 1\nlet g = join spawn make(3)\nfor x in g do print x end\n"s)), "1\n11\n21\n"s);
+
+    // generator is resumed by one thread only, parallel chunks and tasks get their own
+    auto numbers = "func numbers(n int) for i in 0..n do yield i end end\n"
+                   "func sum(s generator) -> int var t = 0\nfor x in s do t = t + x end\nreturn t end\n"s;
+
+    ASSERT_EQ(Execute(*CompiledProgram::compile(numbers + "print join spawn sum(numbers(10))\n")), "45\n"s);
+    ASSERT_EQ(Execute(*CompiledProgram::compile(numbers +
+            "var t = 0\nparallel for i in 0..4 reduce + t do t = t + sum(numbers(i)) end\nprint t\n")), "4\n"s);
+
+    ASSERT_THROW(Execute(*CompiledProgram::compile(numbers +
+            "let g = numbers(10)\nvar t = 0\nparallel for i in 0..4 reduce + t do for x in g do t = t + x end end\n")),
+            Semantic::SemanticError);
+    ASSERT_THROW(Execute(*CompiledProgram::compile(numbers + "let g = numbers(10)\nlet h = spawn sum(g)\n")),
+            Semantic::SemanticError);
+    ASSERT_THROW(Execute(*CompiledProgram::compile(numbers +
+            "func total() -> int return sum(g) end\nlet g = numbers(10)\nlet h = spawn total()\n")),
+            Semantic::SemanticError);
+
+    ASSERT_THROW(CompiledProgram::compile("yield 1"s), Syntax::SyntaxError);
+    ASSERT_THROW(Execute(*CompiledProgram::compile("func g() -> int yield 1 end\nlet x = g()"s)), Semantic::SemanticError);
+    ASSERT_THROW(Execute(*CompiledProgram::compile(
+            "func g() yield 1\nreturn 2 end\nfor x in g() do end"s)), Semantic::SemanticError);
+}
+
+
+TEST(InterpreterTest, DeferredBodies)
+{
+    auto source = "func fib(n int) -> int\n"
+                  "    if n < 2 then return n end\n"
+                  "    return fib(n - 1) + fib(n - 2)\n"
+                  "end\n"
+                  "func broken() print + end\n"
+                  "func count(n int) for i in 0..n do yield i end end\n"
+                  "for i in count(3) do print fib(i + 5) end\n"s;
+
+    auto fixed = source;
+    fixed.replace(fixed.find("print +"), 7, "print 1");
+
+    auto eager = CompiledProgram::compile(fixed);
+    auto deferred = CompiledProgram::compile(source, nullptr, true);
+
+    ASSERT_THROW(CompiledProgram::compile(source), Syntax::SyntaxError);
+    ASSERT_EQ(Execute(*deferred), Execute(*eager));
+    ASSERT_EQ(Execute(*deferred), "5\n8\n13\n"s);
+
+    std::stringstream istream, ostream;
+    Interpreter interpreter(istream, ostream);
+
+    ASSERT_THROW(interpreter.execute(*CompiledProgram::compile(source + "broken()"s, nullptr, true)), Syntax::SyntaxError);
+}
+
+
+TEST(InterpreterTest, ParallelParsing)
+{
+    std::string source;
+    int count = 0;
+
+    for (; source.size() < 600 * 1024; ++count)
+    {
+        auto name = "f" + std::to_string(count);
+
+        source += "func " + name + "(n int) -> int\n"
+                  "    if n > 0 then return n * " + std::to_string(count) + " end\n"
+                  "    func inner() print \"end func\" end\n"
+                  "    for k in 0..n do print 'e' end\n"
+                  "    return 0\n"
+                  "end\n"
+                  "print " + name + "(1)\n";
+    }
+
+    auto serialize = [] (Syntax::Program &program) {
+        std::string bytes;
+        Syntax::Serializer(bytes).serialize(program);
+        return bytes;
+    };
+
+    auto sequential = [] (const std::string &text, Syntax::Program &program) {
+        Syntax::Parser parser;
+        parser.defer_function_bodies(true);
+        parser.set_text(text);
+        parser.parse_program(program);
+    };
+
+    Syntax::Program expected;
+    sequential(source, expected);
+
+    auto program = CompiledProgram::compile(source, nullptr, true);
+
+    ASSERT_EQ(serialize(const_cast<Syntax::Program &>(program->tree())), serialize(expected));
+
+    // broken statement right before a function, diagnostics must not depend on the split
+    for (auto broken : {"print "s, "func g() print 1\n"s, "end\n"s})
+    {
+        auto malformed = source;
+        malformed.insert(malformed.find("func f" + std::to_string(count * 3 / 4) + "("), broken);
+
+        Syntax::Program partial;
+        std::string message;
+
+        try
+        {
+            sequential(malformed, partial);
+        }
+        catch (Syntax::SyntaxError &error)
+        {
+            message = error.what();
+        }
+
+        ASSERT_FALSE(message.empty());
+
+        try
+        {
+            CompiledProgram::compile(malformed, nullptr, true);
+            FAIL();
+        }
+        catch (Syntax::SyntaxError &error)
+        {
+            ASSERT_EQ(error.what(), message);
+        }
+    }
+}
+
+
+TEST(InterpreterTest, Streaming)
+{
+    std::stringstream stream(
+            "func twice(x int) -> int\n"
+            "    return (x +\n"
+            "        x)\n"
+            "end\n"
+            "var n int\n"
+            "read n\n"
+            "21\n"
+            "print twice(n) +\n"
+            "    1 print n\n"
+            "print n +\n"
+            "print 0\n"), output;
+
+    Interpreter interpreter(stream, output);
+    interpreter.interpret_stream(stream);
+
+    ASSERT_EQ(output.str(), "43\n21\nsyntax error: expression expected, got <print> instead\n"s);
+}
+
+
+TEST(InterpreterTest, Memoization)
+{
+    auto program = CompiledProgram::compile(
+            "memo func fib(n int) -> int\n"
+            "    if n < 2 then return n end\n"
+            "    return fib(n - 1) + fib(n - 2)\n"
+            "end\n"
+            "func inc(x int) -> int return x + 1 end\n"
+            "memo func next(x int) -> int return inc(x) end\n"
+            "print fib(40)\n"
+            "print next(1)\n"
+            "if true then\n"
+            "    func inc(x int) -> int return x + 2 end\n"
+            "    print next(1)\n"
+            "end\n"
+            "print next(1)\n"s);
+
+    std::stringstream istream, ostream, stats;
+
+    Interpreter interpreter(istream, ostream);
+    interpreter.execute(*program);
+    interpreter.print_stats(stats);
+
+    // once callee is shadowed, results depend on scope and are not cached anymore
+    ASSERT_EQ(ostream.str(), "102334155\n2\n3\n2\n"s);
+    ASSERT_EQ(stats.str(), "memo fib: 79 calls, 38 hits (48.1%)\nmemo next: 1 calls, 0 hits (0.0%)\n"s);
+
+    for (auto impure : {
+            "memo func f(x int) -> int print x return x end print f(1)"s,
+            "var y = 1 memo func f(x int) -> int return x + y end print f(1)"s,
+            "var y = 1 memo func f(x int) -> int y = x return x end print f(1)"s,
+            "memo func f(x int) yield x end for i in f(1) do end"s,
+    })
+    {
+        ASSERT_THROW(Execute(*CompiledProgram::compile(impure)), Semantic::SemanticError);
+    }
+
+    // with the flag pure functions are memoized without annotation, the others run as usual,
+    // inlined calls are not calls anymore
+    program = CompiledProgram::compile(
+            "func square(x int) -> int return x * x end\n"
+            "func show(x int) -> int print x return x end\n"
+            "for i in 0..4 do print square(i % 2) + show(i) end\n"s, nullptr, false, false);
+
+    std::stringstream output;
+    stats.str("");
+
+    Interpreter memoizing(istream, output);
+    memoizing.memoize_pure_functions(true);
+    memoizing.execute(*program);
+    memoizing.print_stats(stats);
+
+    ASSERT_EQ(output.str(), "0\n0\n1\n2\n2\n2\n3\n4\n"s);
+    ASSERT_EQ(stats.str(), "memo square: 4 calls, 2 hits (50.0%)\n"s);
+}
+
+
+TEST(InterpreterTest, Modules)
+{
+    auto directory = std::filesystem::temp_directory_path() / "tomato_modules_test";
+    std::filesystem::create_directories(directory / "shapes");
+
+    std::ofstream(directory / "numeric.tm")
+            << "print 'l'\n"
+            << "let unit = 1\n"
+            << "func square(x int) -> int return x * x end\n"
+            << "func cube(x int) -> int return x * square(x) end\n";
+
+    std::ofstream(directory / "shapes" / "box.tm")
+            << "import numeric\n"
+            << "func volume(side int) -> int return cube(side) + unit - 1 end\n";
+
+    auto program = CompiledProgram::compile(
+            "import shapes.box\n"
+            "import numeric\n"
+            "print volume(3)\n"
+            "print square(4)\n"s);
+
+    for (int i = 0; i < 2; ++i)
+    {
+        std::stringstream istream, ostream;
+
+        Interpreter interpreter(istream, ostream);
+        interpreter.add_module_path(directory.string());
+        interpreter.execute(*program);
+
+        // module runs once per interpreter, however many times it is imported
+        ASSERT_EQ(ostream.str(), "l\n27\n16\n"s);
+    }
+
+    std::stringstream istream, ostream;
+
+    Interpreter interpreter(istream, ostream);
+    interpreter.add_module_path(directory.string());
+
+    ASSERT_THROW(interpreter.execute(*CompiledProgram::compile("import missing"s)), Semantic::SemanticError);
+
+    std::filesystem::remove_all(directory);
+}
+
+
+TEST(InterpreterTest, ClosureEngine)
+{
+    auto run = [] (const std::string &source, const std::string &input, bool closures) {
+        std::stringstream file(source), istream(input), ostream;
+
+        Interpreter interpreter(istream, ostream);
+        interpreter.compile_closures(closures);
+        interpreter.compile_hot_loops(0);
+        interpreter.interpret(file);
+
+        return ostream.str();
+    };
+
+    std::vector<std::pair<std::string, std::string>> programs = {
+            // callee sees variables of its caller, redefinition in a block shadows function
+            {"func get() -> int return x end\n"
+             "var x = 1\nprint get()\n"
+             "if true then var x = 2\nprint get() end\n"
+             "if true then func get() -> int return 0 end\nprint get() end\n"
+             "print get()\n", ""},
+
+            // inlined and memoized calls, generators, parallel loop and tasks are visited from closures
+            {"func sq(x int) -> int return x * x end\n"
+             "memo func fib(n int) -> int if n < 2 then return n end\nreturn fib(n - 1) + fib(n - 2) end\n"
+             "func count(n int) for i in 0..n do yield i end end\n"
+             "var s = 0\nfor v in count(4) do s = s + sq(v) end\nprint s\nprint fib(30)\n"
+             "var t = 0\nparallel for i in 0..100 reduce + t do t = t + i end\nprint t\n"
+             "let h = spawn fib(10)\nprint join h\n", ""},
+
+            {"var c char\nread c\nlet k = 3\nfor i in 10..0 step 0 - k do print c + i end\nprint 7 / 2 == 3.5\n", "a"},
+
+            // errors stop the program at the same statement
+            {"print 1\nlet x = 1\nx = 2\nprint 3\n", ""},
+            {"var x = 1\nx = 1.5\n", ""},
+            {"5 = 1\n", ""},
+            {"print 1 + true\n", ""},
+            {"while 1 do end\n", ""},
+            {"for i in 0..1 step 0 do end\n", ""},
+            {"func f(x int) -> int print x end\nprint f(true)\nprint f(1)\n", ""},
+            {"func f() -> float return 1 end\nprint f()\n", ""},
+            {"func f() print 1 return 1 end\nf()\n", ""},
+            {"var b bool = 1\n", ""},
+            {"print y\n", ""},
+    };
+
+    for (auto directory : {"examples", "perf/corpus"})
+    {
+        for (auto &entry : std::filesystem::directory_iterator(TOMATO_SOURCE_DIR "/"s + directory))
+        {
+            if (entry.path().extension() != ".tm")
+                continue;
+
+            std::ifstream file(entry.path()), input(std::filesystem::path(entry.path()).replace_extension(".in"));
+            std::string source(std::istreambuf_iterator<char>(file), {});
+
+            programs.emplace_back(source, input ? std::string(std::istreambuf_iterator<char>(input), {}) : "1 2 3 0");
+        }
+    }
+
+    for (auto &[source, input] : programs)
+        ASSERT_EQ(run(source, input, true), run(source, input, false)) << source;
+}
+
+
+TEST(InterpreterTest, SelfSpecializingNodes)
+{
+    auto run = [] (const std::string &source, bool closures) {
+        std::stringstream file(source), istream, ostream;
+
+        Interpreter interpreter(istream, ostream);
+        interpreter.compile_closures(closures);
+        interpreter.interpret(file);
+
+        return ostream.str();
+    };
+
+    std::vector<std::string> programs = {
+            // the same nodes see variables of callers with other types
+            "func show() print x * 2\nprint x < x end\n"
+            "var x = 3\nshow()\nshow()\n"
+            "if true then var x = 1.5\nshow() end\n"
+            "show()\n"
+            "if true then var x = 'a'\nshow() end\n",
+
+            "func bump() y = y + 1 end\n"
+            "var y = 1\nbump()\nprint y\n"
+            "if true then var y = 2.5\nbump()\nbump()\nprint y end\n"
+            "bump()\nprint y\n"
+            "if true then let y = 3\nbump() end\n",
+
+            "func test() if c then print 1 else print 0 end end\n"
+            "var c = true\ntest()\nc = false\ntest()\n"
+            "if true then var c = 1\ntest() end\n",
+
+            // right operand changes the variable read by the left one
+            "var n = 1\nfunc grow() -> int n = n + 10\nreturn 1 end\n"
+            "var i = 0\nwhile i < 3 do print n + grow()\nprint n * 2 + grow()\ni = i + 1 end\n",
+
+            "var b = true\nvar k = 0\nwhile k < 4 do b = b xor k < 2\nprint b and true\nk = k + 1 end\n"
+            "var f = 1.0\nfor j in 0..5 do f = f / 2 + j\nprint f ^ 2.0 end\n"
+            "var e = 2\nfor j in 0..e + 1 do print e ^ j / 3 end\n",
+    };
+
+    for (auto &source : programs)
+        ASSERT_EQ(run(source, true), run(source, false)) << source;
+}
+
+
+TEST(InterpreterTest, HotLoopReplacement)
+{
+    // output and statistics of running source with loops compiled after given number of iterations
+    auto run = [] (const std::string &source, size_t hot_loop) {
+        std::stringstream file(source), istream, ostream, stats;
+
+        Interpreter interpreter(istream, ostream);
+        interpreter.compile_closures(false);
+        interpreter.compile_hot_loops(hot_loop);
+        interpreter.interpret(file);
+        interpreter.print_stats(stats);
+
+        return std::make_pair(ostream.str(), stats.str());
+    };
+
+    std::vector<std::string> programs = {
+            // variables declared before the loop, in its body and in nested loops go on
+            "var i = 0\nvar s = 0\nvar f = 0.5\n"
+            "while i < 10 do var t = i * i\ns = s + t\nf = f * 1.5\n"
+            "var j = 0\nwhile j < i do j = j + 2 end\nprint s + j\ni = i + 1 end\nprint f\n",
+
+            // return from a loop of a function, caller's variables seen by callee
+            "func first(limit int) -> int\n"
+            "    var n = 1\n    while true do if n * n > limit then return n end\nn = n + stride end\nend\n"
+            "var stride = 1\nprint first(50)\nstride = 3\nprint first(50)\n",
+
+            // errors after the transition are the same
+            "var k = 0\nwhile k < 10 do print 10 / (5 - k) + k ^ 2\nk = k + 1\nif k == 6 then print k + true end end\n",
+            "func count() var c = 0\nwhile c < 8 do c = c + x end\nprint c end\n"
+            "var x = 2\ncount()\nif true then var x = 2.5\ncount() end\n",
+    };
+
+    for (auto &source : programs)
+    {
+        auto [visited, no_stats] = run(source, 0);
+        auto [replaced, stats] = run(source, 3);
 
-    Interpreter interpreter(buffer);
+        ASSERT_EQ(replaced, visited) << source;
+        ASSERT_EQ(no_stats, "");
+        ASSERT_NE(stats.find("hot loops compiled"), std::string::npos) << source;
+    }
+
+    // loop of a function gets hot on every call, but it is compiled once
+    auto [output, stats] = run(
+            "func sum(n int) -> int var s = 0\nvar i = 0\nwhile i < n do s = s + i\ni = i + 1 end\nreturn s end\n"
+            "var c = 0\nwhile c < 5 do print sum(10)\nc = c + 1 end\n", 3);
+
+    ASSERT_EQ(output, "45\n45\n45\n45\n45\n");
+    ASSERT_NE(stats.find("hot loops compiled: 2\n"), std::string::npos) << stats;
+}
+
+
+TEST(InterpreterTest, InlinedCallDeoptimization)
+{
+    for (bool closures : {false, true})
+    {
+        std::stringstream istream, ostream, stats;
+
+        Interpreter interpreter(istream, ostream);
+        interpreter.compile_closures(closures);
+
+        // f is defined once in this program, so g inlines it
+        std::stringstream first("func f() -> int return 1 end\nfunc g() -> int return f() + 10 end\nprint g()\n");
+        interpreter.interpret(first);
+
+        // later statements shadow f, calls of g must see the f of their scope
+        std::stringstream second(
+                "print g()\n"
+                "if true then func f() -> int return 2 end\nprint g() end\n"
+                "func h() -> int\n    if true then func f() -> int return 3 end\nreturn g() end\nend\n"
+                "print h()\nprint g()\n");
+        interpreter.interpret(second);
+
+        interpreter.print_stats(stats);
+
+        EXPECT_EQ(ostream.str(), "11\n11\n12\n13\n11\n") << closures;
+        // compiled g is invalidated instead, and compiled again with the call
+        auto expected = closures ? "compiled bodies invalidated: 1" : "inlined calls deoptimized: 2";
+        EXPECT_NE(stats.str().find(expected), std::string::npos) << stats.str();
+    }
+}
+
+
+TEST(InterpreterTest, ShortCircuit)
+{
+    auto source =
+            "func t(x int) -> bool\n    print x\n    return true\nend\n"
+            "func f(x int) -> bool\n    print x\n    return false\nend\n"
+            "print f(1) and t(2)\nprint t(3) or f(4)\n"
+            "print t(5) and f(6)\nprint f(7) or t(8)\n"
+            "print t(9) xor f(10)\n"
+            "var i = 0\nwhile i < 2 and t(i) do i = i + 1 end\n"
+            // skipped operand isn't checked
+            "print (false and 1) or (true or undefined)\n"
+            "print 1 and false\n"s;
+
+    for (bool closures : {false, true})
+    {
+        std::stringstream file(source), istream, ostream;
+
+        Interpreter interpreter(istream, ostream);
+        interpreter.compile_closures(closures);
+        interpreter.interpret(file);
+
+        ASSERT_EQ(ostream.str(), "1\nfalse\n3\ntrue\n5\n6\nfalse\n7\n8\ntrue\n9\n10\ntrue\n0\n1\ntrue\n"
+                                 "semantic error: undefined operation\n") << closures;
+    }
+}
+
+
+TEST(InterpreterTest, CopyElision)
+{
+    // temporaries are moved into declarations, parameters and channels, values of variables are still copied
+    auto source =
+            "var x = 1\nvar y = x\ny = 2\nprint x\n"
+            "let k = x + 1\nvar m = k\nm = m + 1\nprint k\nprint m\n"
+            "func inc(a int) -> int\n    a = a + 1\n    return a\nend\n"
+            "func id(a int) -> int return a end\n"
+            "print inc(x)\nprint inc(x + 10)\nprint x\n"
+            "var z = id(x)\nz = 5\nprint x\n"
+            "var w = id(x + 1)\nw = w + 1\nprint w\n"
+            "let c = channel(int, 2)\nsend c, x\nsend c, x * 7\nx = 9\nvar r = recv c\nr = r + 1\nprint recv c\nprint r\nprint x\n"
+            "func gen() var g = 3\nyield g\ng = 4\nyield g end\n"
+            "for v in gen() do print v end\n"
+            "let fixed = 5\nfixed = 6\n"s;
 
-    auto code = "print 2 + 2 * 2\n"s;
+    for (bool closures : {false, true})
+    {
+        std::stringstream file(source), istream, ostream;
 
-    interpreter.interpret(code);
+        Interpreter interpreter(istream, ostream);
+        interpreter.compile_closures(closures);
+        interpreter.interpret(file);
 
-    ASSERT_EQ(buffer.str(), "6"s);*/
+        ASSERT_EQ(ostream.str(), "1\n2\n3\n2\n12\n1\n1\n3\n7\n2\n9\n3\n4\n"
+                                 "semantic error: assigning to constant object\n") << closures;
+    }
 }
@@ -0,0 +1,258 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include <ir/lowering.hpp>
+#include <ir/passes.hpp>
+#include <ir/verifier.hpp>
+#include <syntax/parser.hpp>
+
+
+using namespace std::string_literals;
+using namespace Tomato;
+
+
+static IR::Module Lower(const std::string &source)
+{
+    Syntax::Parser parser;
+    parser.set_text(source);
+
+    Syntax::Program program;
+    parser.parse_program(program);
+
+    auto module = IR::lower(program);
+    IR::verify(module);
+
+    return module;
+}
+
+
+static std::string Dump(const IR::Module &module)
+{
+    std::stringstream stream;
+    IR::dump(module, stream);
+    return stream.str();
+}
+
+
+TEST(IRTest, Lowering)
+{
+    auto module = Lower(
+            "func sign(x int) -> int\n"
+            "    if x < 0 then return 0 - 1 end\n"
+            "    return 1\n"
+            "end\n"
+            "var k = 0\n"
+            "while k < 3 do k = k + 1 end\n"
+            "print sign(k)\n"s);
+
+    ASSERT_EQ(Dump(module),
+              "func sign(int) -> int\n"
+              "b0:\n"
+              "    %0 = param int 0\n"
+              "    %1 = const int 0\n"
+              "    %2 = lt bool %0, %1\n"
+              "    branch %2, b1, b2\n"
+              "b1:    ; from b0\n"
+              "    %3 = const int 0\n"
+              "    %4 = const int 1\n"
+              "    %5 = sub int %3, %4\n"
+              "    return %5\n"
+              "b2:    ; from b0\n"
+              "    %6 = const int 1\n"
+              "    return %6\n"
+              "\n"
+              "func $program() -> void\n"
+              "b0:\n"
+              "    %0 = const int 0\n"
+              "    jump b1\n"
+              "b1:    ; from b0 b2\n"
+              "    %1 = phi int %0 b0, %5 b2\n"
+              "    %2 = const int 3\n"
+              "    %3 = lt bool %1, %2\n"
+              "    branch %3, b2, b3\n"
+              "b2:    ; from b1\n"
+              "    %4 = const int 1\n"
+              "    %5 = add int %1, %4\n"
+              "    jump b1\n"
+              "b3:    ; from b1\n"
+              "    %6 = call int sign %1\n"
+              "    print %6\n"
+              "    return\n");
+
+    // errors found at run time stop the program where the interpreter would
+    auto trap = [] (const std::string &source) {
+        auto dump = Dump(Lower(source));
+        auto position = dump.find("trap \"");
+        return position == std::string::npos ? ""s : dump.substr(position + 6, dump.find('"', position + 6) - position - 6);
+    };
+
+    ASSERT_EQ(trap("print 1 + true\n"), "undefined operation");
+    ASSERT_EQ(trap("var b = true\nprint b and 1\n"), "undefined operation");
+    ASSERT_EQ(trap("var b = false\nprint b or x\n"), "undefined reference to 'x'");
+    ASSERT_EQ(trap("if 1 then print 1 end\n"), "condition must be bool");
+    ASSERT_EQ(trap("let x = 1\nx = 2\n"), "assigning to constant object");
+    ASSERT_EQ(trap("var x = 1\nx = 2.0\n"), "assigning different types");
+    ASSERT_EQ(trap("var x = 1\nvar x = 2\n"), "name 'x' is already defined at this scope");
+    ASSERT_EQ(trap("print f(1)\nfunc f(x int) -> int return x end\n"), "undefined reference to 'f'");
+    ASSERT_EQ(trap("func f(x int) -> int return x end\nprint f(true)\n"), "parameter type mismatch");
+    ASSERT_EQ(trap("func f(x int) -> int print x end\nprint f(1)\n"), "function did not return anything");
+    ASSERT_EQ(trap("var s = 1\nread s\nfor i in 0..10 step s do print i end\n"), "range step must not be zero");
+
+    // names resolved by the caller at run time can't be lowered
+    ASSERT_THROW(Lower("func f() -> int return g end\nvar g = 1\nprint f()\n"), IR::LoweringError);
+    ASSERT_THROW(Lower("func f() -> int return 1 end\nvar f = 1\n"), IR::LoweringError);
+    ASSERT_THROW(Lower("func f() -> int return g() end\nprint f()\nfunc g() -> int return 1 end\n"), IR::LoweringError);
+    ASSERT_THROW(Lower("var c = channel(int, 1)\n"), IR::LoweringError);
+}
+
+
+TEST(IRTest, Optimizations)
+{
+    auto optimized = [] (const std::string &source, bool (*pass)(IR::Function &)) {
+        auto module = Lower(source);
+
+        for (auto &function : module.functions)
+        {
+            pass(*function);
+            IR::verify(module);
+        }
+
+        return Dump(module);
+    };
+
+    // constant condition decides the branch, the other one disappears
+    ASSERT_EQ(optimized("let n = 4\nvar x = n * 2\nif x > 5 then print x else print 0 end\n", IR::propagate_constants),
+              "func $program() -> void\n"
+              "b0:\n"
+              "    %0 = const int 8\n"
+              "    %1 = const bool true\n"
+              "    %2 = const int 4\n"
+              "    %3 = const int 2\n"
+              "    %4 = mul int %2, %3\n"
+              "    %5 = const int 5\n"
+              "    %6 = gt bool %0, %5\n"
+              "    jump b1\n"
+              "b1:    ; from b0\n"
+              "    print %0\n"
+              "    jump b3\n"
+              "b3:    ; from b1\n"
+              "    return\n");
+
+    // unused values go away, int remainder which may trap stays, straight jumps are merged
+    ASSERT_EQ(optimized("var a int\nread a\nvar b = a * 3\nvar c = a % a\nif true then print a end\n", IR::eliminate_dead_code),
+              "func $program() -> void\n"
+              "b0:\n"
+              "    %0 = const int 0\n"
+              "    %1 = read int %0\n"
+              "    %2 = mod int %1, %1\n"
+              "    %3 = const bool true\n"
+              "    branch %3, b1, b2\n"
+              "b1:    ; from b0\n"
+              "    print %1\n"
+              "    jump b2\n"
+              "b2:    ; from b0 b1\n"
+              "    return\n");
+
+    ASSERT_EQ(optimized("var a float\nread a\nprint a * 2 + 1\nif a > 0 then print 2 * a end\n", IR::eliminate_common_subexpressions),
+              "func $program() -> void\n"
+              "b0:\n"
+              "    %0 = const float 0\n"
+              "    %1 = read float %0\n"
+              "    %2 = const int 2\n"
+              "    %3 = mul float %1, %2\n"
+              "    %4 = const int 1\n"
+              "    %5 = add float %3, %4\n"
+              "    print %5\n"
+              "    %6 = const int 0\n"
+              "    %7 = gt bool %1, %6\n"
+              "    branch %7, b1, b2\n"
+              "b1:    ; from b0\n"
+              "    print %3\n"
+              "    jump b2\n"
+              "b2:    ; from b0 b1\n"
+              "    return\n");
+
+    // remainder by a value which may be zero isn't executed before the loop
+    ASSERT_EQ(optimized("var a int\nread a\nvar i = 0\nwhile i < a do print a * a + a % i\ni = i + 1 end\n", IR::hoist_loop_invariants),
+              "func $program() -> void\n"
+              "b0:\n"
+              "    %0 = const int 0\n"
+              "    %1 = read int %0\n"
+              "    %2 = const int 0\n"
+              "    %3 = mul int %1, %1\n"
+              "    %4 = const int 1\n"
+              "    jump b1\n"
+              "b1:    ; from b0 b2\n"
+              "    %5 = phi int %2 b0, %9 b2\n"
+              "    %6 = lt bool %5, %1\n"
+              "    branch %6, b2, b3\n"
+              "b2:    ; from b1\n"
+              "    %7 = mod int %1, %5\n"
+              "    %8 = add int %3, %7\n"
+              "    print %8\n"
+              "    %9 = add int %5, %4\n"
+              "    jump b1\n"
+              "b3:    ; from b1\n"
+              "    return\n");
+}
+
+
+TEST(IRTest, Verifier)
+{
+    std::vector<std::string> sources = {
+            "var t = 0\n"
+            "for i in 0..10 do for j in i..0 step 0 - 2 do t = t + i * j end end\n"
+            "var s int\nread s\n"
+            "for k in 10..0 step s do if k % 3 == 0 then print k else t = t - 1 end end\n"
+            "print t\n",
+
+            "func collatz(n int) -> int\n"
+            "    var steps = 0\n"
+            "    var x = n\n"
+            "    while x != 1 do\n"
+            "        if x % 2 == 0 then x = x - 1 else x = 3 * x + 1 end\n"
+            "        steps = steps + 1\n"
+            "    end\n"
+            "    return steps\n"
+            "end\n"
+            "print collatz(27)\n",
+
+            "var c = 'a'\nvar b = true\nwhile b do c = c + 1\nb = c < 'z' xor false end\nprint c\n"
+    };
+
+    for (auto directory : {"examples", "perf/corpus"})
+    {
+        for (auto &entry : std::filesystem::directory_iterator(TOMATO_SOURCE_DIR "/"s + directory))
+        {
+            if (entry.path().extension() != ".tm")
+                continue;
+
+            std::ifstream file(entry.path());
+            sources.emplace_back(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        }
+    }
+
+    for (auto &source : sources)
+    {
+        auto module = Lower(source);
+
+        for (auto pass : {IR::propagate_constants, IR::eliminate_dead_code,
+                          IR::eliminate_common_subexpressions, IR::hoist_loop_invariants})
+        {
+            for (auto &function : module.functions)
+                pass(*function);
+
+            ASSERT_NO_THROW(IR::verify(module)) << source;
+        }
+
+        IR::optimize(module);
+        ASSERT_NO_THROW(IR::verify(module)) << source;
+    }
+
+    // broken module is reported
+    auto module = Lower("var a = 1\nprint a\n");
+    auto &block = *module.functions.back()->entry();
+    std::swap(block.instructions.front(), block.instructions.back());
+
+    ASSERT_THROW(IR::verify(module), IR::VerificationError);
+}
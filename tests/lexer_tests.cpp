@@ -1,5 +1,10 @@
 #include <gtest/gtest.h>
 #include <syntax/lexer.hpp>
+#include <syntax/scan.hpp>
+
+#include <cctype>
+#include <random>
+#include <vector>
 
 
 TEST(LexerTest, GeneralTest)
@@ -12,7 +17,7 @@ TEST(LexerTest, GeneralTest)
 
     ASSERT_EQ(lexer.get_next().terminal, Terminal::Let);
     ASSERT_EQ(lexer.get_next().terminal, Terminal::Identifier);
-    ASSERT_EQ(lexer.get_next().terminal, Terminal::Operator);
+    ASSERT_EQ(lexer.get_next().terminal, Terminal::Assignment);
     ASSERT_EQ(lexer.get_next().terminal, Terminal::FloatLiteral);
 
     ASSERT_TRUE(lexer.eof());
@@ -45,17 +50,37 @@ TEST(LexerTest, Terminals)
     ASSERT_EQ(lexer.get_next().terminal, Terminal::In);
     ASSERT_EQ(lexer.get_next().terminal, Terminal::Func);
 
-    lexer.set_text("+  -  *  /  %  ^  =  <  >  "
-                           "+= -= *= /= %= ^= == <= >= != "
+    lexer.set_text("+  -  *  /  %  ^  <  >  "
+                           "== <= >= != "
                            "and or not");
 
-    for (int i = 0; i < 22; ++i)
+    for (int i = 0; i < 15; ++i)
     {
         ASSERT_EQ(lexer.get_next().terminal, Terminal::Operator);
     }
 
     ASSERT_TRUE(lexer.eof());
 
+    lexer.set_text("= -> . .. ,");
+
+    ASSERT_EQ(lexer.get_next().terminal, Terminal::Assignment);
+    ASSERT_EQ(lexer.get_next().terminal, Terminal::Arrow);
+    ASSERT_EQ(lexer.get_next().terminal, Terminal::Dot);
+    ASSERT_EQ(lexer.get_next().terminal, Terminal::Range);
+    ASSERT_EQ(lexer.get_next().terminal, Terminal::Coma);
+
+    ASSERT_TRUE(lexer.eof());
+
+    // The parser tells where these are keywords
+    lexer.set_text("step parallel reduce memo spawn join channel send recv close yield");
+
+    for (int i = 0; i < 11; ++i)
+    {
+        ASSERT_EQ(lexer.get_next().terminal, Terminal::Identifier);
+    }
+
+    ASSERT_TRUE(lexer.eof());
+
     lexer.set_text("read print true false");
 
     ASSERT_EQ(lexer.get_next().terminal, Terminal::Read);
@@ -76,3 +101,102 @@ TEST(LexerTest, Terminals)
 
     ASSERT_TRUE(lexer.eof());
 }
+
+
+static std::vector<Tomato::Syntax::Scan::Isa> SupportedIsas()
+{
+    using namespace Tomato::Syntax;
+
+    std::vector<Scan::Isa> isas = {Scan::Isa::Scalar};
+
+    if (Scan::detect() >= Scan::Isa::SSE2) isas.push_back(Scan::Isa::SSE2);
+    if (Scan::detect() >= Scan::Isa::AVX2) isas.push_back(Scan::Isa::AVX2);
+
+    return isas;
+}
+
+
+TEST(ScanTest, CharacterClasses)
+{
+    using namespace Tomato::Syntax;
+
+    // every byte value as a stopper at every position of a block
+    for (auto isa : SupportedIsas())
+    {
+        Scan::select(isa);
+
+        for (int c = 0; c < 256; ++c)
+        {
+            for (size_t position = 0; position < 70; position += 3)
+            {
+                std::string spaces(70, ' '), digits(70, '7'), letters(70, 'Q');
+
+                spaces[position] = digits[position] = letters[position] = static_cast<char>(c);
+
+                auto expected = [&] (int (*belongs)(int), const std::string &text) {
+                    return belongs(c) ? text.size() : position;
+                };
+
+                ASSERT_EQ(Scan::whitespace_end(spaces.data(), 0, spaces.size()), expected(std::isspace, spaces));
+                ASSERT_EQ(Scan::digits_end(digits.data(), 0, digits.size()), expected(std::isdigit, digits));
+                ASSERT_EQ(Scan::alnum_end(letters.data(), 0, letters.size()), expected(std::isalnum, letters));
+            }
+        }
+    }
+
+    Scan::select(Scan::detect());
+}
+
+
+TEST(ScanTest, SameTokens)
+{
+    using namespace Tomato::Syntax;
+
+    const char *const pieces[] = {
+            " ", "  ", "\n", "\t", "\r\n", "x", "counter1", "abcdefghijklmnopqrstuvwxyz0123456789ABCDEF",
+            "1", "42", "3.25", "12345678901234567890123456789012345", "1..5", "func", "end", "+", "-",
+            "->", "==", "(", ")", ",", "'a'", "\"text with spaces\"", "print", "!", "$", "\x80", ".",
+    };
+
+    std::mt19937 random(2024);
+    std::uniform_int_distribution<size_t> piece(0, std::size(pieces) - 1);
+
+    auto tokens = [] (const std::string &text) {
+        std::vector<Token> result;
+        Lexer lexer(text);
+
+        do
+            result.push_back(lexer.get_next());
+        while (result.back().terminal != Terminal::EndOfFile);
+
+        return result;
+    };
+
+    for (int round = 0; round < 200; ++round)
+    {
+        std::string text;
+
+        for (int i = 0; i < 300; ++i)
+            text += pieces[piece(random)];
+
+        Scan::select(Scan::Isa::Scalar);
+        auto expected = tokens(text);
+
+        for (auto isa : SupportedIsas())
+        {
+            Scan::select(isa);
+            auto actual = tokens(text);
+
+            ASSERT_EQ(actual.size(), expected.size());
+
+            for (size_t i = 0; i < expected.size(); ++i)
+            {
+                ASSERT_EQ(actual[i].terminal, expected[i].terminal);
+                ASSERT_EQ(actual[i].lexeme, expected[i].lexeme);
+                ASSERT_EQ(actual[i].offset, expected[i].offset);
+            }
+        }
+    }
+
+    Scan::select(Scan::detect());
+}
@@ -0,0 +1,108 @@
+#include <gtest/gtest.h>
+#include <interpreter/interpreter.hpp>
+#include <optimizer/inliner.hpp>
+#include <syntax/parser.hpp>
+#include <syntax/printer.hpp>
+
+
+using namespace std::string_literals;
+using namespace Tomato;
+
+
+static size_t Inline(const std::string &source, std::string *tree = nullptr)
+{
+    Syntax::Parser parser;
+    parser.set_text(source);
+
+    Syntax::Program program;
+    parser.parse_program(program);
+
+    auto inlined = Optimizer::Inliner().optimize(program);
+
+    if (tree)
+    {
+        std::stringstream stream;
+        Syntax::Printer(stream).print(program);
+        *tree = stream.str();
+    }
+
+    return inlined;
+}
+
+
+static std::string Interpret(const std::string &source, bool optimize)
+{
+    std::stringstream istream, ostream;
+
+    Interpreter interpreter(istream, ostream);
+    interpreter.inline_functions(optimize);
+
+    std::stringstream file(source);
+    interpreter.interpret(file);
+
+    return ostream.str();
+}
+
+
+TEST(InlinerTest, Inlining)
+{
+    std::string tree;
+
+    auto inlined = Inline(
+            "func sq(x int) -> int return x * x end\n"
+            "func norm(a int, b int) -> int\n"
+            "    let s = sq(a) + sq(b)\n"
+            "    return s - 1\n"
+            "end\n"
+            "func show(x int) print x end\n"
+            "show(norm(1, 2))\n"s, &tree);
+
+    ASSERT_EQ(inlined, 4);
+    ASSERT_EQ(tree,
+              "func sq(x int) -> int\n"
+              "    return (x * x)\n"
+              "end\n"
+              "func norm(a int, b int) -> int\n"
+              "    let s = (sq(a) [inlined: return (x * x)] + sq(b) [inlined: return (x * x)])\n"
+              "    return (s - 1)\n"
+              "end\n"
+              "func show(x int)\n"
+              "    print x\n"
+              "end\n"
+              "show(norm(1, 2) [inlined: let s = (sq(a) [inlined: return (x * x)] + sq(b) [inlined: return (x * x)]);"
+              " return (s - 1)]) [inlined: print x;]\n"s);
+
+    // the name may refer to something else or the body doesn't fit
+    for (auto source : {
+            "func f(n int) -> int if n > 0 then return f(n - 1) end return 0 end print f(3)"s,
+            "func f() -> int return g() end func g() -> int return f() end print f()"s,
+            "print f() func f() -> int return 1 end"s,
+            "func f() -> int return 1 end if true then func f() -> int return 2 end print f() end"s,
+            "func f() -> int return 1 end func g() var f = 1 end print f()"s,
+            "func f(x int) -> int if x > 0 then return 1 end return 0 end print f(1)"s,
+            "memo func f() -> int return 1 end print f()"s,
+            "func f() -> int return 1 end print f(1)"s,
+            "func f() -> int return 1 + 1 + 1 + 1 + 1 + 1 + 1 + 1 + 1 + 1 + 1 + 1 + 1 + 1 + 1 + 1 + 1 end print f()"s,
+    })
+    {
+        ASSERT_EQ(Inline(source), 0) << source;
+    }
+}
+
+
+TEST(InlinerTest, SameResults)
+{
+    // parameters shadow caller's variables, other names are caller's, types are checked as for a call
+    for (auto source : {
+            "func add(x int) -> int let y = x + d return y end var x = 1 var d = 10 print add(2) print x"s,
+            "func set(v int) d = v end var d = 0 set(5) print d print set(6)"s,
+            "func f(x int) -> int return x end print f(1.5)"s,
+            "func f(x int) -> int return x / 2 end print f(3)"s,
+            "func f() -> int return 1 end print f(1)"s,
+            "func f(x int) -> float let x = 1.0 return x end print f(1)"s,
+            "func f(x int) -> int return x + g(x) end func g(x int) -> int return x * 2 end print f(2)"s,
+    })
+    {
+        ASSERT_EQ(Interpret(source, true), Interpret(source, false)) << source;
+    }
+}
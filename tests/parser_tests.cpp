@@ -10,3 +10,336 @@ TEST(ParserTest, Expressions)
 
     parser.set_text("var pi = let");
 }
+
+
+TEST(ParserTest, RangeLoop)
+{
+    using namespace Tomato::Syntax;
+
+    Parser parser;
+
+    parser.set_text("for i in 1..n step 2 do print i end");
+
+    auto loop = std::dynamic_pointer_cast<RangeLoop>(parser.parse());
+
+    ASSERT_TRUE(loop);
+    ASSERT_EQ(loop->counter->name, "i");
+    ASSERT_TRUE(std::dynamic_pointer_cast<Literal>(loop->begin));
+    ASSERT_TRUE(std::dynamic_pointer_cast<Identifier>(loop->end));
+    ASSERT_TRUE(loop->step);
+    ASSERT_EQ(loop->body->statements.size(), 1);
+    ASSERT_TRUE(parser.eof());
+
+    parser.set_text("for i in 0 .. 10 do end");
+    loop = std::dynamic_pointer_cast<RangeLoop>(parser.parse());
+    ASSERT_TRUE(loop);
+    ASSERT_FALSE(loop->step);
+
+    // without range it is a loop over iterable object
+    parser.set_text("for i in 10 do end");
+    ASSERT_TRUE(std::dynamic_pointer_cast<ForEachLoop>(parser.parse()));
+
+    parser.set_text("for i in 0..10 10 do end");
+    ASSERT_THROW(parser.parse(), SyntaxError);
+
+    parser.set_text("for i = 0..10 do end");
+    ASSERT_THROW(parser.parse(), SyntaxError);
+}
+
+
+TEST(ParserTest, ParallelLoop)
+{
+    using namespace Tomato::Syntax;
+
+    Parser parser;
+
+    parser.set_text("parallel for i in 0..n reduce + s, max m do s = s + i end");
+
+    auto loop = std::dynamic_pointer_cast<ParallelLoop>(parser.parse());
+
+    ASSERT_TRUE(loop);
+    ASSERT_EQ(loop->loop->counter->name, "i");
+    ASSERT_EQ(loop->reductions.size(), 2);
+    ASSERT_EQ(loop->reductions[0].type, ParallelLoop::Reduction::Type::Sum);
+    ASSERT_EQ(loop->reductions[0].variable->name, "s");
+    ASSERT_EQ(loop->reductions[1].type, ParallelLoop::Reduction::Type::Max);
+    ASSERT_TRUE(parser.eof());
+
+    parser.set_text("for i in 0..10 reduce + s do end");
+    ASSERT_THROW(parser.parse(), SyntaxError);
+
+    parser.set_text("parallel for i in 0..10 reduce - s do end");
+    ASSERT_THROW(parser.parse(), SyntaxError);
+}
+
+
+TEST(ParserTest, SpawnJoin)
+{
+    using namespace Tomato::Syntax;
+
+    Parser parser;
+
+    parser.set_text("join spawn f(1, x) + 1");
+
+    auto sum = std::dynamic_pointer_cast<BinaryOperation>(parser.parse());
+
+    ASSERT_TRUE(sum);
+
+    auto join = std::dynamic_pointer_cast<Join>(sum->left);
+
+    ASSERT_TRUE(join);
+
+    auto spawn = std::dynamic_pointer_cast<Spawn>(join->task);
+
+    ASSERT_TRUE(spawn);
+    ASSERT_EQ(spawn->call->function->name, "f");
+    ASSERT_EQ(spawn->call->arguments.size(), 2);
+
+    parser.set_text("spawn f");
+    ASSERT_THROW(parser.parse(), SyntaxError);
+
+    parser.set_text("spawn 1 + 2");
+    ASSERT_THROW(parser.parse(), SyntaxError);
+}
+
+
+TEST(ParserTest, Channels)
+{
+    using namespace Tomato::Syntax;
+
+    Parser parser;
+
+    parser.set_text("let c = channel(int, 16)");
+
+    auto declaration = std::dynamic_pointer_cast<ValueDeclaration>(parser.parse());
+
+    ASSERT_TRUE(declaration);
+
+    auto channel = std::dynamic_pointer_cast<MakeChannel>(declaration->init);
+
+    ASSERT_TRUE(channel);
+    ASSERT_EQ(channel->type->name, "int");
+
+    parser.set_text("send c, recv d + 1");
+
+    auto send = std::dynamic_pointer_cast<SendStatement>(parser.parse());
+
+    ASSERT_TRUE(send);
+    ASSERT_TRUE(std::dynamic_pointer_cast<BinaryOperation>(send->value));
+
+    parser.set_text("for x in c do close c end");
+
+    auto loop = std::dynamic_pointer_cast<ForEachLoop>(parser.parse());
+
+    ASSERT_TRUE(loop);
+    ASSERT_EQ(loop->variable->name, "x");
+    ASSERT_TRUE(std::dynamic_pointer_cast<CloseStatement>(loop->body->statements[0]));
+
+    parser.set_text("func f(c channel) -> channel return c end");
+    ASSERT_TRUE(std::dynamic_pointer_cast<Function>(parser.parse()));
+
+    parser.set_text("parallel for x in c do end");
+    ASSERT_THROW(parser.parse(), SyntaxError);
+}
+
+
+TEST(ParserTest, Generators)
+{
+    using namespace Tomato::Syntax;
+
+    Parser parser;
+
+    parser.set_text("func g(n int) for i in 0..n do yield i end end");
+
+    auto function = std::dynamic_pointer_cast<Function>(parser.parse());
+
+    ASSERT_TRUE(function);
+    ASSERT_TRUE(function->generator);
+
+    // yield belongs to the innermost function only
+    parser.set_text("func f() func g() yield 1 end end");
+
+    function = std::dynamic_pointer_cast<Function>(parser.parse());
+
+    ASSERT_TRUE(function);
+    ASSERT_FALSE(function->generator);
+    ASSERT_TRUE(std::dynamic_pointer_cast<Function>(function->body->statements[0])->generator);
+
+    parser.set_text("yield 1");
+    ASSERT_THROW(parser.parse(), SyntaxError);
+}
+
+
+TEST(ParserTest, Import)
+{
+    using namespace Tomato::Syntax;
+
+    Parser parser;
+
+    parser.set_text("import geometry.shapes.box");
+
+    auto statement = std::dynamic_pointer_cast<ImportStatement>(parser.parse());
+
+    ASSERT_TRUE(statement);
+    ASSERT_EQ(statement->module->name, "geometry.shapes.box");
+
+    parser.set_text("import geometry.");
+    ASSERT_THROW(parser.parse(), SyntaxError);
+}
+
+
+TEST(ParserTest, Memo)
+{
+    using namespace Tomato::Syntax;
+
+    Parser parser;
+
+    parser.set_text("memo func f(x int) -> int return x end");
+
+    auto function = std::dynamic_pointer_cast<Function>(parser.parse());
+
+    ASSERT_TRUE(function);
+    ASSERT_TRUE(function->memo);
+
+    // without 'func' after it, 'memo' is a name
+    parser.set_text("memo print 1");
+    ASSERT_TRUE(std::dynamic_pointer_cast<Identifier>(parser.parse()));
+
+    parser.set_text("memo func");
+    ASSERT_THROW(parser.parse(), SyntaxError);
+
+    ASSERT_EQ(Parser::top_level_functions("print 1\nmemo func f() end"), std::vector<size_t>{8});
+}
+
+
+TEST(ParserTest, ContextualKeywords)
+{
+    using namespace Tomato::Syntax;
+
+    Parser parser;
+
+    // words added to the language after it was released still name variables and functions
+    parser.set_text("var step = 2\n"
+                    "for reduce in 0..10 step step do end\n"
+                    "func send(channel int, yield int) -> int return channel + yield end\n"
+                    "join = send(1, recv) + spawn\n"
+                    "parallel = memo\n"
+                    "close(join)\n");
+
+    Program program;
+    parser.parse_program(program);
+
+    ASSERT_EQ(program.statements.size(), 6);
+
+    auto loop = std::dynamic_pointer_cast<RangeLoop>(program.statements[1]);
+
+    ASSERT_TRUE(loop);
+    ASSERT_EQ(loop->counter->name, "reduce");
+    ASSERT_EQ(std::dynamic_pointer_cast<Identifier>(loop->step)->name, "step");
+
+    auto function = std::dynamic_pointer_cast<Function>(program.statements[2]);
+
+    ASSERT_TRUE(function);
+    ASSERT_EQ(function->identifier->name, "send");
+    ASSERT_FALSE(function->generator);
+
+    ASSERT_TRUE(std::dynamic_pointer_cast<Assignment>(program.statements[3]));
+    ASSERT_TRUE(std::dynamic_pointer_cast<Assignment>(program.statements[4]));
+    ASSERT_TRUE(std::dynamic_pointer_cast<Call>(program.statements[5]));
+
+    // followed by what fits them, they are keywords
+    parser.set_text("var c channel = channel(int, 1)");
+
+    auto declaration = std::dynamic_pointer_cast<ValueDeclaration>(parser.parse());
+
+    ASSERT_TRUE(declaration);
+    ASSERT_EQ(declaration->type->name, "channel");
+    ASSERT_TRUE(std::dynamic_pointer_cast<MakeChannel>(declaration->init));
+
+    parser.set_text("send join, recv not close");
+    ASSERT_TRUE(std::dynamic_pointer_cast<SendStatement>(parser.parse()));
+
+    parser.set_text("func g(step int) for i in 0..10 step step do yield not i == 0 end end");
+    ASSERT_TRUE(std::dynamic_pointer_cast<Function>(parser.parse())->generator);
+
+    parser.set_text("parallel for i in 0..10 reduce + memo do memo = memo + i end");
+    ASSERT_TRUE(std::dynamic_pointer_cast<ParallelLoop>(parser.parse()));
+}
+
+
+TEST(ParserTest, DeferredBodies)
+{
+    using namespace Tomato::Syntax;
+
+    Parser parser;
+    parser.defer_function_bodies(true);
+
+    parser.set_text("func g(n int) for i in 0..n do if i > 1 then yield i end end func h() yield 1 end end");
+
+    auto function = std::dynamic_pointer_cast<Function>(parser.parse());
+
+    ASSERT_TRUE(function);
+    ASSERT_FALSE(function->body);
+    ASSERT_TRUE(function->generator);
+    ASSERT_EQ(function->definition()->statements.size(), 2);
+
+    // only block structure is checked up front
+    parser.set_text("func f() print + end");
+    function = std::dynamic_pointer_cast<Function>(parser.parse());
+
+    ASSERT_TRUE(function);
+    ASSERT_THROW(function->definition(), SyntaxError);
+
+    parser.set_text("func f() while true do print 1 end");
+    ASSERT_THROW(parser.parse(), SyntaxError);
+}
+
+
+TEST(ParserTest, ResumableInput)
+{
+    using namespace Tomato::Syntax;
+
+    std::vector<std::string> lines = {"func f(a int,", "b int) -> int"};
+
+    for (int i = 0; i < 5000; ++i)
+        lines.push_back("    print (a +\n" + std::to_string(i) + ")");
+
+    lines.push_back("    return a");
+    lines.push_back("end");
+
+    size_t next = 1, reads = 0;
+
+    Parser parser;
+
+    parser.set_input([&] (std::string &line) {
+        ++reads;
+
+        if (next == lines.size())
+            return false;
+
+        line = lines[next++];
+        return true;
+    });
+
+    parser.set_text(lines[0]);
+
+    auto function = std::dynamic_pointer_cast<Function>(parser.parse());
+
+    // every line is requested once, when the text ends inside the function
+    ASSERT_TRUE(function);
+    ASSERT_EQ(reads, lines.size() - 1);
+    ASSERT_EQ(function->arguments.size(), 2);
+    ASSERT_EQ(function->body->statements.size(), 5001);
+
+    // statement complete at the end of text doesn't wait for more
+    parser.set_text("print 1");
+    ASSERT_TRUE(parser.parse());
+    ASSERT_EQ(reads, lines.size() - 1);
+
+    next = 0;
+    lines = {"print 2"};
+
+    parser.set_text("if true then print 1");
+    ASSERT_THROW(parser.parse(), SyntaxError);
+    ASSERT_TRUE(parser.eof());
+}
@@ -0,0 +1,60 @@
+#include <gtest/gtest.h>
+#include <syntax/parser.hpp>
+#include <syntax/serializer.hpp>
+
+
+using namespace std::string_literals;
+using namespace Tomato::Syntax;
+
+
+TEST(SerializerTest, RoundTrip)
+{
+    Parser parser;
+
+    parser.set_text("func f(n int, x float) -> float\n"
+                    "    if n > 0 then return x * f(n - 1, x) else return 1.0 end\n"
+                    "end\n"
+                    "let c = 'a'\n"
+                    "var i int\n"
+                    "while not (i >= 10) do i = i + 1 end\n"
+                    "print f(3, 2.0) ^ 2\n"
+                    "read i\n");
+
+    Program program;
+    parser.parse_program(program);
+
+    std::string first;
+    Serializer(first).serialize(program);
+
+    auto restored = Deserializer(first.data(), first.size()).program();
+
+    std::string second;
+    Serializer(second).serialize(*restored);
+
+    ASSERT_EQ(restored->statements.size(), 6);
+    ASSERT_EQ(first, second);
+}
+
+
+TEST(SerializerTest, MalformedInput)
+{
+    Parser parser;
+    parser.set_text("var x = 2 + 2 * 2\nprint x\n");
+
+    Program program;
+    parser.parse_program(program);
+
+    std::string data;
+    Serializer(data).serialize(program);
+
+    for (size_t size = 0; size < data.size(); ++size)
+    {
+        ASSERT_THROW(Deserializer(data.data(), size).program(), SerializationError);
+    }
+
+    auto extra = data + "\0"s;
+    ASSERT_THROW(Deserializer(extra.data(), extra.size()).program(), SerializationError);
+
+    auto invalid = "\xff"s;
+    ASSERT_THROW(Deserializer(invalid.data(), invalid.size()).program(), SerializationError);
+}